@@ -1,4 +1,6 @@
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
 #include <vector>
 #include <exception>
 
@@ -7,8 +9,12 @@
 #include <boost/filesystem/fstream.hpp>
 
 #include <components/bsa/bsa_file.hpp>
+#include <components/bsa/bsa_writer.hpp>
+#include <components/bsa/compressed_file.hpp>
+#include <components/files/lowlevelfile.hpp>
+#include <components/vfs/tracer.hpp>
 
-#define BSATOOL_VERSION 1.1
+#define BSATOOL_VERSION 1.2
 
 // Create local aliases for brevity
 namespace bpo = boost::program_options;
@@ -20,6 +26,8 @@ struct Arguments
     std::string filename;
     std::string extractfile;
     std::string outdir;
+    std::string target;
+    std::string order;
 
     bool longformat;
     bool fullpath;
@@ -45,6 +53,16 @@ bool parseOptions (int argc, char** argv, Arguments &info)
             "      Extract a file from the input archive.\n\n"
             "  bsatool extractall archivefile [output_directory]\n"
             "      Extract all files from the input archive.\n\n"
+            "  bsatool pack [-o orderfile] directory archivefile\n"
+            "      Create an archive from all files below a directory.\n\n"
+            "  bsatool repack [-o orderfile] archivefile output_archivefile\n"
+            "      Rewrite an archive, with the file data in a new order.\n\n"
+            "  bsatool convert [-o orderfile] source output_archivefile\n"
+            "      Create an LZ4 compressed OpenMW archive (.omwa) from a directory or\n"
+            "      an archive.\n\n"
+            "  bsatool verify archivefile source\n"
+            "      Compare every file in an archive with a source archive or directory,\n"
+            "      and check the archive's hash table.\n\n"
             "Allowed options");
 
     desc.add_options()
@@ -53,6 +71,9 @@ bool parseOptions (int argc, char** argv, Arguments &info)
         ("long,l", "Include extra information in archive listing.")
         ("full-path,f", "Create diretory hierarchy on file extraction "
          "(always true for extractall).")
+        ("order,o", bpo::value<std::string>(), "Write the file data in the order the files "
+         "are first opened in this resource trace (see iotrace), or listed in this text file "
+         "(one path per line). Other files follow in their original order.")
         ;
 
     // input-file is hidden and used as a positional argument
@@ -104,7 +125,9 @@ bool parseOptions (int argc, char** argv, Arguments &info)
     }
 
     info.mode = variables["mode"].as<std::string>();
-    if (!(info.mode == "list" || info.mode == "extract" || info.mode == "extractall"))
+    if (!(info.mode == "list" || info.mode == "extract" || info.mode == "extractall" ||
+        info.mode == "pack" || info.mode == "repack" || info.mode == "convert" ||
+        info.mode == "verify"))
     {
         std::cout << std::endl << "ERROR: invalid mode \"" << info.mode << "\"\n\n"
             << desc << std::endl;
@@ -122,7 +145,18 @@ bool parseOptions (int argc, char** argv, Arguments &info)
     // Default output to the working directory
     info.outdir = ".";
 
-    if (info.mode == "extract")
+    if (info.mode == "pack" || info.mode == "repack" || info.mode == "convert" ||
+        info.mode == "verify")
+    {
+        if (variables["input-file"].as< std::vector<std::string> >().size() < 2)
+        {
+            std::cout << "\nERROR: " << (info.mode == "verify" ? "source" : "output archive")
+                << " unspecified\n\n" << desc << std::endl;
+            return false;
+        }
+        info.target = variables["input-file"].as< std::vector<std::string> >()[1];
+    }
+    else if (info.mode == "extract")
     {
         if (variables["input-file"].as< std::vector<std::string> >().size() < 2)
         {
@@ -141,12 +175,19 @@ bool parseOptions (int argc, char** argv, Arguments &info)
     info.longformat = variables.count("long");
     info.fullpath = variables.count("full-path");
 
+    if (variables.count("order"))
+        info.order = variables["order"].as<std::string>();
+
     return true;
 }
 
 int list(Bsa::BSAFile& bsa, Arguments& info);
 int extract(Bsa::BSAFile& bsa, Arguments& info);
 int extractAll(Bsa::BSAFile& bsa, Arguments& info);
+int pack(Arguments& info);
+int convert(Arguments& info);
+int repack(Bsa::BSAFile& bsa, Arguments& info);
+int verify(Bsa::BSAFile& bsa, Arguments& info);
 
 int main(int argc, char** argv)
 {
@@ -154,6 +195,20 @@ int main(int argc, char** argv)
     if(!parseOptions (argc, argv, info))
         return 1;
 
+    // The input of pack and convert is not (necessarily) an archive
+    if (info.mode == "pack" || info.mode == "convert")
+    {
+        try
+        {
+            return info.mode == "pack" ? pack(info) : convert(info);
+        }
+        catch(std::exception &e)
+        {
+            std::cout << "ERROR: " << e.what() << std::endl;
+            return 2;
+        }
+    }
+
     // Open file
     Bsa::BSAFile bsa;
     try
@@ -173,6 +228,18 @@ int main(int argc, char** argv)
         return extract(bsa, info);
     else if (info.mode == "extractall")
         return extractAll(bsa, info);
+    else if (info.mode == "repack" || info.mode == "verify")
+    {
+        try
+        {
+            return info.mode == "repack" ? repack(bsa, info) : verify(bsa, info);
+        }
+        catch(std::exception &e)
+        {
+            std::cout << "ERROR: " << e.what() << std::endl;
+            return 2;
+        }
+    }
     else
     {
         std::cout << "Unsupported mode. That is not supposed to happen." << std::endl;
@@ -286,3 +353,342 @@ int extractAll(Bsa::BSAFile& bsa, Arguments& info)
 
     return 0;
 }
+
+std::string normalizePath(std::string path)
+{
+    std::transform(path.begin(), path.end(), path.begin(), &Bsa::BSAFile::normalizeChar);
+    return path;
+}
+
+/// Read the file order for pack and repack, as normalized paths
+std::vector<std::string> readOrder(const std::string& filename)
+{
+    std::vector<std::string> order;
+
+    if (VFS::TraceReader::isTrace(filename))
+    {
+        VFS::TraceReader trace(filename);
+        VFS::TraceRecord record;
+
+        while (trace.read(record))
+            if (record.mType == VFS::TraceRecord::Type_Open)
+                order.push_back(normalizePath(record.mPath));
+    }
+    else
+    {
+        bfs::ifstream in(filename);
+        if (!in)
+            throw std::runtime_error("Can't open order file " + filename);
+
+        std::string line;
+        while (std::getline(in, line))
+        {
+            // Tolerate files written on Windows
+            if (!line.empty() && line[line.size()-1] == '\r')
+                line.erase(line.size()-1);
+            if (!line.empty())
+                order.push_back(normalizePath(line));
+        }
+    }
+
+    std::cout << "Ordering by " << order.size() << " entries from " << filename << std::endl;
+
+    return order;
+}
+
+/// All files below \a dir, with their archive names ('\\' separated, lower case)
+std::vector<std::pair<std::string, std::string> > listDirectory(const bfs::path& dir)
+{
+    std::vector<std::pair<std::string, std::string> > files;
+
+    std::string prefix = dir.string();
+    size_t prefixSize = prefix.size();
+    if (prefixSize > 0 && prefix[prefixSize-1] != '/' && prefix[prefixSize-1] != '\\')
+        ++prefixSize;
+
+    for (bfs::recursive_directory_iterator iter(dir), end; iter != end; ++iter)
+    {
+        if (bfs::is_directory(*iter))
+            continue;
+
+        std::string path = iter->path().string();
+        std::string name = normalizePath(path.substr(prefixSize));
+        std::replace(name.begin(), name.end(), '/', '\\');
+
+        files.push_back(std::make_pair(name, path));
+    }
+
+    // The directory iterator order depends on the file system
+    std::sort(files.begin(), files.end());
+
+    return files;
+}
+
+int write(Bsa::BSAWriter& writer, Arguments& info, bool compressed = false)
+{
+    if (!info.order.empty())
+        writer.setOrder(readOrder(info.order));
+
+    std::cout << "Writing " << writer.getEntries().size() << " files to " << info.target << std::endl;
+
+#ifdef OPENMW_USE_LZ4
+    if (compressed)
+        Bsa::CompressedFile::write(info.target, writer.getEntries());
+    else
+#endif
+        writer.write(info.target);
+
+    return 0;
+}
+
+void addDirectory(Bsa::BSAWriter& writer, const std::string& dir)
+{
+    std::vector<std::pair<std::string, std::string> > files = listDirectory(dir);
+
+    for (size_t i = 0; i < files.size(); ++i)
+        writer.addFile(files[i].first, files[i].second);
+}
+
+bool offsetLess(const Bsa::BSAFile::FileStruct& left, const Bsa::BSAFile::FileStruct& right)
+{
+    return left.offset < right.offset;
+}
+
+void addArchive(Bsa::BSAWriter& writer, const Bsa::BSAFile& bsa, const std::string& filename)
+{
+    // Without an order, keep the data layout of the source archive
+    Bsa::BSAFile::FileList files = bsa.getList();
+    std::stable_sort(files.begin(), files.end(), offsetLess);
+
+    for (Bsa::BSAFile::FileList::const_iterator it = files.begin(); it != files.end(); ++it)
+        writer.addFile(it->name, filename, it->offset, it->fileSize);
+}
+
+bool sameFile(const std::string& left, const std::string& right)
+{
+    return bfs::exists(left) && bfs::exists(right) && bfs::equivalent(left, right);
+}
+
+int pack(Arguments& info)
+{
+    if (!bfs::is_directory(info.filename))
+    {
+        std::cout << "ERROR: " << info.filename << " is not a directory." << std::endl;
+        return 3;
+    }
+
+    Bsa::BSAWriter writer;
+    addDirectory(writer, info.filename);
+
+    return write(writer, info);
+}
+
+int repack(Bsa::BSAFile& bsa, Arguments& info)
+{
+    if (sameFile(info.filename, info.target))
+    {
+        std::cout << "ERROR: can't repack an archive onto itself." << std::endl;
+        return 3;
+    }
+
+    Bsa::BSAWriter writer;
+    addArchive(writer, bsa, info.filename);
+
+    return write(writer, info);
+}
+
+int convert(Arguments& info)
+{
+#ifndef OPENMW_USE_LZ4
+    std::cout << "ERROR: bsatool was built without LZ4, can't write compressed archives." << std::endl;
+    return 3;
+#endif
+
+    if (sameFile(info.filename, info.target))
+    {
+        std::cout << "ERROR: can't convert an archive onto itself." << std::endl;
+        return 3;
+    }
+
+    Bsa::BSAWriter writer;
+
+    if (bfs::is_directory(info.filename))
+        addDirectory(writer, info.filename);
+    else
+    {
+        Bsa::BSAFile bsa;
+        bsa.open(info.filename);
+        addArchive(writer, bsa, info.filename);
+    }
+
+    uint64_t size = 0;
+    for (Bsa::BSAWriter::EntryList::const_iterator it = writer.getEntries().begin();
+        it != writer.getEntries().end(); ++it)
+        size += it->size;
+
+    write(writer, info, true);
+
+    uint64_t compressedSize = bfs::file_size(info.target);
+    std::cout << "Compressed " << size/1024 << " KiB to " << compressedSize/1024 << " KiB";
+    if (size > 0)
+        std::cout << " (" << compressedSize*100/size << "%)";
+    std::cout << std::endl;
+
+    return 0;
+}
+
+bool compareData(const std::string& leftFile, size_t leftOffset,
+    const std::string& rightFile, size_t rightOffset, size_t size)
+{
+    LowLevelFilePtr left = openSharedLowLevelFile(leftFile.c_str());
+    LowLevelFilePtr right = openSharedLowLevelFile(rightFile.c_str());
+
+    std::vector<char> leftBuffer(64*1024);
+    std::vector<char> rightBuffer(leftBuffer.size());
+
+    for (size_t done = 0; done < size; )
+    {
+        size_t chunk = std::min(leftBuffer.size(), size - done);
+
+        if (left->readAt(&leftBuffer[0], chunk, leftOffset + done) != chunk ||
+            right->readAt(&rightBuffer[0], chunk, rightOffset + done) != chunk ||
+            !std::equal(leftBuffer.begin(), leftBuffer.begin() + chunk, rightBuffer.begin()))
+            return false;
+
+        done += chunk;
+    }
+
+    return true;
+}
+
+/// Check the hash table stored in the archive, which Morrowind relies on
+/// (OpenMW recomputes it). \return number of problems found
+int verifyHashTable(Bsa::BSAFile& bsa, Arguments& info)
+{
+    const Bsa::BSAFile::FileList& files = bsa.getList();
+
+    bfs::ifstream in(info.filename, std::ios::binary);
+    uint32_t head[3];
+    in.read(reinterpret_cast<char*>(head), 12);
+
+    std::vector<uint32_t> stored(2*files.size());
+    in.seekg(12 + head[1]);
+    if (!files.empty())
+        in.read(reinterpret_cast<char*>(&stored[0]), 8*files.size());
+
+    if (!in)
+    {
+        std::cout << "Hash table truncated" << std::endl;
+        return 1;
+    }
+
+    int errors = 0;
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        // getList() is in directory order, which is also the order of the hash table
+        if (stored[2*i] != files[i].hash.low || stored[2*i+1] != files[i].hash.high)
+        {
+            std::cout << "Wrong hash: " << files[i].name << std::endl;
+            ++errors;
+        }
+
+        if (i > 0 && (stored[2*i] < stored[2*i-2] ||
+            (stored[2*i] == stored[2*i-2] && stored[2*i+1] < stored[2*i-1])))
+        {
+            std::cout << "Hash table not sorted at: " << files[i].name << std::endl;
+            ++errors;
+        }
+    }
+
+    return errors;
+}
+
+/// Where verify finds the data of one file in the source
+struct SourceFile
+{
+    std::string name, file;
+    size_t offset, size;
+};
+
+int verify(Bsa::BSAFile& bsa, Arguments& info)
+{
+    std::vector<SourceFile> sources;
+
+    if (bfs::is_directory(info.target))
+    {
+        std::vector<std::pair<std::string, std::string> > files = listDirectory(info.target);
+
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            SourceFile source;
+            source.name = files[i].first;
+            source.file = files[i].second;
+            source.offset = 0;
+            source.size = bfs::file_size(files[i].second);
+            sources.push_back(source);
+        }
+    }
+    else
+    {
+        Bsa::BSAFile sourceBsa;
+        sourceBsa.open(info.target);
+
+        const Bsa::BSAFile::FileList& files = sourceBsa.getList();
+        for (Bsa::BSAFile::FileList::const_iterator it = files.begin(); it != files.end(); ++it)
+        {
+            SourceFile source;
+            source.name = it->name;
+            source.file = info.target;
+            source.offset = it->offset;
+            source.size = it->fileSize;
+            sources.push_back(source);
+        }
+    }
+
+    const Bsa::BSAFile::FileList& files = bsa.getList();
+    std::vector<bool> seen(files.size(), false);
+
+    int errors = verifyHashTable(bsa, info);
+
+    for (std::vector<SourceFile>::const_iterator it = sources.begin(); it != sources.end(); ++it)
+    {
+        int index = bsa.getIndex(it->name.c_str());
+
+        if (index == -1)
+        {
+            std::cout << "Missing: " << it->name << std::endl;
+            ++errors;
+            continue;
+        }
+
+        seen[index] = true;
+
+        const Bsa::BSAFile::FileStruct& file = files[index];
+
+        if (file.fileSize != it->size)
+        {
+            std::cout << "Size differs: " << it->name << " (" << file.fileSize << " instead of "
+                << it->size << " bytes)" << std::endl;
+            ++errors;
+        }
+        else if (!compareData(info.filename, file.offset, it->file, it->offset, it->size))
+        {
+            std::cout << "Data differs: " << it->name << std::endl;
+            ++errors;
+        }
+    }
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (!seen[i])
+        {
+            std::cout << "Not in source: " << files[i].name << std::endl;
+            ++errors;
+        }
+    }
+
+    std::cout << files.size() << " files checked, " << errors << " problems found" << std::endl;
+
+    return errors ? 4 : 0;
+}
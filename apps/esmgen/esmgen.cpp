@@ -0,0 +1,585 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <exception>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <components/esm/esmwriter.hpp>
+#include <components/esm/records.hpp>
+#include <components/esm/defs.hpp>
+
+#define ESMGEN_VERSION 1.0
+
+// Create a local alias for brevity
+namespace bpo = boost::program_options;
+
+// Record counts of the synthetic content at --scale 1, roughly those of Morrowind.esm
+static const int sVanillaExteriors = 1350;
+static const int sVanillaInteriors = 1200;
+static const int sVanillaReferences = 80;
+static const int sVanillaObjects = 3000;
+static const int sVanillaTopics = 2700;
+static const int sVanillaInfos = 10;
+static const int sVanillaScripts = 630;
+static const int sVanillaScriptLines = 30;
+static const int sVanillaPathgridPoints = 20;
+
+struct Arguments
+{
+    std::string outname;
+    std::string prefix;
+    std::vector<std::string> masters;
+
+    int exteriors;
+    int interiors;
+    int references;
+    int objects;
+    int topics;
+    int infos;
+    int scripts;
+    int scriptLines;
+    int pathgridPoints;
+    bool land;
+    unsigned int seed;
+
+    int countRecords() const
+    {
+        return objects + scripts + topics * (1 + infos) + exteriors + interiors
+            + (land ? exteriors : 0) + (pathgridPoints > 0 ? exteriors + interiors : 0);
+    }
+};
+
+/// Small deterministic generator, so that the same options give the same file on every platform
+class Random
+{
+    unsigned int mState;
+
+public:
+    Random(unsigned int seed) : mState(seed) {}
+
+    unsigned int next()
+    {
+        mState = mState * 1103515245 + 12345;
+        return (mState >> 16) & 0x7fff;
+    }
+
+    int range(int count)
+    {
+        return (next() << 15 | next()) % count;
+    }
+
+    float range(float min, float max)
+    {
+        return min + (max - min) * ((next() << 15 | next()) / 1073741824.f);
+    }
+};
+
+bool parseOptions (int argc, char** argv, Arguments &info)
+{
+    bpo::options_description desc("Generate synthetic content files (ESM, ESP) for loader and world benchmarks\n"
+            "Syntax: esmgen [options] outfile\n\n"
+            "The counts default to roughly those of Morrowind.esm, times --scale.\n\n"
+            "Allowed options");
+
+    double scale = 1;
+
+    desc.add_options()
+        ("help,h", "print help message.")
+        ("version,v", "print version information and quit.")
+        ("scale,s", bpo::value<double>(&scale)->default_value(1),
+         "multiply the default counts by this factor.")
+        ("exteriors", bpo::value<int>(), "number of exterior cells, on a square grid around 0, 0.")
+        ("interiors", bpo::value<int>(), "number of interior cells.")
+        ("references", bpo::value<int>(), "number of references in each cell.")
+        ("objects", bpo::value<int>(), "number of base objects (statics and activators) the references use.")
+        ("topics", bpo::value<int>(), "number of dialogue topics.")
+        ("infos", bpo::value<int>(), "number of responses (INFO records) for each topic.")
+        ("scripts", bpo::value<int>(), "number of scripts, attached to the activators.")
+        ("script-lines", bpo::value<int>(), "approximate number of lines of each script.")
+        ("pathgrid-points", bpo::value<int>(), "number of points of the path grid of each cell; 0: no path grids.")
+        ("no-land", "do not write LAND records for the exterior cells.")
+        ("master,m", bpo::value<std::vector<std::string> >()->composing(),
+         "content file the generated file depends on. May be specified multiple times.")
+        ("prefix,p", bpo::value<std::string>(&(info.prefix)),
+         "prefix of all generated IDs (defaults to the name of the output file), so that several "
+         "generated files can be loaded together.")
+        ("seed", bpo::value<unsigned int>(&(info.seed))->default_value(1), "seed of the random numbers.")
+        ;
+
+    // outfile is hidden and used as a positional argument
+    bpo::options_description hidden("Hidden Options");
+
+    hidden.add_options()
+        ( "output-file,o", bpo::value<std::string>(), "output file")
+        ;
+
+    bpo::positional_options_description p;
+    p.add("output-file", 1);
+
+    bpo::options_description all;
+    all.add(desc).add(hidden);
+
+    bpo::variables_map variables;
+    try
+    {
+        bpo::parsed_options valid_opts = bpo::command_line_parser(argc, argv)
+            .options(all).positional(p).run();
+        bpo::store(valid_opts, variables);
+    }
+    catch(std::exception &e)
+    {
+        std::cout << "ERROR parsing arguments: " << e.what() << "\n\n"
+            << desc << std::endl;
+        return false;
+    }
+
+    bpo::notify(variables);
+
+    if (variables.count ("help"))
+    {
+        std::cout << desc << std::endl;
+        return false;
+    }
+    if (variables.count ("version"))
+    {
+        std::cout << "ESMGen version " << ESMGEN_VERSION << std::endl;
+        return false;
+    }
+    if (!variables.count("output-file"))
+    {
+        std::cout << "\nERROR: missing output file\n\n"
+            << desc << std::endl;
+        return false;
+    }
+    info.outname = variables["output-file"].as<std::string>();
+
+    if (scale < 0)
+    {
+        std::cout << "ERROR: negative scale" << std::endl;
+        return false;
+    }
+
+    const char *names[] = { "exteriors", "interiors", "references", "objects", "topics", "infos",
+        "scripts", "script-lines", "pathgrid-points" };
+    int *counts[] = { &info.exteriors, &info.interiors, &info.references, &info.objects, &info.topics,
+        &info.infos, &info.scripts, &info.scriptLines, &info.pathgridPoints };
+    const int defaults[] = { sVanillaExteriors, sVanillaInteriors, sVanillaReferences,
+        sVanillaObjects, sVanillaTopics, sVanillaInfos, sVanillaScripts, sVanillaScriptLines,
+        sVanillaPathgridPoints };
+    // Only the number of records grows with the scale, not their size
+    const bool scaled[] = { true, true, false, true, true, false, true, false, false };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        if (variables.count(names[i]))
+            *counts[i] = variables[names[i]].as<int>();
+        else
+            *counts[i] = scaled[i] ? static_cast<int>(defaults[i] * scale + 0.5) : defaults[i];
+
+        if (*counts[i] < 0)
+        {
+            std::cout << "ERROR: negative " << names[i] << std::endl;
+            return false;
+        }
+    }
+
+    if (info.objects == 0 && info.references > 0)
+    {
+        std::cout << "ERROR: references need objects" << std::endl;
+        return false;
+    }
+
+    info.land = !variables.count("no-land");
+
+    if (variables.count("master"))
+        info.masters = variables["master"].as< std::vector<std::string> >();
+
+    if (info.prefix.empty())
+        info.prefix = boost::filesystem::path(info.outname).stem().string();
+
+    return true;
+}
+
+std::string makeId(const Arguments& info, const char *kind, int index)
+{
+    std::ostringstream stream;
+    stream << info.prefix << "_" << kind << "_" << index;
+    return stream.str();
+}
+
+std::string makeScriptId(const Arguments& info, int index)
+{
+    // Script IDs are stored in a 32 byte field
+    std::string id = makeId(info, "scr", index);
+    if (id.size() > 31)
+        id = id.substr(id.size() - 31);
+    return id;
+}
+
+void writeObjects(ESM::ESMWriter& esm, const Arguments& info)
+{
+    for (int i = 0; i < info.objects; ++i)
+    {
+        // Every tenth object is an activator with a script
+        if (i % 10 == 0 && info.scripts > 0)
+        {
+            ESM::Activator activator;
+            activator.mId = makeId(info, "acti", i);
+            activator.mName = "Generated Activator " + activator.mId;
+            activator.mModel = "m\\misc_com_bucket_01.nif";
+            activator.mScript = makeScriptId(info, (i / 10) % info.scripts);
+
+            esm.startRecord("ACTI");
+            esm.writeHNCString("NAME", activator.mId);
+            activator.save(esm);
+            esm.endRecord("ACTI");
+        }
+        else
+        {
+            ESM::Static object;
+            object.mModel = "x\\ex_common_house_01.nif";
+
+            esm.startRecord("STAT");
+            esm.writeHNCString("NAME", makeId(info, "stat", i));
+            object.save(esm);
+            esm.endRecord("STAT");
+        }
+    }
+}
+
+std::string getObjectId(const Arguments& info, int index)
+{
+    return makeId(info, index % 10 == 0 && info.scripts > 0 ? "acti" : "stat", index);
+}
+
+void writeScripts(ESM::ESMWriter& esm, const Arguments& info)
+{
+    for (int i = 0; i < info.scripts; ++i)
+    {
+        ESM::Script script;
+        script.mId = makeScriptId(info, i);
+
+        script.mVarNames.push_back("state");
+        script.mVarNames.push_back("counter");
+        script.mVarNames.push_back("timer");
+        script.mData.mNumShorts = 2;
+        script.mData.mNumLongs = 0;
+        script.mData.mNumFloats = 1;
+        script.mData.mStringTableSize = 0;
+        for (size_t j = 0; j < script.mVarNames.size(); ++j)
+            script.mData.mStringTableSize += script.mVarNames[j].size() + 1;
+
+        // The engine compiles the text; the byte code is not used
+        script.mScriptData.resize(4);
+        script.mData.mScriptDataSize = script.mScriptData.size();
+
+        std::ostringstream text;
+        text << "Begin " << script.mId << "\r\n\r\n"
+             << "short state\r\nshort counter\r\nfloat timer\r\n\r\n"
+             << "set timer to ( timer + GetSecondsPassed )\r\n";
+
+        for (int line = 7; line < info.scriptLines; line += 5)
+        {
+            text << "if ( timer > " << (line % 17) + 1 << " )\r\n"
+                 << "    set counter to ( counter + " << line << " )\r\n"
+                 << "    set timer to 0\r\n"
+                 << "endif\r\n\r\n";
+        }
+
+        text << "End " << script.mId << "\r\n";
+        script.mScriptText = text.str();
+
+        esm.startRecord("SCPT");
+        script.save(esm);
+        esm.endRecord("SCPT");
+    }
+}
+
+void writeDialogue(ESM::ESMWriter& esm, const Arguments& info, Random& random)
+{
+    static const char *words[] = { "Vivec", "ash", "storm", "guild", "Balmora", "silt", "strider",
+        "House", "Hlaalu", "trade", "Dwemer", "ruins", "scrib", "jelly", "Fargoth", "ring" };
+    const int wordCount = sizeof(words) / sizeof(words[0]);
+
+    int infoIndex = 0;
+
+    for (int i = 0; i < info.topics; ++i)
+    {
+        ESM::Dialogue dialogue;
+        dialogue.mId = makeId(info, "topic", i);
+        dialogue.mType = ESM::Dialogue::Topic;
+
+        esm.startRecord("DIAL");
+        esm.writeHNCString("NAME", dialogue.mId);
+        dialogue.save(esm);
+        esm.endRecord("DIAL");
+
+        for (int j = 0; j < info.infos; ++j, ++infoIndex)
+        {
+            ESM::DialInfo response;
+            response.blank();
+            response.mId = makeId(info, "info", infoIndex);
+            if (j > 0)
+                response.mPrev = makeId(info, "info", infoIndex - 1);
+            if (j + 1 < info.infos)
+                response.mNext = makeId(info, "info", infoIndex + 1);
+
+            response.mData.mDisposition = random.range(100);
+            response.mData.mRank = -1;
+            response.mData.mGender = ESM::DialInfo::NA;
+            response.mData.mPCrank = -1;
+
+            std::ostringstream text;
+            int length = 10 + random.range(40);
+            for (int k = 0; k < length; ++k)
+                text << (k ? " " : "") << words[random.range(wordCount)];
+            text << ".";
+            response.mResponse = text.str();
+
+            esm.startRecord("INFO");
+            esm.writeHNCString("INAM", response.mId);
+            response.save(esm);
+            esm.endRecord("INFO");
+        }
+    }
+}
+
+void writeLand(ESM::ESMWriter& esm, int x, int y, ESM::Land::LandData& data, Random& random)
+{
+    ESM::Land land;
+    land.mX = x;
+    land.mY = y;
+    land.mFlags = 1;
+
+    esm.startRecord("LAND");
+    land.save(esm);
+
+    // Gentle hills, continuous across cells
+    for (int row = 0; row < ESM::Land::LAND_SIZE; ++row)
+        for (int column = 0; column < ESM::Land::LAND_SIZE; ++column)
+        {
+            float worldX = x + column / float(ESM::Land::LAND_SIZE - 1);
+            float worldY = y + row / float(ESM::Land::LAND_SIZE - 1);
+            data.mHeights[row * ESM::Land::LAND_SIZE + column] =
+                std::floor((std::sin(worldX * 1.3f) + std::cos(worldY * 0.7f)) * 256) * ESM::Land::HEIGHT_SCALE;
+        }
+
+    for (int i = 0; i < ESM::Land::LAND_NUM_VERTS; ++i)
+    {
+        data.mNormals[i * 3] = 0;
+        data.mNormals[i * 3 + 1] = 0;
+        data.mNormals[i * 3 + 2] = 127;
+    }
+
+    for (int i = 0; i < ESM::Land::LAND_NUM_TEXTURES; ++i)
+        data.mTextures[i] = 0; // default texture
+
+    for (int i = 0; i < 81; ++i)
+        data.mWnam[i] = random.range(256);
+
+    data.mHeightOffset = data.mHeights[0] / ESM::Land::HEIGHT_SCALE;
+    data.mUnk1 = 0;
+    data.mUnk2 = 0;
+    data.mUsingColours = false;
+    data.mDataTypes = ESM::Land::DATA_VNML | ESM::Land::DATA_VHGT | ESM::Land::DATA_WNAM
+        | ESM::Land::DATA_VTEX;
+    data.save(esm);
+
+    esm.endRecord("LAND");
+}
+
+void writePathgrid(ESM::ESMWriter& esm, const Arguments& info, const ESM::Cell& cell,
+    float originX, float originY, Random& random)
+{
+    ESM::Pathgrid pathgrid;
+    pathgrid.mData.mX = cell.isExterior() ? cell.getGridX() : 0;
+    pathgrid.mData.mY = cell.isExterior() ? cell.getGridY() : 0;
+    pathgrid.mData.mS1 = 128;
+    pathgrid.mData.mS2 = info.pathgridPoints;
+    pathgrid.mCell = cell.mName;
+
+    // A chain of points, each connected to its neighbours
+    for (int i = 0; i < info.pathgridPoints; ++i)
+    {
+        ESM::Pathgrid::Point point;
+        point.mX = static_cast<int>(originX + random.range(ESM::Land::REAL_SIZE));
+        point.mY = static_cast<int>(originY + random.range(ESM::Land::REAL_SIZE));
+        point.mZ = 0;
+        point.mAutogenerated = 0;
+        point.mConnectionNum = (i > 0) + (i + 1 < info.pathgridPoints);
+        point.mUnknown = 0;
+        pathgrid.mPoints.push_back(point);
+
+        ESM::Pathgrid::Edge edge;
+        edge.mV0 = i;
+        if (i > 0)
+        {
+            edge.mV1 = i - 1;
+            pathgrid.mEdges.push_back(edge);
+        }
+        if (i + 1 < info.pathgridPoints)
+        {
+            edge.mV1 = i + 1;
+            pathgrid.mEdges.push_back(edge);
+        }
+    }
+
+    esm.startRecord("PGRD");
+    pathgrid.save(esm);
+    esm.endRecord("PGRD");
+}
+
+void writeCells(ESM::ESMWriter& esm, const Arguments& info, Random& random)
+{
+    boost::scoped_ptr<ESM::Land::LandData> landData(new ESM::Land::LandData);
+
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(info.exteriors))));
+    int refIndex = 0;
+
+    for (int i = 0; i < info.exteriors + info.interiors; ++i)
+    {
+        bool exterior = i < info.exteriors;
+
+        ESM::Cell cell;
+        cell.mData.mX = exterior ? i % side - side / 2 : 0;
+        cell.mData.mY = exterior ? i / side - side / 2 : 0;
+        cell.mNAM0 = 0;
+
+        if (exterior)
+        {
+            cell.mData.mFlags = ESM::Cell::HasWater;
+            cell.mMapColor = 0;
+        }
+        else
+        {
+            std::ostringstream name;
+            name << info.prefix << " Interior " << i - info.exteriors;
+            cell.mName = name.str();
+            cell.mData.mFlags = ESM::Cell::Interior;
+            cell.mAmbi.mAmbient = 0x404040;
+            cell.mAmbi.mSunlight = 0x808080;
+            cell.mAmbi.mFog = 0x202020;
+            cell.mAmbi.mFogDensity = 0.5f;
+        }
+
+        float originX = exterior ? cell.mData.mX * float(ESM::Land::REAL_SIZE) : 0;
+        float originY = exterior ? cell.mData.mY * float(ESM::Land::REAL_SIZE) : 0;
+
+        esm.startRecord("CELL");
+        esm.writeHNCString("NAME", cell.mName);
+        cell.save(esm);
+
+        for (int j = 0; j < info.references; ++j)
+        {
+            ESM::CellRef ref;
+            ref.mRefNum.mIndex = ++refIndex;
+            ref.mRefNum.mContentFile = -1;
+            ref.mRefID = getObjectId(info, random.range(info.objects));
+            ref.mScale = 1;
+            ref.mFactIndex = -2;
+            ref.mEnchantmentCharge = -1;
+            ref.mCharge = -1;
+            ref.mGoldValue = 1;
+            ref.mTeleport = false;
+            ref.mLockLevel = -1;
+            ref.mReferenceBlocked = -1;
+            ref.mFltv = 0;
+            ref.mNam0 = 0;
+            ref.mPos.pos[0] = originX + random.range(0.f, float(ESM::Land::REAL_SIZE));
+            ref.mPos.pos[1] = originY + random.range(0.f, float(ESM::Land::REAL_SIZE));
+            ref.mPos.pos[2] = random.range(0.f, 512.f);
+            ref.mPos.rot[0] = 0;
+            ref.mPos.rot[1] = 0;
+            ref.mPos.rot[2] = random.range(0.f, 6.2831853f);
+            ref.save(esm);
+        }
+
+        esm.endRecord("CELL");
+
+        if (exterior && info.land)
+            writeLand(esm, cell.mData.mX, cell.mData.mY, *landData, random);
+
+        if (info.pathgridPoints > 0)
+            writePathgrid(esm, info, cell, originX, originY, random);
+
+        // Keep the memory use independent of the file size
+        esm.flush();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Arguments info;
+    if(!parseOptions (argc, argv, info))
+        return 1;
+
+    try
+    {
+        boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+        std::ofstream file(info.outname.c_str(), std::ios::binary);
+        if (!file)
+            throw std::runtime_error("can not open " + info.outname);
+
+        Random random(info.seed);
+
+        std::ostringstream description;
+        description << "Synthetic content: " << info.exteriors << " exterior and " << info.interiors
+                    << " interior cells with " << info.references << " references each";
+
+        ESM::ESMWriter esm;
+        esm.setVersion();
+        esm.setAuthor("esmgen");
+        esm.setDescription(description.str());
+        esm.setRecordCount(info.countRecords());
+
+        for (std::vector<std::string>::const_iterator it = info.masters.begin(); it != info.masters.end(); ++it)
+        {
+            boost::system::error_code error;
+            boost::uintmax_t size = boost::filesystem::file_size(*it, error);
+            esm.addMaster(boost::filesystem::path(*it).filename().string(), error ? 0 : size);
+        }
+
+        esm.save(file);
+
+        writeObjects(esm, info);
+        writeScripts(esm, info);
+        writeDialogue(esm, info, random);
+        esm.flush();
+        writeCells(esm, info, random);
+
+        esm.close();
+        file.close();
+
+        if (!file)
+            throw std::runtime_error("failed to write " + info.outname);
+
+        double elapsed = (boost::posix_time::microsec_clock::universal_time() - start)
+            .total_milliseconds() / 1000.0;
+
+        std::cout << "Wrote " << info.outname << ": " << info.countRecords() << " records, "
+                  << boost::filesystem::file_size(info.outname) / 1024 << " KiB in "
+                  << std::fixed << std::setprecision(2) << elapsed << " s" << std::endl
+                  << "  " << info.objects << " objects, " << info.scripts << " scripts, "
+                  << info.topics << " topics with " << info.infos << " responses each" << std::endl
+                  << "  " << info.exteriors << " exterior cells" << (info.land ? " with land" : "")
+                  << ", " << info.interiors << " interior cells, " << info.references
+                  << " references per cell, " << info.pathgridPoints << " path grid points per cell"
+                  << std::endl;
+    }
+    catch(std::exception &e)
+    {
+        std::cout << "ERROR: " << e.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
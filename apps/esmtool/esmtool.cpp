@@ -1,15 +1,21 @@
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
 #include <vector>
 #include <deque>
 #include <list>
 #include <map>
 #include <set>
+#include <fstream>
 
 #include <boost/program_options.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
 #include <components/esm/records.hpp>
+#include <components/misc/allocations.hpp>
 
 #include "record.hpp"
 
@@ -57,6 +63,9 @@ struct Arguments
     std::string encoding;
     std::string filename;
     std::string outname;
+    std::vector<std::string> inputs;
+    std::string csvname;
+    std::string jsonname;
 
     std::vector<std::string> types;
 
@@ -67,7 +76,7 @@ struct Arguments
 
 bool parseOptions (int argc, char** argv, Arguments &info)
 {
-    bpo::options_description desc("Inspect and extract from Morrowind ES files (ESM, ESP, ESS)\nSyntax: esmtool [options] mode infile [outfile]\nAllowed modes:\n  dump\t Dumps all readable data from the input file.\n  clone\t Clones the input file to the output file.\n  comp\t Compares the given files.\n\nAllowed options");
+    bpo::options_description desc("Inspect and extract from Morrowind ES files (ESM, ESP, ESS)\nSyntax: esmtool [options] mode infile [outfile]\nAllowed modes:\n  dump\t Dumps all readable data from the input file.\n  clone\t Clones the input file to the output file.\n  comp\t Compares the given files.\n  profile Parses the given files and reports parse statistics for each record type.\n\nAllowed options");
 
     desc.add_options()
         ("help,h", "print help message.")
@@ -83,6 +92,10 @@ bool parseOptions (int argc, char** argv, Arguments &info)
          "Only affects dump mode.")
         ("quiet,q", "Supress all record information. Useful for speed tests.")
         ("loadcells,C", "Browse through contents of all cells.")
+        ("csv", bpo::value<std::string>(&(info.csvname)),
+         "Write the statistics of profile mode to this CSV file.")
+        ("json", bpo::value<std::string>(&(info.jsonname)),
+         "Write the statistics of profile mode to this JSON file.")
 
         ( "encoding,e", bpo::value<std::string>(&(info.encoding))->
           default_value("win1252"),
@@ -103,7 +116,7 @@ bool parseOptions (int argc, char** argv, Arguments &info)
         ;
 
     bpo::positional_options_description p;
-    p.add("mode", 1).add("input-file", 2);
+    p.add("mode", 1).add("input-file", -1);
 
     // there might be a better way to do this
     bpo::options_description all;
@@ -151,7 +164,7 @@ bool parseOptions (int argc, char** argv, Arguments &info)
       info.types = variables["type"].as< std::vector<std::string> >();
 
     info.mode = variables["mode"].as<std::string>();
-    if (!(info.mode == "dump" || info.mode == "clone" || info.mode == "comp"))
+    if (!(info.mode == "dump" || info.mode == "clone" || info.mode == "comp" || info.mode == "profile"))
     {
         std::cout << std::endl << "ERROR: invalid mode \"" << info.mode << "\"" << std::endl << std::endl
                   << desc << finalText << std::endl;
@@ -173,6 +186,14 @@ bool parseOptions (int argc, char** argv, Arguments &info)
       return false;
       }*/
 
+    info.inputs = variables["input-file"].as< std::vector<std::string> >();
+    if (info.mode != "profile" && info.inputs.size() > 2)
+    {
+        std::cout << "\nERROR: too many ES files specified\n\n";
+        std::cout << desc << finalText << std::endl;
+        return false;
+    }
+
     info.filename = variables["input-file"].as< std::vector<std::string> >()[0];
     if (variables["input-file"].as< std::vector<std::string> >().size() > 1)
         info.outname = variables["input-file"].as< std::vector<std::string> >()[1];
@@ -200,6 +221,7 @@ void loadCell(ESM::Cell &cell, ESM::ESMReader &esm, Arguments& info);
 int load(Arguments& info);
 int clone(Arguments& info);
 int comp(Arguments& info);
+int profile(Arguments& info);
 
 int main(int argc, char**argv)
 {
@@ -213,6 +235,8 @@ int main(int argc, char**argv)
         return clone(info);
     else if (info.mode == "comp")
         return comp(info);
+    else if (info.mode == "profile")
+        return profile(info);
     else
     {
         std::cout << "Invalid or no mode specified, dying horribly. Have a nice day." << std::endl;
@@ -224,7 +248,7 @@ int main(int argc, char**argv)
 
 void loadCell(ESM::Cell &cell, ESM::ESMReader &esm, Arguments& info)
 {
-    bool quiet = (info.quiet_given || info.mode == "clone");
+    bool quiet = (info.quiet_given || info.mode == "clone" || info.mode == "profile");
     bool save = (info.mode == "clone");
 
     // Skip back to the beginning of the reference list
@@ -557,5 +581,262 @@ int comp(Arguments& info)
 
 
 
+    return 0;
+}
+
+struct RecordProfile
+{
+    size_t count;
+    uint64_t bytes;
+    double time;
+    size_t allocations;
+    size_t memory;
+    size_t peak;
+
+    RecordProfile() : count(0), bytes(0), time(0), allocations(0), memory(0), peak(0) {}
+
+    void add(const RecordProfile& profile)
+    {
+        count += profile.count;
+        bytes += profile.bytes;
+        time += profile.time;
+        allocations += profile.allocations;
+        memory += profile.memory;
+        peak = std::max(peak, profile.peak);
+    }
+};
+
+typedef std::map<std::string, RecordProfile> RecordProfiles;
+
+bool slowerThan(const RecordProfiles::value_type *left, const RecordProfiles::value_type *right)
+{
+    return left->second.time > right->second.time;
+}
+
+std::string csvField(const std::string& text)
+{
+    if (text.find_first_of(",\"\n") == std::string::npos)
+        return text;
+
+    std::string field = "\"";
+    for (std::string::const_iterator it = text.begin(); it != text.end(); ++it)
+    {
+        if (*it == '"')
+            field += '"';
+        field += *it;
+    }
+    return field + "\"";
+}
+
+std::string jsonString(const std::string& text)
+{
+    std::ostringstream stream;
+    stream << '"';
+    for (std::string::const_iterator it = text.begin(); it != text.end(); ++it)
+    {
+        unsigned char c = *it;
+        if (c == '"' || c == '\\')
+            stream << '\\' << *it;
+        else if (c < 0x20 || c >= 0x7f)
+            stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                   << std::dec << std::setfill(' ');
+        else
+            stream << *it;
+    }
+    stream << '"';
+    return stream.str();
+}
+
+void writeProfileCsv(const std::string& filename, const std::vector<const RecordProfiles::value_type *>& types,
+    const RecordProfile& total)
+{
+    std::ofstream file(filename.c_str());
+
+    file << "type,count,bytes,time_ms,allocations,memory_bytes,peak_bytes" << std::endl;
+
+    for (size_t i = 0; i <= types.size(); ++i)
+    {
+        const std::string& type = i < types.size() ? types[i]->first : "total";
+        const RecordProfile& profile = i < types.size() ? types[i]->second : total;
+
+        file << csvField(type) << "," << profile.count << "," << profile.bytes << ","
+             << std::fixed << std::setprecision(3) << profile.time * 1000 << ","
+             << profile.allocations << "," << profile.memory << "," << profile.peak << std::endl;
+    }
+
+    if (!file)
+        throw std::runtime_error("failed to write " + filename);
+}
+
+void writeProfileJson(const std::string& filename, const std::vector<std::string>& inputs,
+    const std::vector<const RecordProfiles::value_type *>& types, const RecordProfile& total,
+    size_t heapPeak)
+{
+    std::ofstream file(filename.c_str());
+
+    file << "{\n  \"files\": [";
+    for (size_t i = 0; i < inputs.size(); ++i)
+        file << (i ? ", " : "") << jsonString(inputs[i]);
+    file << "],\n  \"heap_peak_bytes\": " << heapPeak << ",\n  \"types\": [\n";
+
+    for (size_t i = 0; i <= types.size(); ++i)
+    {
+        const RecordProfile& profile = i < types.size() ? types[i]->second : total;
+
+        if (i == types.size())
+            file << "\n  ],\n  \"total\": ";
+        else
+            file << (i ? ",\n    " : "    ") << "{\"type\": " << jsonString(types[i]->first) << ", ";
+
+        if (i == types.size())
+            file << "{";
+
+        file << "\"count\": " << profile.count << ", \"bytes\": " << profile.bytes
+             << ", \"time_ms\": " << std::fixed << std::setprecision(3) << profile.time * 1000
+             << ", \"allocations\": " << profile.allocations << ", \"memory_bytes\": " << profile.memory
+             << ", \"peak_bytes\": " << profile.peak << "}";
+    }
+
+    file << "\n}" << std::endl;
+
+    if (!file)
+        throw std::runtime_error("failed to write " + filename);
+}
+
+int profile(Arguments& info)
+{
+    ToUTF8::Utf8Encoder encoder (ToUTF8::calculateEncoding(info.encoding));
+
+    RecordProfiles profiles;
+    std::deque<EsmTool::RecordBase *> records; // kept, like the game keeps its content
+    size_t heapPeak = 0;
+
+    Misc::Allocations::enable();
+
+    if (!Misc::Allocations::isSupported())
+        std::cout << "Allocations are not counted on this platform" << std::endl;
+
+    try
+    {
+        for (std::vector<std::string>::const_iterator it = info.inputs.begin(); it != info.inputs.end(); ++it)
+        {
+            std::cout << "Loading file: " << *it << std::endl;
+
+            ESM::ESMReader esm;
+            esm.setEncoder(&encoder);
+            esm.open(*it);
+
+            while(esm.hasMoreRecs())
+            {
+                uint64_t offset = esm.getOffset();
+                size_t allocations = Misc::Allocations::getCount();
+                size_t memory = Misc::Allocations::getCurrent();
+                Misc::Allocations::resetPeak();
+                boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+                ESM::NAME n = esm.getRecName();
+                uint32_t flags;
+                esm.getRecHeader(flags);
+
+                EsmTool::RecordBase *record = EsmTool::RecordBase::create(n);
+
+                if (record == 0)
+                    esm.skipRecord();
+                else
+                {
+                    std::string id = esm.getHNOString("NAME");
+                    if (id.empty())
+                        id = esm.getHNOString("INAM");
+
+                    if (record->getType().val == ESM::REC_GMST) {
+                        // preset id for GameSetting record
+                        record->cast<ESM::GameSetting>()->get().mId = id;
+                    }
+                    record->setId(id);
+                    record->setFlags((int) flags);
+                    record->load(esm);
+
+                    if (record->getType().val == ESM::REC_CELL && info.loadcells_given)
+                        loadCell(record->cast<ESM::Cell>()->get(), esm, info);
+                }
+
+                boost::posix_time::time_duration elapsed =
+                    boost::posix_time::microsec_clock::universal_time() - start;
+
+                RecordProfile recordProfile;
+                recordProfile.count = 1;
+                recordProfile.bytes = esm.getOffset() - offset;
+                recordProfile.time = elapsed.total_microseconds() / 1000000.0;
+                recordProfile.allocations = Misc::Allocations::getCount() - allocations;
+                // parsing may free memory allocated before (e.g. by growing a buffer)
+                recordProfile.memory = std::max(Misc::Allocations::getCurrent(), memory) - memory;
+                recordProfile.peak = Misc::Allocations::getPeak() - memory;
+
+                heapPeak = std::max(heapPeak, Misc::Allocations::getPeak());
+
+                if (record != 0)
+                    records.push_back(record);
+
+                profiles[n.toString()].add(recordProfile);
+            }
+        }
+    }
+    catch(std::exception &e)
+    {
+        std::cout << "\nERROR:\n\n  " << e.what() << std::endl;
+
+        for (std::deque<EsmTool::RecordBase *>::iterator it = records.begin(); it != records.end(); ++it)
+            delete *it;
+        return 1;
+    }
+
+    std::vector<const RecordProfiles::value_type *> types;
+    RecordProfile total;
+    for (RecordProfiles::const_iterator it = profiles.begin(); it != profiles.end(); ++it)
+    {
+        types.push_back(&*it);
+        total.add(it->second);
+    }
+    std::stable_sort(types.begin(), types.end(), slowerThan);
+
+    std::cout << std::endl
+              << "Type      Count       Bytes   Time (ms)  Allocations  Memory (KiB)  Peak (KiB)" << std::endl;
+
+    for (size_t i = 0; i <= types.size(); ++i)
+    {
+        const std::string& type = i < types.size() ? types[i]->first : "Total";
+        const RecordProfile& profile = i < types.size() ? types[i]->second : total;
+
+        std::cout << std::left << std::setw(6) << type << std::right
+                  << std::setw(9) << profile.count
+                  << std::setw(12) << profile.bytes
+                  << std::setw(12) << std::fixed << std::setprecision(3) << profile.time * 1000
+                  << std::setw(13) << profile.allocations
+                  << std::setw(14) << profile.memory / 1024
+                  << std::setw(12) << profile.peak / 1024 << std::endl;
+    }
+
+    std::cout << std::endl << "Heap peak: " << heapPeak / 1024 << " KiB";
+    if (total.time > 0)
+        std::cout << ", " << std::setprecision(1) << total.bytes / total.time / (1024 * 1024) << " MiB/s";
+    std::cout << std::endl;
+
+    for (std::deque<EsmTool::RecordBase *>::iterator it = records.begin(); it != records.end(); ++it)
+        delete *it;
+
+    try
+    {
+        if (!info.csvname.empty())
+            writeProfileCsv(info.csvname, types, total);
+
+        if (!info.jsonname.empty())
+            writeProfileJson(info.jsonname, info.inputs, types, total, heapPeak);
+    }
+    catch(std::exception &e)
+    {
+        std::cout << "\nERROR:\n\n  " << e.what() << std::endl;
+        return 1;
+    }
+
     return 0;
 }
@@ -0,0 +1,391 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+#include <exception>
+
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <OgreTimer.h>
+
+#include <components/bsa/compressed_file.hpp>
+#include <components/files/constrainedfiledatastream.hpp>
+#include <components/vfs/index.hpp>
+#include <components/vfs/tracer.hpp>
+
+#define IOTRACE_VERSION 1.0
+
+// Create local aliases for brevity
+namespace bpo = boost::program_options;
+
+struct Arguments
+{
+    std::string mode;
+    std::string filename;
+
+    std::vector<std::string> dataDirs;
+    std::vector<std::string> archives;
+
+    bool fsStrict;
+    bool memoryMapped;
+    bool realtime;
+};
+
+bool parseOptions (int argc, char** argv, Arguments &info)
+{
+    bpo::options_description desc("Inspect and replay resource I/O traces written by OpenMW\n"
+            "(see the \"resource trace\" setting)\n\n"
+            "Usages:\n"
+            "  iotrace dump tracefile\n"
+            "      Print all records of the trace.\n\n"
+            "  iotrace replay [-r] tracefile\n"
+            "      Re-issue the recorded opens and reads against the files recorded in the trace.\n\n"
+            "  iotrace replay [-r] [--data dir]... [--archive file]... tracefile\n"
+            "      Re-issue the recorded opens and reads by path against a different set of data\n"
+            "      directories and BSA archives.\n\n"
+            "Allowed options");
+
+    desc.add_options()
+        ("help,h", "print help message.")
+        ("version,v", "print version information and quit.")
+        ("data", bpo::value<std::vector<std::string> >()->composing(),
+         "data directory to replay against, in load order.")
+        ("archive", bpo::value<std::vector<std::string> >()->composing(),
+         "BSA archive to replay against, in load order (archives are loaded before data directories).")
+        ("fs-strict", "strict file system handling (no case folding) with --data.")
+        ("mmap", "memory map the archives given with --archive.")
+        ("realtime,r", "wait between operations to reproduce the recorded timing.")
+        ;
+
+    // input-file is hidden and used as a positional argument
+    bpo::options_description hidden("Hidden Options");
+
+    hidden.add_options()
+        ( "mode,m", bpo::value<std::string>(), "iotrace mode")
+        ( "input-file,i", bpo::value< std::vector<std::string> >(), "input file")
+        ;
+
+    bpo::positional_options_description p;
+    p.add("mode", 1).add("input-file", 1);
+
+    bpo::options_description all;
+    all.add(desc).add(hidden);
+
+    bpo::variables_map variables;
+    try
+    {
+        bpo::parsed_options valid_opts = bpo::command_line_parser(argc, argv)
+            .options(all).positional(p).run();
+        bpo::store(valid_opts, variables);
+    }
+    catch(std::exception &e)
+    {
+        std::cout << "ERROR parsing arguments: " << e.what() << "\n\n"
+            << desc << std::endl;
+        return false;
+    }
+
+    bpo::notify(variables);
+
+    if (variables.count ("help"))
+    {
+        std::cout << desc << std::endl;
+        return false;
+    }
+    if (variables.count ("version"))
+    {
+        std::cout << "IOTrace version " << IOTRACE_VERSION << std::endl;
+        return false;
+    }
+    if (!variables.count("mode"))
+    {
+        std::cout << "ERROR: no mode specified!\n\n"
+            << desc << std::endl;
+        return false;
+    }
+
+    info.mode = variables["mode"].as<std::string>();
+    if (!(info.mode == "dump" || info.mode == "replay"))
+    {
+        std::cout << std::endl << "ERROR: invalid mode \"" << info.mode << "\"\n\n"
+            << desc << std::endl;
+        return false;
+    }
+
+    if (!variables.count("input-file"))
+    {
+        std::cout << "\nERROR: missing trace file\n\n"
+            << desc << std::endl;
+        return false;
+    }
+    info.filename = variables["input-file"].as< std::vector<std::string> >()[0];
+
+    if (variables.count("data"))
+        info.dataDirs = variables["data"].as< std::vector<std::string> >();
+    if (variables.count("archive"))
+        info.archives = variables["archive"].as< std::vector<std::string> >();
+
+    info.fsStrict = variables.count("fs-strict");
+    info.memoryMapped = variables.count("mmap");
+    info.realtime = variables.count("realtime");
+
+    return true;
+}
+
+int dump(VFS::TraceReader& trace, Arguments& info);
+int replay(VFS::TraceReader& trace, Arguments& info);
+
+int main(int argc, char** argv)
+{
+    Arguments info;
+    if(!parseOptions (argc, argv, info))
+        return 1;
+
+    try
+    {
+        VFS::TraceReader trace (info.filename);
+
+        if (info.mode == "dump")
+            return dump(trace, info);
+        else if (info.mode == "replay")
+            return replay(trace, info);
+        else
+        {
+            std::cout << "Unsupported mode. That is not supposed to happen." << std::endl;
+            return 1;
+        }
+    }
+    catch(std::exception &e)
+    {
+        std::cout << "ERROR: " << e.what() << std::endl;
+        return 2;
+    }
+}
+
+int dump(VFS::TraceReader& trace, Arguments& info)
+{
+    VFS::TraceRecord record;
+
+    while (trace.read (record))
+    {
+        switch (record.mType)
+        {
+            case VFS::TraceRecord::Type_Source:
+
+                std::cout << "source " << record.mId << " " << record.mPath << std::endl;
+                break;
+
+            case VFS::TraceRecord::Type_Open:
+
+                std::cout
+                    << std::setw(12) << record.mTime << " open  #" << record.mId << " " << record.mPath
+                    << " (source " << record.mSource << " @ " << record.mOffset << ", "
+                    << record.mSize << " bytes) " << record.mDuration << " us" << std::endl;
+                break;
+
+            case VFS::TraceRecord::Type_Read:
+
+                std::cout
+                    << std::setw(12) << record.mTime << " read  #" << record.mId << " @ "
+                    << record.mOffset << ": " << record.mResult << "/" << record.mSize << " bytes "
+                    << record.mDuration << " us" << std::endl;
+                break;
+
+            case VFS::TraceRecord::Type_Close:
+
+                std::cout << std::setw(12) << record.mTime << " close #" << record.mId << std::endl;
+                break;
+        }
+    }
+
+    return 0;
+}
+
+/// Totals of either the recorded or the replayed operations
+struct Totals
+{
+    int mOpens;
+    int mReads;
+    uint64_t mBytes;
+    uint64_t mOpenTime;
+    uint64_t mReadTime;
+    uint32_t mMaxRead;
+
+    Totals() : mOpens (0), mReads (0), mBytes (0), mOpenTime (0), mReadTime (0), mMaxRead (0) {}
+
+    void addRead (size_t bytes, uint32_t duration)
+    {
+        ++mReads;
+        mBytes += bytes;
+        mReadTime += duration;
+        mMaxRead = std::max (mMaxRead, duration);
+    }
+
+    void print (const char *name) const
+    {
+        std::cout
+            << name << ": " << mOpens << " opens in " << mOpenTime/1000 << " ms, "
+            << mReads << " reads of " << mBytes/1024 << " KiB in " << mReadTime/1000 << " ms (mean "
+            << (mReads ? mReadTime/mReads : 0) << " us, max " << mMaxRead << " us)" << std::endl;
+    }
+};
+
+int replay(VFS::TraceReader& trace, Arguments& info)
+{
+    // Without --data or --archive, reads go to the files and offsets recorded in the trace.
+    std::auto_ptr<VFS::Index> index;
+
+    if (!info.dataDirs.empty() || !info.archives.empty())
+    {
+        index.reset (new VFS::Index (info.fsStrict));
+
+        for (std::vector<std::string>::const_iterator iter (info.archives.begin());
+            iter!=info.archives.end(); ++iter)
+            index->addArchive (*iter, info.memoryMapped);
+
+        for (std::vector<std::string>::const_iterator iter (info.dataDirs.begin());
+            iter!=info.dataDirs.end(); ++iter)
+            index->addDirectory (*iter);
+
+        std::cout
+            << "Index: " << index->getSize() << " files from " << index->getSources().size()
+            << " sources, built in " << static_cast<int> (index->getBuildTime()*1000) << " ms"
+            << std::endl;
+    }
+
+    std::map<uint32_t, std::string> sources;
+    std::map<uint32_t, boost::shared_ptr<Bsa::CompressedFile> > compressed;
+    std::map<uint32_t, Ogre::DataStreamPtr> streams;
+    std::vector<char> buffer;
+
+    Totals recorded;
+    Totals replayed;
+    int missing = 0;
+
+    Ogre::Timer wallTimer;
+    Ogre::Timer timer;
+    uint64_t start = 0;
+    bool first = true;
+
+    VFS::TraceRecord record;
+
+    while (trace.read (record))
+    {
+        if (record.mType==VFS::TraceRecord::Type_Source)
+        {
+            sources[record.mId] = record.mPath;
+
+#ifdef OPENMW_USE_LZ4
+            // Entries of compressed archives are recorded by index, not by offset
+            if (!index.get() && Bsa::CompressedFile::isCompressedFile (record.mPath))
+            {
+                compressed[record.mId].reset (new Bsa::CompressedFile);
+                compressed[record.mId]->open (record.mPath);
+            }
+#endif
+            continue;
+        }
+
+        if (first)
+        {
+            start = record.mTime;
+            first = false;
+            wallTimer.reset();
+        }
+
+        if (info.realtime)
+        {
+            uint64_t now = wallTimer.getMicroseconds();
+
+            if (record.mTime-start > now)
+                boost::this_thread::sleep (
+                    boost::posix_time::microseconds (record.mTime-start-now));
+        }
+
+        switch (record.mType)
+        {
+            case VFS::TraceRecord::Type_Open:
+            {
+                ++recorded.mOpens;
+                recorded.mOpenTime += record.mDuration;
+
+                timer.reset();
+
+                Ogre::DataStreamPtr stream;
+
+                if (index.get())
+                {
+                    if (const VFS::Index::Entry *entry = index->lookup (record.mPath))
+                        stream = index->open (*entry);
+                }
+#ifdef OPENMW_USE_LZ4
+                else if (compressed.count (record.mSource))
+                    stream = compressed[record.mSource]->getFile (record.mOffset);
+#endif
+                else
+                    stream = openConstrainedFileDataStream (sources[record.mSource].c_str(),
+                        record.mOffset, record.mSize);
+
+                if (stream.isNull())
+                {
+                    std::cout << "Missing: " << record.mPath << std::endl;
+                    ++missing;
+                    break;
+                }
+
+                ++replayed.mOpens;
+                replayed.mOpenTime += timer.getMicroseconds();
+
+                streams[record.mId] = stream;
+                break;
+            }
+
+            case VFS::TraceRecord::Type_Read:
+            {
+                recorded.addRead (record.mResult, record.mDuration);
+
+                std::map<uint32_t, Ogre::DataStreamPtr>::iterator iter = streams.find (record.mId);
+
+                if (iter==streams.end())
+                    break;
+
+                if (buffer.size()<record.mSize)
+                    buffer.resize (record.mSize);
+
+                timer.reset();
+
+                iter->second->seek (record.mOffset);
+                size_t result = iter->second->read (buffer.empty() ? 0 : &buffer[0], record.mSize);
+
+                replayed.addRead (result, timer.getMicroseconds());
+                break;
+            }
+
+            case VFS::TraceRecord::Type_Close:
+
+                streams.erase (record.mId);
+                break;
+
+            case VFS::TraceRecord::Type_Source:
+
+                break;
+        }
+    }
+
+    recorded.print ("Recorded");
+    replayed.print ("Replayed");
+
+    std::cout
+        << "Replay took " << wallTimer.getMilliseconds() << " ms";
+
+    if (missing)
+        std::cout << ", " << missing << " files missing";
+
+    std::cout << std::endl;
+
+    return missing ? 3 : 0;
+}
@@ -225,6 +225,7 @@ int CSMDoc::CloseSaveStage::setup()
 
 void CSMDoc::CloseSaveStage::perform (int stage, std::vector<std::string>& messages)
 {
+    mState.getWriter().close();
     mState.getStream().close();
 
     if (!mState.getStream())
@@ -2,9 +2,13 @@
 
 #include <stdexcept>
 #include <iomanip>
+#include <memory>
+
+#include <boost/bind.hpp>
 
 #include <OgreRoot.h>
 #include <OgreRenderWindow.h>
+#include <OgreRenderSystem.h>
 
 #include <MyGUI_WidgetManager.h>
 
@@ -13,13 +17,19 @@
 #include <components/compiler/extensions0.hpp>
 
 #include <components/bsa/resources.hpp>
+#include <components/vfs/index.hpp>
+#include <components/vfs/prefetcher.hpp>
+#include <components/vfs/tracer.hpp>
 #include <components/files/configurationmanager.hpp>
 #include <components/translation/translation.hpp>
 #include <components/nif/niffile.hpp>
+#include <components/nif/preloader.hpp>
 #include <components/nifoverrides/nifoverrides.hpp>
 
 #include <components/nifbullet/bulletnifloader.hpp>
 #include <components/nifogre/ogrenifloader.hpp>
+#include <components/nifogre/mesh.hpp>
+#include <components/nifogre/meshcache.hpp>
 
 #include <components/esm/loadcell.hpp>
 
@@ -36,6 +46,7 @@
 #include "mwworld/class.hpp"
 #include "mwworld/player.hpp"
 #include "mwworld/worldimp.hpp"
+#include "mwworld/contentcache.hpp"
 
 #include "mwclass/classes.hpp"
 
@@ -159,6 +170,9 @@ OMW::Engine::Engine(Files::ConfigurationManager& configurationManager)
   , mWarningsMode (1)
   , mScriptContext (0)
   , mFSStrict (false)
+  , mPrefetcher (0)
+  , mNifPreloader (0)
+  , mMeshCache (0)
   , mScriptConsoleMode (false)
   , mCfgMgr(configurationManager)
   , mEncoding(ToUTF8::WINDOWS_1252)
@@ -186,7 +200,21 @@ OMW::Engine::Engine(Files::ConfigurationManager& configurationManager)
 
 OMW::Engine::~Engine()
 {
+    if (mMeshCache)
+    {
+        NifOgre::NIFMeshLoader::setCache (0);
+        mMeshCache->write();
+        delete mMeshCache;
+    }
+
     mEnvironment.cleanup();
+    if (mResourceIndex)
+    {
+        mResourceIndex->setPrefetcher (0);
+        mResourceIndex->setTracer (boost::shared_ptr<VFS::Tracer>());
+    }
+    delete mNifPreloader;
+    delete mPrefetcher;
     delete mScriptContext;
     delete mOgre;
     SDL_Quit();
@@ -344,7 +372,41 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
 
     mOgre->createWindow("OpenMW", windowSettings);
 
-    Bsa::registerResources (mFileCollections, mArchives, true, mFSStrict);
+    mResourceIndex = Bsa::registerResources (mFileCollections, mArchives, true, mFSStrict,
+        settings.getBool("memory map archives", "General"));
+
+    if (settings.getBool("prefetch", "General"))
+    {
+        mPrefetcher = new VFS::Prefetcher (*mResourceIndex,
+            settings.getInt("prefetch cache size", "General") * 1024 * 1024);
+        mResourceIndex->setPrefetcher (mPrefetcher);
+    }
+
+    int modelThreads = settings.getInt("model loader threads", "General");
+
+    if (modelThreads>0)
+    {
+        // Ogre's resource system is not thread safe, the index is
+        Ogre::DataStreamPtr (VFS::Index::*open) (const std::string&) const = &VFS::Index::open;
+        mNifPreloader = new Nif::Preloader (boost::bind (open, mResourceIndex, _1), modelThreads);
+    }
+
+    if (settings.getBool("mesh cache", "General"))
+    {
+        mMeshCache = new NifOgre::MeshCache (mCfgMgr.getCachePath() / "meshes.cache",
+            *mResourceIndex, Ogre::Root::getSingleton().getRenderSystem()->getColourVertexElementType());
+        NifOgre::NIFMeshLoader::setCache (mMeshCache);
+    }
+
+    std::string tracePath = settings.getString("resource trace", "General");
+
+    if (!tracePath.empty())
+    {
+        // relative paths go next to the log files
+        boost::filesystem::path path = mCfgMgr.getLogPath() / tracePath;
+        std::cout << "Tracing resource I/O to " << path.string() << std::endl;
+        mResourceIndex->setTracer (boost::shared_ptr<VFS::Tracer> (new VFS::Tracer (path.string())));
+    }
 
     // Create input and UI first to set up a bootstrapping environment for
     // showing a loading screen and keeping the window responsive while doing so
@@ -370,9 +432,15 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     }
 
     // Create the world
+    std::auto_ptr<MWWorld::ContentCache> contentCache;
+    if (settings.getBool("content cache", "General"))
+        contentCache.reset (new MWWorld::ContentCache (
+            mCfgMgr.getCachePath() / "content.cache", mEncoding));
+
     mEnvironment.setWorld( new MWWorld::World (*mOgre, mFileCollections, mContentFiles,
         mResDir, mCfgMgr.getCachePath(), mEncoder, mFallbackMap,
-        mActivationDistanceOverride, mCellName));
+        mActivationDistanceOverride, mCellName, mPrefetcher, mNifPreloader,
+        settings.getInt("content loader threads", "General"), contentCache.get()));
     MWBase::Environment::get().getWorld()->setupPlayer();
     input->setPlayer(&mEnvironment.getWorld()->getPlayer());
 
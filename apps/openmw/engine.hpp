@@ -1,6 +1,8 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <boost/shared_ptr.hpp>
+
 #include <OgreFrameListener.h>
 
 #include <components/compiler/extensions.hpp>
@@ -55,6 +57,22 @@ namespace Files
     struct ConfigurationManager;
 }
 
+namespace VFS
+{
+    class Index;
+    class Prefetcher;
+}
+
+namespace Nif
+{
+    class Preloader;
+}
+
+namespace NifOgre
+{
+    class MeshCache;
+}
+
 namespace OMW
 {
     /// \brief Main engine class, that brings together all the components of OpenMW
@@ -88,6 +106,10 @@ namespace OMW
 
             Files::Collections mFileCollections;
             bool mFSStrict;
+            boost::shared_ptr<VFS::Index> mResourceIndex;
+            VFS::Prefetcher *mPrefetcher;
+            Nif::Preloader *mNifPreloader;
+            NifOgre::MeshCache *mMeshCache;
             Translation::Storage mTranslationDataStorage;
 
             // not implemented
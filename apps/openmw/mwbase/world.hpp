@@ -118,6 +118,10 @@ namespace MWBase
 
             virtual MWWorld::CellStore *getExterior (int x, int y) = 0;
 
+            virtual void listExteriorModels (int x, int y, std::vector<std::string>& models) = 0;
+            ///< Append the models of the references in an exterior cell to \a models, without
+            /// loading the cell.
+
             virtual MWWorld::CellStore *getInterior (const std::string& name) = 0;
 
             virtual MWWorld::CellStore *getCell (const ESM::CellId& id) = 0;
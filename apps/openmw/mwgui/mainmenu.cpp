@@ -56,6 +56,12 @@ namespace MWGui
         updateMenu();
     }
 
+    void MainMenu::onFrame(float dt)
+    {
+        if (mSaveGameDialog)
+            mSaveGameDialog->onFrame(dt);
+    }
+
     void MainMenu::setVisible (bool visible)
     {
         if (visible)
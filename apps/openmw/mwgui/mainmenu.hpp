@@ -22,6 +22,8 @@ namespace MWGui
 
             void onResChange(int w, int h);
 
+            void onFrame(float dt);
+
             virtual void setVisible (bool visible);
 
         private:
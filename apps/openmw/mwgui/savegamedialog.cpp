@@ -238,6 +238,8 @@ namespace MWGui
         {
             mInfoText->setCaption("");
             mScreenshot->setImageTexture("");
+            mScreenshotLoader.cancel();
+            mPendingSlot.clear();
             return;
         }
 
@@ -281,12 +283,50 @@ namespace MWGui
 
         mInfoText->setCaptionWithReplacing(text.str());
 
-        // Decode screenshot
-        std::vector<char> data = slot->mProfile.mScreenshot; // MemoryDataStream doesn't work with const data :(
-        Ogre::DataStreamPtr stream(new Ogre::MemoryDataStream(&data[0], data.size()));
+        // Read in the background and decoded in onFrame; not there yet while the slot is still
+        // being saved
+        mScreenshot->setImageTexture("");
+
+        if (slot->mSize)
+        {
+            mScreenshotLoader.request(slot->mPath);
+            mPendingSlot.clear();
+        }
+        else
+        {
+            mScreenshotLoader.cancel();
+            mPendingSlot = slot->mPath;
+        }
+    }
+
+    void SaveGameDialog::onFrame(float dt)
+    {
+        if (!mPendingSlot.empty() && mCurrentCharacter)
+        {
+            // Once the save is complete (see MWState::Character::finishSlot) it has a screenshot
+            MWState::Character::SlotIterator it = mCurrentCharacter->begin();
+
+            for (; it != mCurrentCharacter->end(); ++it)
+                if (it->mPath == mPendingSlot)
+                    break;
+
+            if (it == mCurrentCharacter->end())
+                mPendingSlot.clear(); // the save failed
+            else if (it->mSize)
+            {
+                mScreenshotLoader.request(mPendingSlot);
+                mPendingSlot.clear();
+            }
+        }
+
         Ogre::Image image;
-        image.load(stream, "jpg");
 
+        if (mScreenshotLoader.getImage(image))
+            setScreenshot(image);
+    }
+
+    void SaveGameDialog::setScreenshot(const Ogre::Image& image)
+    {
         const std::string textureName = "@savegame_screenshot";
         Ogre::TexturePtr texture;
         texture = Ogre::TextureManager::getSingleton().getByName(textureName);
@@ -3,6 +3,8 @@
 
 #include "windowbase.hpp"
 
+#include "../mwstate/screenshotloader.hpp"
+
 namespace MWState
 {
     class Character;
@@ -20,6 +22,9 @@ namespace MWGui
 
         void setLoadOrSave(bool load);
 
+        void onFrame(float dt);
+        ///< Show the screenshot of the selected slot, once it has been written and loaded.
+
     private:
         void onCancelButtonClicked (MyGUI::Widget* sender);
         void onOkButtonClicked (MyGUI::Widget* sender);
@@ -34,7 +39,11 @@ namespace MWGui
 
         void fillSaveList();
 
+        void setScreenshot(const Ogre::Image& image);
+
         MyGUI::ImageBox* mScreenshot;
+        MWState::ScreenshotLoader mScreenshotLoader;
+        boost::filesystem::path mPendingSlot; ///< selected, but still being saved; empty if none
         bool mSaving;
 
         MyGUI::ComboBox* mCharacterSelection;
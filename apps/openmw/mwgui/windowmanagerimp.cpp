@@ -707,6 +707,8 @@ namespace MWGui
 
         mToolTips->onFrame(frameDuration);
 
+        mMenu->onFrame(frameDuration);
+
         if (MWBase::Environment::get().getStateManager()->getState()==
             MWBase::StateManager::State_NoGame)
             return;
@@ -63,27 +63,33 @@ namespace MWScript
         const MWWorld::ESMStore &store =
             MWBase::Environment::get().getWorld()->getStore();
 
+        // Ids that were never interned can't name a record
+        Misc::IdAtoms::Atom id = Misc::IdAtoms::search (name);
+
+        if (id==Misc::IdAtoms::sNone)
+            return false;
+
         return
-            store.get<ESM::Activator>().search (name) ||
-            store.get<ESM::Potion>().search (name) ||
-            store.get<ESM::Apparatus>().search (name) ||
-            store.get<ESM::Armor>().search (name) ||
-            store.get<ESM::Book>().search (name) ||
-            store.get<ESM::Clothing>().search (name) ||
-            store.get<ESM::Container>().search (name) ||
-            store.get<ESM::Creature>().search (name) ||
-            store.get<ESM::Door>().search (name) ||
-            store.get<ESM::Ingredient>().search (name) ||
-            store.get<ESM::CreatureLevList>().search (name) ||
-            store.get<ESM::ItemLevList>().search (name) ||
-            store.get<ESM::Light>().search (name) ||
-            store.get<ESM::Lockpick>().search (name) ||
-            store.get<ESM::Miscellaneous>().search (name) ||
-            store.get<ESM::NPC>().search (name) ||
-            store.get<ESM::Probe>().search (name) ||
-            store.get<ESM::Repair>().search (name) ||
-            store.get<ESM::Static>().search (name) ||
-            store.get<ESM::Weapon>().search (name);
+            store.get<ESM::Activator>().search (id) ||
+            store.get<ESM::Potion>().search (id) ||
+            store.get<ESM::Apparatus>().search (id) ||
+            store.get<ESM::Armor>().search (id) ||
+            store.get<ESM::Book>().search (id) ||
+            store.get<ESM::Clothing>().search (id) ||
+            store.get<ESM::Container>().search (id) ||
+            store.get<ESM::Creature>().search (id) ||
+            store.get<ESM::Door>().search (id) ||
+            store.get<ESM::Ingredient>().search (id) ||
+            store.get<ESM::CreatureLevList>().search (id) ||
+            store.get<ESM::ItemLevList>().search (id) ||
+            store.get<ESM::Light>().search (id) ||
+            store.get<ESM::Lockpick>().search (id) ||
+            store.get<ESM::Miscellaneous>().search (id) ||
+            store.get<ESM::NPC>().search (id) ||
+            store.get<ESM::Probe>().search (id) ||
+            store.get<ESM::Repair>().search (id) ||
+            store.get<ESM::Static>().search (id) ||
+            store.get<ESM::Weapon>().search (id);
     }
 
     bool CompilerContext::isJournalId (const std::string& name) const
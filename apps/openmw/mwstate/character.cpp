@@ -8,8 +8,10 @@
 #include <stdexcept>
 
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 #include <components/esm/esmreader.hpp>
+#include <components/esm/esmwriter.hpp>
 #include <components/esm/defs.hpp>
 
 #include <components/misc/stringops.hpp>
@@ -23,30 +25,24 @@ bool MWState::operator< (const Slot& left, const Slot& right)
 }
 
 
-void MWState::Character::addSlot (const boost::filesystem::path& path, const std::string& game)
-{
-    Slot slot;
-    slot.mPath = path;
-    slot.mTimeStamp = boost::filesystem::last_write_time (path);
+const char MWState::Character::sIndexFile[] = "slots.index";
 
+bool MWState::Character::readSlot (Slot& slot)
+{
     ESM::ESMReader reader;
     reader.open (slot.mPath.string());
 
     if (reader.getFormat()>ESM::Header::CurrentFormat)
-        return; // format is too new -> ignore
+        return false; // format is too new -> ignore
 
     if (reader.getRecName()!=ESM::REC_SAVE)
-        return; // invalid save file -> ignore
+        return false; // invalid save file -> ignore
 
     reader.getRecHeader();
 
-    slot.mProfile.load (reader);
+    slot.mProfile.load (reader, false);
 
-    if (Misc::StringUtils::lowerCase (slot.mProfile.mContentFiles.at (0))!=
-        Misc::StringUtils::lowerCase (game))
-        return; // this file is for a different game -> ignore
-
-    mSlots.push_back (slot);
+    return true;
 }
 
 void MWState::Character::addSlot (const ESM::SavedGame& profile)
@@ -59,10 +55,103 @@ void MWState::Character::addSlot (const ESM::SavedGame& profile)
     slot.mPath = mPath / stream.str();
     slot.mProfile = profile;
     slot.mTimeStamp = std::time (0);
+    slot.mSize = 0;
 
     mSlots.push_back (slot);
 }
 
+void MWState::Character::loadIndex (Index& index) const
+{
+    boost::filesystem::path path = mPath / sIndexFile;
+
+    if (!boost::filesystem::exists (path))
+        return;
+
+    try
+    {
+        ESM::ESMReader reader;
+        reader.open (path.string());
+
+        if (reader.getFormat()!=ESM::Header::CurrentFormat)
+            return; // written by another version -> rebuild
+
+        while (reader.hasMoreRecs())
+        {
+            if (reader.getRecName()!=ESM::REC_SLOT)
+                throw std::runtime_error ("invalid saved game index");
+
+            reader.getRecHeader();
+
+            Slot slot;
+            std::string name = reader.getHNString ("FILE");
+            slot.mPath = mPath / name;
+
+            int64_t time = 0;
+            reader.getHNT (time, "MTIM");
+            slot.mTimeStamp = static_cast<std::time_t> (time);
+
+            reader.getHNT (slot.mSize, "SIZE");
+
+            slot.mProfile.load (reader, false);
+
+            index.insert (std::make_pair (name, slot));
+        }
+    }
+    catch (...)
+    {
+        // broken index -> rebuild
+        index.clear();
+    }
+}
+
+void MWState::Character::saveIndex() const
+{
+    boost::filesystem::path path = mPath / sIndexFile;
+    boost::filesystem::path temp (path.string() + ".tmp");
+
+    try
+    {
+        {
+            boost::filesystem::ofstream stream (temp, std::ios::binary);
+
+            ESM::ESMWriter writer;
+            writer.setFormat (ESM::Header::CurrentFormat);
+            writer.save (stream);
+
+            for (int i=0; i<2; ++i)
+            {
+                const std::vector<Slot>& slots = i==0 ? mSlots : mOtherSlots;
+
+                for (std::vector<Slot>::const_iterator iter (slots.begin()); iter!=slots.end();
+                    ++iter)
+                    if (iter->mSize)
+                    {
+                        writer.startRecord (ESM::REC_SLOT);
+                        writer.writeHNString ("FILE", iter->mPath.filename().string());
+                        writer.writeHNT ("MTIM", static_cast<int64_t> (iter->mTimeStamp));
+                        writer.writeHNT ("SIZE", iter->mSize);
+                        iter->mProfile.save (writer, false);
+                        writer.endRecord (ESM::REC_SLOT);
+                    }
+            }
+
+            writer.close();
+
+            stream.close();
+
+            if (!stream)
+                throw std::runtime_error ("write failed");
+        }
+
+        boost::filesystem::rename (temp, path);
+    }
+    catch (...)
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove (temp, error);
+    }
+}
+
 MWState::Character::Character (const boost::filesystem::path& saves, const std::string& game)
 : mPath (saves), mNext (0)
 {
@@ -72,14 +161,57 @@ MWState::Character::Character (const boost::filesystem::path& saves, const std::
     }
     else
     {
+        Index index;
+        loadIndex (index);
+
+        size_t indexed = 0;
+        bool read = false;
+
         for (boost::filesystem::directory_iterator iter (mPath);
             iter!=boost::filesystem::directory_iterator(); ++iter)
         {
             boost::filesystem::path slotPath = *iter;
 
+            // left behind by a save that did not complete
+            if (slotPath.extension()==".tmp")
+                continue;
+
+            // bases of deltas (see SaveChain)
+            if (boost::filesystem::is_directory (slotPath))
+                continue;
+
+            if (slotPath.filename()==sIndexFile)
+                continue;
+
             try
             {
-                addSlot (slotPath, game);
+                Slot slot;
+                slot.mPath = slotPath;
+                slot.mTimeStamp = boost::filesystem::last_write_time (slotPath);
+                slot.mSize = boost::filesystem::file_size (slotPath);
+
+                Index::const_iterator entry = index.find (slotPath.filename().string());
+
+                bool cached = entry!=index.end() && entry->second.mTimeStamp==slot.mTimeStamp &&
+                    entry->second.mSize==slot.mSize;
+
+                if (cached)
+                {
+                    slot.mProfile = entry->second.mProfile;
+                    ++indexed;
+                }
+                else if (!readSlot (slot))
+                    continue;
+
+                // Slots of other games are indexed as well, so they are not read again next time
+                if (Misc::StringUtils::lowerCase (slot.mProfile.mContentFiles.at (0))==
+                    Misc::StringUtils::lowerCase (game))
+                    mSlots.push_back (slot);
+                else
+                    mOtherSlots.push_back (slot);
+
+                if (!cached)
+                    read = true;
             }
             catch (...) {} // ignoring bad saved game files for now
 
@@ -92,6 +224,9 @@ MWState::Character::Character (const boost::filesystem::path& saves, const std::
         }
 
         std::sort (mSlots.begin(), mSlots.end());
+
+        if (read || indexed!=index.size())
+            saveIndex();
     }
 }
 
@@ -115,6 +250,7 @@ const MWState::Slot *MWState::Character::updateSlot (const Slot *slot, const ESM
     Slot newSlot = *slot;
     newSlot.mProfile = profile;
     newSlot.mTimeStamp = std::time (0);
+    newSlot.mSize = 0;
 
     mSlots.erase (mSlots.begin()+index);
 
@@ -123,6 +259,53 @@ const MWState::Slot *MWState::Character::updateSlot (const Slot *slot, const ESM
     return &mSlots.back();
 }
 
+bool MWState::Character::finishSlot (const boost::filesystem::path& path)
+{
+    for (std::vector<Slot>::iterator iter (mSlots.begin()); iter!=mSlots.end(); ++iter)
+        if (iter->mPath==path)
+        {
+            try
+            {
+                iter->mTimeStamp = boost::filesystem::last_write_time (path);
+                iter->mSize = boost::filesystem::file_size (path);
+            }
+            catch (...) {} // not indexed then
+
+            saveIndex();
+            return true;
+        }
+
+    return false;
+}
+
+bool MWState::Character::failSlot (const boost::filesystem::path& path)
+{
+    for (std::vector<Slot>::iterator iter (mSlots.begin()); iter!=mSlots.end(); ++iter)
+        if (iter->mPath==path)
+        {
+            try
+            {
+                Slot slot;
+                slot.mPath = path;
+                slot.mTimeStamp = boost::filesystem::last_write_time (path);
+                slot.mSize = boost::filesystem::file_size (path);
+
+                if (readSlot (slot))
+                {
+                    *iter = slot;
+                    std::sort (mSlots.begin(), mSlots.end());
+                    return true;
+                }
+            }
+            catch (...) {} // no saved game there (any more)
+
+            mSlots.erase (iter);
+            return true;
+        }
+
+    return false;
+}
+
 MWState::Character::SlotIterator MWState::Character::begin() const
 {
     return mSlots.rbegin();
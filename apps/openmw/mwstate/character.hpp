@@ -1,6 +1,10 @@
 #ifndef GAME_STATE_CHARACTER_H
 #define GAME_STATE_CHARACTER_H
 
+#include <map>
+
+#include <stdint.h>
+
 #include <boost/filesystem/path.hpp>
 
 #include <components/esm/savedgame.hpp>
@@ -10,12 +14,18 @@ namespace MWState
     struct Slot
     {
         boost::filesystem::path mPath;
-        ESM::SavedGame mProfile;
+        ESM::SavedGame mProfile; ///< without the screenshot (see ScreenshotLoader)
         std::time_t mTimeStamp;
+        uint64_t mSize; ///< of the file; 0 while the slot is being written
     };
 
     bool operator< (const Slot& left, const Slot& right);
 
+    /// \brief The saved games of a character
+    ///
+    /// The profiles of the slots are cached in an index file next to them, so that they do not
+    /// have to be read from the saved games themselves. An entry of the index is used as long as
+    /// the modification time and the size of its saved game match.
     class Character
     {
         public:
@@ -24,14 +34,27 @@ namespace MWState
 
         private:
 
+            typedef std::map<std::string, Slot> Index; ///< by file name
+
+            static const char sIndexFile[];
+
             boost::filesystem::path mPath;
             std::vector<Slot> mSlots;
+            std::vector<Slot> mOtherSlots; ///< of other games, only kept for the index
             int mNext;
 
-            void addSlot (const boost::filesystem::path& path, const std::string& game);
+            static bool readSlot (Slot& slot);
+            ///< Read the profile of the saved game at slot.mPath.
+            /// \return Is it a saved game of a known format?
 
             void addSlot (const ESM::SavedGame& profile);
 
+            void loadIndex (Index& index) const;
+
+            void saveIndex() const;
+            ///< Write the index of the slots that have been written. Failures are ignored; the
+            /// profiles are read from the saved games instead the next time.
+
         public:
 
             Character (const boost::filesystem::path& saves, const std::string& game);
@@ -46,6 +69,15 @@ namespace MWState
             ///
             /// \attention The \a slot pointer will be invalidated by this call.
 
+            bool finishSlot (const boost::filesystem::path& path);
+            ///< The slot saved to \a path has been written.
+            /// \return Does the slot belong to this character?
+
+            bool failSlot (const boost::filesystem::path& path);
+            ///< Writing the slot saved to \a path has failed. The slot goes back to the saved game
+            /// that is still at \a path, or is removed if there is none.
+            /// \return Does the slot belong to this character?
+
             SlotIterator begin() const;
             ///< First slot is the most recent. Other slots follow in descending order of save date.
             ///
@@ -74,6 +74,20 @@ void MWState::CharacterManager::clearCurrentCharacter()
     mCurrent = 0;
 }
 
+void MWState::CharacterManager::finishSlot (const boost::filesystem::path& slot)
+{
+    for (std::vector<Character>::iterator iter (mCharacters.begin()); iter!=mCharacters.end(); ++iter)
+        if (iter->finishSlot (slot))
+            break;
+}
+
+void MWState::CharacterManager::failSlot (const boost::filesystem::path& slot)
+{
+    for (std::vector<Character>::iterator iter (mCharacters.begin()); iter!=mCharacters.end(); ++iter)
+        if (iter->failSlot (slot))
+            break;
+}
+
 std::vector<MWState::Character>::const_iterator MWState::CharacterManager::begin() const
 {
     return mCharacters.begin();
@@ -37,6 +37,12 @@ namespace MWState
 
             void clearCurrentCharacter();
 
+            void finishSlot (const boost::filesystem::path& slot);
+            ///< The slot saved to \a slot has been written, whichever character it belongs to.
+
+            void failSlot (const boost::filesystem::path& slot);
+            ///< Writing the slot saved to \a slot has failed, whichever character it belongs to.
+
             std::vector<Character>::const_iterator begin() const;
 
             std::vector<Character>::const_iterator end() const;
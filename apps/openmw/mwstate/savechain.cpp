@@ -0,0 +1,526 @@
+#include "savechain.hpp"
+
+#include <climits>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <OgreDataStream.h>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/savedelta.hpp>
+#include <components/esm/compressedstream.hpp>
+#include <components/esm/defs.hpp>
+
+#include <components/files/constrainedfiledatastream.hpp>
+
+namespace
+{
+    const char sBasesDirectory[] = "bases";
+    /// One line per slot, "slot/base": '/' can not be part of a file name
+    const char sIndexFile[] = "bases.index";
+    const char sIndexSeparator = '/';
+
+    const size_t sRecordHeaderSize = 16;
+    const size_t sSubRecordHeaderSize = 8;
+
+    /// FNV-1a, eight bytes at a time
+    const uint64_t sHashStart = (static_cast<uint64_t> (0xcbf29ce4) << 32) | 0x84222325;
+    const uint64_t sHashPrime = (static_cast<uint64_t> (0x100) << 32) | 0x1b3;
+
+    uint64_t hash (uint64_t value, const char *data, size_t size)
+    {
+        for (; size>=sizeof (uint64_t); data+=sizeof (uint64_t), size-=sizeof (uint64_t))
+        {
+            uint64_t word;
+            std::memcpy (&word, data, sizeof (word));
+            value = (value ^ word) * sHashPrime;
+        }
+
+        for (size_t i=0; i<size; ++i)
+            value = (value ^ static_cast<unsigned char> (data[i])) * sHashPrime;
+
+        return value;
+    }
+
+    uint64_t hash (uint64_t value, uint64_t data)
+    {
+        return hash (value, reinterpret_cast<const char *> (&data), sizeof (data));
+    }
+
+    uint32_t readSize (const char *data)
+    {
+        uint32_t size;
+        std::memcpy (&size, data, sizeof (size));
+        return size;
+    }
+
+    /// End of the record starting at \a begin
+    size_t getRecordEnd (const char *data, size_t begin, size_t end)
+    {
+        if (end-begin<sRecordHeaderSize || readSize (data+begin+4)>end-begin-sRecordHeaderSize)
+            throw std::runtime_error ("truncated record in saved game");
+
+        return begin + sRecordHeaderSize + readSize (data+begin+4);
+    }
+
+    bool isRecord (const std::string& file, size_t pos, const char *name)
+    {
+        return file.size()-pos>=4 && !std::memcmp (file.data()+pos, name, 4);
+    }
+
+    void readFile (const boost::filesystem::path& path, std::string& file)
+    {
+        Ogre::DataStreamPtr stream = openConstrainedFileDataStream (path.string().c_str());
+
+#ifdef OPENMW_USE_LZ4
+        if (ESM::CompressedDataStream::isCompressed (stream))
+            stream = Ogre::DataStreamPtr (new ESM::CompressedDataStream (stream));
+#endif
+
+        file.resize (stream->size());
+
+        if (!file.empty() && stream->read (&file[0], file.size())!=file.size())
+            throw std::runtime_error ("failed to read saved game " + path.string());
+    }
+
+    void readChain (const boost::filesystem::path& path, std::string& file,
+        MWState::SaveTable& table, int& depth, int maxDepth)
+    {
+        readFile (path, file);
+
+        if (!isRecord (file, 0, "TES3"))
+            throw std::runtime_error ("not a saved game: " + path.string());
+
+        size_t pos = getRecordEnd (file.data(), 0, file.size());
+
+        if (!isRecord (file, pos, "SAVE"))
+            throw std::runtime_error ("not a saved game: " + path.string());
+
+        size_t prefix = getRecordEnd (file.data(), pos, file.size());
+
+        table.clear();
+
+        if (!isRecord (file, prefix, "DELT"))
+        {
+            table.build (file.data(), prefix, file.size());
+            depth = 0;
+            return;
+        }
+
+        size_t records = getRecordEnd (file.data(), prefix, file.size());
+
+        ESM::SaveDelta delta;
+
+        {
+            ESM::ESMReader reader;
+            reader.openRaw (Ogre::DataStreamPtr (new Ogre::MemoryDataStream (&file[prefix],
+                records-prefix, false, true)), path.string());
+            reader.getRecName();
+            reader.getRecHeader();
+            delta.load (reader);
+        }
+
+        if (delta.mDepth<1 || delta.mDepth>maxDepth)
+            throw std::runtime_error ("invalid delta chain in saved game " + path.string());
+
+        boost::filesystem::path basePath = MWState::SaveChain::getBasesPath (path) / delta.mBase;
+
+        std::string base;
+        MWState::SaveTable baseTable;
+        int baseDepth = 0;
+
+        readChain (basePath, base, baseTable, baseDepth, delta.mDepth-1);
+
+        if (baseTable.getHash()!=delta.mBaseHash)
+            throw std::runtime_error ("base of saved game " + path.string() + " has changed");
+
+        MWState::SaveTable deltaTable;
+
+        for (std::vector<uint64_t>::const_iterator iter (delta.mStored.begin());
+            iter!=delta.mStored.end(); ++iter)
+        {
+            if (records>=file.size())
+                throw std::runtime_error ("records missing from saved game " + path.string());
+
+            MWState::SaveTable::Record record;
+            record.mKey = *iter;
+            record.mOffset = records;
+            records = getRecordEnd (file.data(), records, file.size());
+            record.mSize = records-record.mOffset;
+            record.mHash = hash (sHashStart, file.data()+record.mOffset, record.mSize);
+
+            deltaTable.add (record);
+        }
+
+        if (records!=file.size())
+            throw std::runtime_error ("unexpected records in saved game " + path.string());
+
+        std::string composed (file, 0, prefix);
+
+        for (std::vector<uint64_t>::const_iterator iter (delta.mKeys.begin());
+            iter!=delta.mKeys.end(); ++iter)
+        {
+            const std::string *source = &file;
+            const MWState::SaveTable::Record *record = deltaTable.search (*iter);
+
+            if (!record)
+            {
+                source = &base;
+                record = baseTable.search (*iter);
+            }
+
+            if (!record)
+                throw std::runtime_error ("record missing from the base of saved game " +
+                    path.string());
+
+            MWState::SaveTable::Record copy = *record;
+            copy.mOffset = composed.size();
+            composed.append (*source, record->mOffset, record->mSize);
+            table.add (copy);
+        }
+
+        file.swap (composed);
+        depth = delta.mDepth;
+    }
+}
+
+void MWState::SaveTable::build (const char *data, size_t begin, size_t end)
+{
+    std::map<uint64_t, int> counts;
+
+    while (begin<end)
+    {
+        size_t recordEnd = getRecordEnd (data, begin, end);
+
+        // type, first sub-record and grid index
+        size_t identity = begin + sRecordHeaderSize;
+
+        for (int i=0; i<2 && recordEnd-identity>=sSubRecordHeaderSize; ++i)
+        {
+            if (i==1 && std::memcmp (data+identity, "CIDX", 4))
+                break;
+
+            size_t size = readSize (data+identity+4);
+
+            if (size>recordEnd-identity-sSubRecordHeaderSize)
+                throw std::runtime_error ("truncated sub-record in saved game");
+
+            identity += sSubRecordHeaderSize + size;
+        }
+
+        uint64_t key = hash (hash (sHashStart, data+begin, 4), data+begin+sRecordHeaderSize,
+            identity-begin-sRecordHeaderSize);
+
+        Record record;
+        record.mKey = hash (key, counts[key]++);
+        record.mHash = hash (sHashStart, data+begin, recordEnd-begin);
+        record.mOffset = begin;
+        record.mSize = recordEnd-begin;
+
+        add (record);
+
+        begin = recordEnd;
+    }
+}
+
+void MWState::SaveTable::add (const Record& record)
+{
+    mIndex.insert (std::make_pair (record.mKey, mRecords.size()));
+    mRecords.push_back (record);
+}
+
+void MWState::SaveTable::clear()
+{
+    mRecords.clear();
+    mIndex.clear();
+}
+
+const std::vector<MWState::SaveTable::Record>& MWState::SaveTable::getRecords() const
+{
+    return mRecords;
+}
+
+const MWState::SaveTable::Record *MWState::SaveTable::search (uint64_t key) const
+{
+    std::map<uint64_t, size_t>::const_iterator iter = mIndex.find (key);
+
+    if (iter==mIndex.end())
+        return 0;
+
+    return &mRecords[iter->second];
+}
+
+uint64_t MWState::SaveTable::getHash() const
+{
+    uint64_t value = sHashStart;
+
+    for (std::vector<Record>::const_iterator iter (mRecords.begin()); iter!=mRecords.end(); ++iter)
+        value = hash (hash (value, iter->mKey), iter->mHash);
+
+    return value;
+}
+
+MWState::SaveChain::SaveChain() : mDepth (0) {}
+
+boost::filesystem::path MWState::SaveChain::getBasesPath (const boost::filesystem::path& path)
+{
+    boost::filesystem::path directory = path.parent_path();
+
+    if (directory.filename()==sBasesDirectory)
+        return directory;
+
+    return directory / sBasesDirectory;
+}
+
+std::string MWState::SaveChain::getBase (const boost::filesystem::path& path)
+{
+    ESM::ESMReader reader;
+    reader.open (path.string());
+
+    if (reader.getRecName()!=ESM::REC_SAVE)
+        return "";
+
+    reader.getRecHeader();
+    reader.skipRecord();
+
+    if (!reader.hasMoreRecs() || reader.getRecName()!=ESM::REC_DELT)
+        return "";
+
+    reader.getRecHeader();
+    return reader.getHNString ("BASE");
+}
+
+void MWState::SaveChain::read (const boost::filesystem::path& path, std::string& file,
+    SaveTable& table, int& depth)
+{
+    readChain (path, file, table, depth, INT_MAX);
+}
+
+bool MWState::SaveChain::hasBase (const boost::filesystem::path& slot) const
+{
+    return !mBase.empty() && mBase.parent_path()==getBasesPath (slot);
+}
+
+std::string MWState::SaveChain::getBaseName() const
+{
+    return mBase.filename().string();
+}
+
+const MWState::SaveTable& MWState::SaveChain::getTable() const
+{
+    return mTable;
+}
+
+int MWState::SaveChain::getDepth() const
+{
+    return mDepth;
+}
+
+void MWState::SaveChain::setBase (const boost::filesystem::path& slot, const SaveTable& table,
+    int depth)
+{
+    clear();
+
+    boost::filesystem::path directory = getBasesPath (slot);
+    boost::filesystem::create_directories (directory);
+
+    int next = 0;
+
+    for (boost::filesystem::directory_iterator iter (directory);
+        iter!=boost::filesystem::directory_iterator(); ++iter)
+    {
+        std::istringstream stream (iter->path().filename().string());
+
+        int index = 0;
+
+        if ((stream >> index) && index>=next)
+            next = index+1;
+    }
+
+    std::ostringstream stream;
+    stream << next;
+
+    boost::filesystem::path base = directory / stream.str();
+
+    boost::system::error_code error;
+    boost::filesystem::create_hard_link (slot, base, error);
+
+    if (error)
+        boost::filesystem::copy_file (slot, base);
+
+    mBase = base;
+    mTable = table;
+    mDepth = depth;
+}
+
+void MWState::SaveChain::clear()
+{
+    mBase.clear();
+    mTable.clear();
+    mDepth = 0;
+}
+
+bool MWState::SaveChain::readIndex (const boost::filesystem::path& directory, SlotIndex& index)
+{
+    boost::filesystem::ifstream stream (directory / sIndexFile);
+
+    if (!stream.is_open())
+        return false;
+
+    std::string line;
+
+    while (std::getline (stream, line))
+    {
+        std::string::size_type separator = line.find (sIndexSeparator);
+
+        // damaged, the slots are read again instead
+        if (separator==std::string::npos || separator==0 || separator+1==line.size())
+            return false;
+
+        index[line.substr (0, separator)] = line.substr (separator+1);
+    }
+
+    return !stream.bad();
+}
+
+void MWState::SaveChain::writeIndex (const boost::filesystem::path& directory,
+    const SlotIndex& index)
+{
+    boost::filesystem::path path = directory / sIndexFile;
+    boost::filesystem::path temp (path.string() + ".tmp");
+
+    try
+    {
+        {
+            boost::filesystem::ofstream stream (temp);
+
+            for (SlotIndex::const_iterator iter (index.begin()); iter!=index.end(); ++iter)
+                stream << iter->first << sIndexSeparator << iter->second << '\n';
+
+            stream.close();
+
+            if (!stream)
+                throw std::runtime_error ("write failed");
+        }
+
+        boost::filesystem::rename (temp, path);
+    }
+    catch (...)
+    {
+        // without an index the slots are read again by the next collectGarbage
+        boost::system::error_code error;
+        boost::filesystem::remove (temp, error);
+        boost::filesystem::remove (path, error);
+    }
+}
+
+void MWState::SaveChain::setSlotBase (const boost::filesystem::path& slot,
+    const std::string& base)
+{
+    boost::filesystem::path directory = getBasesPath (slot);
+
+    SlotIndex index;
+
+    // Without an index collectGarbage reads the slots, including this one
+    if (!readIndex (directory, index))
+        return;
+
+    std::string name = slot.filename().string();
+
+    if (base.empty())
+    {
+        if (!index.erase (name))
+            return;
+    }
+    else
+        index[name] = base;
+
+    writeIndex (directory, index);
+}
+
+void MWState::SaveChain::collectGarbage (const boost::filesystem::path& slots) const
+{
+    boost::filesystem::path directory = slots / sBasesDirectory;
+
+    if (!boost::filesystem::is_directory (directory))
+        return;
+
+    SlotIndex index;
+
+    bool changed = false;
+
+    if (!readIndex (directory, index))
+    {
+        for (boost::filesystem::directory_iterator iter (slots);
+            iter!=boost::filesystem::directory_iterator(); ++iter)
+            if (boost::filesystem::is_regular_file (iter->path()) && iter->path().extension()!=".tmp")
+            {
+                try
+                {
+                    std::string base = getBase (iter->path());
+
+                    if (!base.empty())
+                        index[iter->path().filename().string()] = base;
+                }
+                catch (...) {} // not a saved game
+            }
+
+        changed = true;
+    }
+
+    std::vector<std::string> roots;
+
+    if (!mBase.empty() && mBase.parent_path()==directory)
+        roots.push_back (getBaseName());
+
+    for (SlotIndex::iterator iter (index.begin()); iter!=index.end();)
+        if (boost::filesystem::exists (slots / iter->first))
+        {
+            roots.push_back (iter->second);
+            ++iter;
+        }
+        else
+        {
+            // the slot has been deleted
+            index.erase (iter++);
+            changed = true;
+        }
+
+    if (changed)
+        writeIndex (directory, index);
+
+    std::set<std::string> needed;
+
+    needed.insert (sIndexFile);
+
+    for (std::vector<std::string>::const_iterator iter (roots.begin()); iter!=roots.end(); ++iter)
+    {
+        std::string name = *iter;
+
+        try
+        {
+            while (!name.empty() && needed.insert (name).second)
+                name = getBase (directory / name);
+        }
+        catch (...) {} // broken chain
+    }
+
+    std::vector<boost::filesystem::path> unused;
+
+    for (boost::filesystem::directory_iterator iter (directory);
+        iter!=boost::filesystem::directory_iterator(); ++iter)
+        if (needed.find (iter->path().filename().string())==needed.end())
+            unused.push_back (iter->path());
+
+    for (std::vector<boost::filesystem::path>::const_iterator iter (unused.begin());
+        iter!=unused.end(); ++iter)
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove (*iter, error);
+    }
+}
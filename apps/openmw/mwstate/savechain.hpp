@@ -0,0 +1,119 @@
+#ifndef GAME_STATE_SAVECHAIN_H
+#define GAME_STATE_SAVECHAIN_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/filesystem/path.hpp>
+
+namespace MWState
+{
+    /// \brief Keys and contents hashes of the records of a saved game, in file order
+    ///
+    /// The key of a record identifies it across saved games. It is made of the record type, the
+    /// first sub-record (the id of most records), the grid index of exterior cells and the number
+    /// of records with the same type and sub-records before it. Keys are only computed for
+    /// complete saved games; deltas store them.
+    class SaveTable
+    {
+        public:
+
+            struct Record
+            {
+                uint64_t mKey;
+                uint64_t mHash; ///< of the whole record
+                size_t mOffset; ///< in the data the table was built from
+                size_t mSize;
+            };
+
+        private:
+
+            std::vector<Record> mRecords;
+            std::map<uint64_t, size_t> mIndex;
+
+        public:
+
+            void build (const char *data, size_t begin, size_t end);
+            ///< Add the records in \a data between \a begin and \a end.
+
+            void add (const Record& record);
+            ///< \note Keys must be unique.
+
+            void clear();
+
+            const std::vector<Record>& getRecords() const;
+
+            const Record *search (uint64_t key) const;
+            ///< \return 0 if there is no record with \a key.
+
+            uint64_t getHash() const;
+            ///< Hash of the keys and contents of all records
+    };
+
+    /// \brief Saved games stored as deltas
+    ///
+    /// A delta only holds the records that differ from an earlier saved game, its base (see
+    /// ESM::SaveDelta). Bases are kept in the bases directory next to the slots of a character, as
+    /// hard links (copies on file systems that have none), so that they remain unchanged when
+    /// their slots are overwritten. An index in the same directory records the base of each slot.
+    class SaveChain
+    {
+            boost::filesystem::path mBase; ///< empty if there is none
+            SaveTable mTable;
+            int mDepth;
+
+            typedef std::map<std::string, std::string> SlotIndex; ///< base by slot file name
+
+            static bool readIndex (const boost::filesystem::path& directory, SlotIndex& index);
+            ///< \return Is there an index in the bases \a directory?
+
+            static void writeIndex (const boost::filesystem::path& directory, const SlotIndex& index);
+
+        public:
+
+            SaveChain();
+
+            static boost::filesystem::path getBasesPath (const boost::filesystem::path& path);
+            ///< Directory the bases of the saved game at \a path are in
+
+            static std::string getBase (const boost::filesystem::path& path);
+            ///< File name of the base of the saved game at \a path (empty if it is not a delta).
+
+            static void read (const boost::filesystem::path& path, std::string& file,
+                SaveTable& table, int& depth);
+            ///< Read the saved game at \a path, combined with its bases if it is a delta.
+            ///
+            /// \param file Complete uncompressed saved game, without an ESM::SaveDelta
+            /// \param table Records of \a file after the SAVE record
+            /// \param depth Number of deltas in the chain
+
+            bool hasBase (const boost::filesystem::path& slot) const;
+            ///< Is there a base for a delta saved to \a slot?
+
+            std::string getBaseName() const;
+
+            const SaveTable& getTable() const;
+
+            int getDepth() const;
+
+            void setBase (const boost::filesystem::path& slot, const SaveTable& table, int depth);
+            ///< Make the saved game at \a slot the base of the next delta.
+            ///
+            /// \param depth Number of deltas in the chain of \a slot
+
+            void clear();
+            ///< Forget the base. The next saved game is written complete.
+
+            static void setSlotBase (const boost::filesystem::path& slot, const std::string& base);
+            ///< Record that \a slot has been written with \a base (empty if it is complete).
+
+            void collectGarbage (const boost::filesystem::path& slots) const;
+            ///< Remove the bases of the character with \a slots that neither a slot nor the
+            /// current base needs. The slots are only read if there is no index yet.
+    };
+}
+
+#endif
@@ -0,0 +1,193 @@
+#include "savewriter.hpp"
+
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <components/esm/esmwriter.hpp>
+#include <components/esm/savedelta.hpp>
+#include <components/esm/defs.hpp>
+
+void MWState::SaveWriter::run (Job *job_)
+{
+    std::auto_ptr<Job> job (job_);
+
+    Result result;
+    result.mPath = job->mPath;
+
+    boost::filesystem::path temp (job->mPath.string() + ".tmp");
+
+    bool delta = job->mMaxDeltas>0 && mChain.hasBase (job->mPath) &&
+        mChain.getDepth()<job->mMaxDeltas;
+
+    int depth = delta ? mChain.getDepth()+1 : 0;
+
+    SaveTable table;
+
+    try
+    {
+        table.build (job->mRecords.data(), 0, job->mRecords.size());
+
+        const std::vector<SaveTable::Record>& records = table.getRecords();
+
+        std::vector<const SaveTable::Record *> changed;
+
+        if (delta)
+            for (std::vector<SaveTable::Record>::const_iterator iter (records.begin());
+                iter!=records.end(); ++iter)
+            {
+                const SaveTable::Record *base = mChain.getTable().search (iter->mKey);
+
+                if (!base || base->mHash!=iter->mHash)
+                    changed.push_back (&*iter);
+            }
+
+        boost::filesystem::ofstream stream (temp, std::ios::binary);
+
+        ESM::ESMWriter writer;
+
+        for (std::vector<std::string>::const_iterator iter (job->mContentFiles.begin());
+            iter!=job->mContentFiles.end(); ++iter)
+            writer.addMaster (*iter, 0); // not using the size information anyway -> use value of 0
+
+        writer.setFormat (job->mFormat);
+        writer.setRecordCount (delta ? 2+changed.size() : job->mRecordCount);
+        writer.setCompressed (job->mCompressed);
+
+        writer.save (stream);
+
+        writer.startRecord (ESM::REC_SAVE);
+        job->mProfile.save (writer);
+        writer.endRecord (ESM::REC_SAVE);
+
+        // Keeps the header and the SAVE record in blocks of their own, for the save list
+        writer.flush();
+
+        if (delta)
+        {
+            ESM::SaveDelta record;
+            record.mBase = mChain.getBaseName();
+            record.mBaseHash = mChain.getTable().getHash();
+            record.mDepth = depth;
+
+            for (std::vector<SaveTable::Record>::const_iterator iter (records.begin());
+                iter!=records.end(); ++iter)
+                record.mKeys.push_back (iter->mKey);
+
+            for (std::vector<const SaveTable::Record *>::const_iterator iter (changed.begin());
+                iter!=changed.end(); ++iter)
+                record.mStored.push_back ((*iter)->mKey);
+
+            writer.startRecord (ESM::REC_DELT);
+            record.save (writer);
+            writer.endRecord (ESM::REC_DELT);
+
+            for (std::vector<const SaveTable::Record *>::const_iterator iter (changed.begin());
+                iter!=changed.end(); ++iter)
+                writer.write (job->mRecords.data()+(*iter)->mOffset, (*iter)->mSize);
+        }
+        else
+            writer.write (job->mRecords.data(), job->mRecords.size());
+
+        writer.close();
+
+        stream.close();
+
+        if (!stream)
+            throw std::runtime_error ("write failed");
+
+        boost::filesystem::rename (temp, job->mPath);
+
+        try
+        {
+            SaveChain::setSlotBase (job->mPath, delta ? mChain.getBaseName() : "");
+        }
+        catch (const std::exception&) {} // the index is rebuilt by collectGarbage
+
+        if (job->mMaxDeltas>0)
+        {
+            // The next saved game is written relative to this one
+            try
+            {
+                mChain.setBase (job->mPath, table, depth);
+                mChain.collectGarbage (job->mPath.parent_path());
+            }
+            catch (const std::exception&)
+            {
+                mChain.clear();
+            }
+        }
+        else
+            mChain.clear();
+    }
+    catch (const std::exception& e)
+    {
+        result.mError = e.what();
+
+        boost::system::error_code error;
+        boost::filesystem::remove (temp, error);
+    }
+
+    boost::mutex::scoped_lock lock (mMutex);
+    mResults.push_back (result);
+}
+
+MWState::SaveWriter::SaveWriter() {}
+
+MWState::SaveWriter::~SaveWriter()
+{
+    wait();
+}
+
+void MWState::SaveWriter::write (std::auto_ptr<Job> job)
+{
+    wait();
+
+    mThread.reset (new boost::thread (boost::bind (&SaveWriter::run, this, job.get())));
+    job.release();
+}
+
+void MWState::SaveWriter::wait()
+{
+    if (mThread)
+    {
+        mThread->join();
+        mThread.reset();
+    }
+}
+
+void MWState::SaveWriter::setBase (const boost::filesystem::path& slot, const SaveTable& table,
+    int depth)
+{
+    wait();
+
+    try
+    {
+        mChain.setBase (slot, table, depth);
+    }
+    catch (const std::exception&)
+    {
+        // The next saved game is written complete instead
+        mChain.clear();
+    }
+}
+
+void MWState::SaveWriter::clearBase()
+{
+    wait();
+    mChain.clear();
+}
+
+bool MWState::SaveWriter::getResult (Result& result)
+{
+    boost::mutex::scoped_lock lock (mMutex);
+
+    if (mResults.empty())
+        return false;
+
+    result = mResults.front();
+    mResults.pop_front();
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef GAME_STATE_SAVEWRITER_H
+#define GAME_STATE_SAVEWRITER_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <components/esm/savedgame.hpp>
+
+#include "savechain.hpp"
+
+namespace MWState
+{
+    /// \brief Writes saved games on a background thread
+    ///
+    /// The game state and the screenshot are serialised on the main thread, which owns the
+    /// renderer and its codecs. Writing the file happens in the background, into a temporary file
+    /// that replaces the saved game once it is complete.
+    ///
+    /// Saved games can be written as deltas (see SaveChain), relative to the last saved game that
+    /// was written or loaded.
+    class SaveWriter
+    {
+        public:
+
+            struct Job
+            {
+                boost::filesystem::path mPath;
+                ESM::SavedGame mProfile;
+                std::vector<std::string> mContentFiles;
+                int mFormat;
+                int mRecordCount;
+                bool mCompressed;
+                int mMaxDeltas; ///< deltas in a row before a complete saved game; 0: no deltas
+                std::string mRecords; ///< records after the SAVE record, as written by ESM::ESMWriter
+            };
+
+            struct Result
+            {
+                boost::filesystem::path mPath;
+                std::string mError; ///< empty if the saved game was written
+            };
+
+        private:
+
+            boost::scoped_ptr<boost::thread> mThread;
+            boost::mutex mMutex;
+            std::deque<Result> mResults;
+            SaveChain mChain; ///< only used by the thread writing, if any
+
+            SaveWriter (const SaveWriter&);
+            ///< Not implemented
+
+            SaveWriter& operator= (const SaveWriter&);
+            ///< Not implemented
+
+            void run (Job *job);
+            ///< Write \a job and take ownership of it
+
+        public:
+
+            SaveWriter();
+
+            ~SaveWriter();
+            ///< Waits for the save in progress.
+
+            void write (std::auto_ptr<Job> job);
+            ///< Start writing \a job, once the save in progress (if any) is complete.
+
+            void wait();
+            ///< Wait for the save in progress (if any).
+
+            void setBase (const boost::filesystem::path& slot, const SaveTable& table, int depth);
+            ///< Write the next delta relative to the saved game at \a slot, once the save in
+            /// progress (if any) is complete. See SaveChain::setBase.
+
+            void clearBase();
+            ///< Write the next saved game complete, once the save in progress (if any) is complete.
+
+            bool getResult (Result& result);
+            ///< Take the result of a finished save.
+            /// \return Was there one?
+    };
+}
+
+#endif
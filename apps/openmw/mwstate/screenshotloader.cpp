@@ -0,0 +1,135 @@
+#include "screenshotloader.hpp"
+
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/savedgame.hpp>
+#include <components/esm/defs.hpp>
+
+namespace
+{
+    void readScreenshot (const boost::filesystem::path& path, std::vector<char>& screenshot)
+    {
+        ESM::ESMReader reader;
+        reader.open (path.string());
+
+        if (reader.getRecName()!=ESM::REC_SAVE)
+            throw std::runtime_error ("not a saved game: " + path.string());
+
+        reader.getRecHeader();
+
+        ESM::SavedGame profile;
+        profile.load (reader);
+
+        if (profile.mScreenshot.empty())
+            throw std::runtime_error ("no screenshot in saved game " + path.string());
+
+        screenshot.swap (profile.mScreenshot);
+    }
+}
+
+void MWState::ScreenshotLoader::run()
+{
+    for (;;)
+    {
+        boost::filesystem::path path;
+        int number = 0;
+
+        {
+            boost::mutex::scoped_lock lock (mMutex);
+
+            if (mRequest.empty())
+            {
+                mRunning = false;
+                return;
+            }
+
+            path.swap (mRequest);
+            number = mRequested;
+        }
+
+        std::vector<char> screenshot;
+        bool loaded = false;
+
+        try
+        {
+            readScreenshot (path, screenshot);
+            loaded = true;
+        }
+        catch (const std::exception&) {} // shown without a screenshot
+
+        boost::mutex::scoped_lock lock (mMutex);
+
+        if (loaded && number==mRequested)
+        {
+            mScreenshot.swap (screenshot);
+            mLoaded = number;
+        }
+    }
+}
+
+MWState::ScreenshotLoader::ScreenshotLoader() : mRunning (false), mRequested (0), mLoaded (-1) {}
+
+MWState::ScreenshotLoader::~ScreenshotLoader()
+{
+    cancel();
+
+    if (mThread)
+        mThread->join();
+}
+
+void MWState::ScreenshotLoader::request (const boost::filesystem::path& path)
+{
+    boost::mutex::scoped_lock lock (mMutex);
+
+    mRequest = path;
+    ++mRequested;
+
+    if (!mRunning)
+    {
+        // The thread does not lock the mutex anymore once it has stopped taking requests
+        if (mThread)
+            mThread->join();
+
+        mThread.reset (new boost::thread (boost::bind (&ScreenshotLoader::run, this)));
+        mRunning = true;
+    }
+}
+
+void MWState::ScreenshotLoader::cancel()
+{
+    boost::mutex::scoped_lock lock (mMutex);
+
+    mRequest.clear();
+    ++mRequested;
+}
+
+bool MWState::ScreenshotLoader::getImage (Ogre::Image& image)
+{
+    std::vector<char> screenshot;
+
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+
+        if (mLoaded!=mRequested)
+            return false;
+
+        screenshot.swap (mScreenshot);
+        mLoaded = -1;
+    }
+
+    try
+    {
+        Ogre::DataStreamPtr stream (new Ogre::MemoryDataStream (&screenshot[0],
+            screenshot.size()));
+        image.load (stream, "jpg");
+    }
+    catch (const std::exception&)
+    {
+        return false; // shown without a screenshot
+    }
+
+    return true;
+}
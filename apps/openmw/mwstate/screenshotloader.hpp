@@ -0,0 +1,60 @@
+#ifndef GAME_STATE_SCREENSHOTLOADER_H
+#define GAME_STATE_SCREENSHOTLOADER_H
+
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <OgreImage.h>
+
+namespace MWState
+{
+    /// \brief Reads the screenshots of saved games on a background thread
+    ///
+    /// Only the screenshot requested last is of interest. Requests that have not been started
+    /// when another one is made are dropped.
+    ///
+    /// The JPEG is decoded by getImage(), on the thread calling it: OGRE's image codecs are only
+    /// used from the main thread (the screenshot is encoded there too, see
+    /// StateManager::saveGame), since they are not documented to be thread safe.
+    class ScreenshotLoader
+    {
+            boost::scoped_ptr<boost::thread> mThread;
+            boost::mutex mMutex;
+            bool mRunning; ///< Does mThread still take requests?
+            boost::filesystem::path mRequest; ///< not started yet; empty if there is none
+            int mRequested; ///< number of the last request
+            int mLoaded; ///< number of the request mScreenshot holds; -1 if none
+            std::vector<char> mScreenshot; ///< encoded
+
+            ScreenshotLoader (const ScreenshotLoader&);
+            ///< Not implemented
+
+            ScreenshotLoader& operator= (const ScreenshotLoader&);
+            ///< Not implemented
+
+            void run();
+
+        public:
+
+            ScreenshotLoader();
+
+            ~ScreenshotLoader();
+            ///< Waits for the screenshot being loaded (if any).
+
+            void request (const boost::filesystem::path& path);
+            ///< Load the screenshot of the saved game at \a path instead of the last one requested.
+
+            void cancel();
+            ///< Drop the last request.
+
+            bool getImage (Ogre::Image& image);
+            ///< Take the screenshot requested last, once it has been read, and decode it.
+            /// \return Was it? False too if the saved game has no readable screenshot.
+    };
+}
+
+#endif
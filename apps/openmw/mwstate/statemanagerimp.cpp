@@ -1,6 +1,8 @@
 
 #include "statemanagerimp.hpp"
 
+#include <sstream>
+
 #include <components/esm/esmwriter.hpp>
 #include <components/esm/esmreader.hpp>
 #include <components/esm/cellid.hpp>
@@ -10,6 +12,7 @@
 
 #include <components/settings/settings.hpp>
 
+#include <OgreDataStream.h>
 #include <OgreImage.h>
 
 #include "../mwbase/environment.hpp"
@@ -46,6 +49,7 @@ void MWState::StateManager::cleanup (bool force)
         mState = State_NoGame;
         mCharacterManager.clearCurrentCharacter();
         mTimePlayed = 0;
+        mSaveWriter.clearBase();
     }
 }
 
@@ -172,44 +176,42 @@ void MWState::StateManager::saveGame (const std::string& description, const Slot
     profile.mTimePlayed = mTimePlayed;
     profile.mDescription = description;
 
-    int screenshotW = 259*2, screenshotH = 133*2; // *2 to get some nice antialiasing
-    Ogre::Image screenshot;
-    world.screenshot(screenshot, screenshotW, screenshotH);
-    Ogre::DataStreamPtr encoded = screenshot.encode("jpg");
-    profile.mScreenshot.resize(encoded->size());
-    encoded->read(&profile.mScreenshot[0], encoded->size());
-
+    // The slot gets its screenshot once the save is complete (see ScreenshotLoader)
     if (!slot)
         slot = mCharacterManager.getCurrentCharacter()->createSlot (profile);
     else
         slot = mCharacterManager.getCurrentCharacter()->updateSlot (slot, profile);
 
-    std::ofstream stream (slot->mPath.string().c_str(), std::ios::binary);
-
-    ESM::ESMWriter writer;
+    std::auto_ptr<SaveWriter::Job> job (new SaveWriter::Job);
 
-    const std::vector<std::string>& current =
-        MWBase::Environment::get().getWorld()->getContentFiles();
-
-    for (std::vector<std::string>::const_iterator iter (current.begin()); iter!=current.end();
-        ++iter)
-        writer.addMaster (*iter, 0); // not using the size information anyway -> use value of 0
+    // Encoded here: OGRE's image codecs are only used from the main thread, as they are not
+    // documented to be thread safe (the save list decodes on it too, see ScreenshotLoader)
+    int screenshotW = 259*2, screenshotH = 133*2; // *2 to get some nice antialiasing
+    Ogre::Image screenshot;
+    world.screenshot(screenshot, screenshotW, screenshotH);
+    Ogre::DataStreamPtr encoded = screenshot.encode("jpg");
+    profile.mScreenshot.resize(encoded->size());
+    encoded->read(&profile.mScreenshot[0], encoded->size());
 
-    writer.setFormat (ESM::Header::CurrentFormat);
-    writer.setRecordCount (
+    job->mPath = slot->mPath;
+    job->mProfile = profile;
+    job->mContentFiles = world.getContentFiles();
+    job->mFormat = ESM::Header::CurrentFormat;
+    job->mCompressed = Settings::Manager::getBool ("compress", "Saves");
+    job->mMaxDeltas = Settings::Manager::getInt ("max deltas", "Saves");
+    job->mRecordCount =
         1 // saved game header
         +MWBase::Environment::get().getJournal()->countSavedGameRecords()
         +MWBase::Environment::get().getWorld()->countSavedGameRecords()
         +MWBase::Environment::get().getScriptManager()->getGlobalScripts().countSavedGameRecords()
         +MWBase::Environment::get().getDialogueManager()->countSavedGameRecords()
-        +1 // global map
-        );
+        +1; // global map
 
-    writer.save (stream);
+    // Snapshot of the game state; the header and the SAVE record are written in the background
+    std::ostringstream stream;
 
-    writer.startRecord (ESM::REC_SAVE);
-    slot->mProfile.save (writer);
-    writer.endRecord (ESM::REC_SAVE);
+    ESM::ESMWriter writer;
+    writer.append (stream);
 
     MWBase::Environment::get().getJournal()->write (writer);
     MWBase::Environment::get().getDialogueManager()->write (writer);
@@ -219,20 +221,34 @@ void MWState::StateManager::saveGame (const std::string& description, const Slot
 
     writer.close();
 
+    job->mRecords = stream.str();
+
+    mSaveWriter.write (job);
+
     Settings::Manager::setString ("character", "Saves",
         slot->mPath.parent_path().filename().string());
 }
 
 void MWState::StateManager::loadGame (const Character *character, const Slot *slot)
 {
+    // The slot might still be being written
+    mSaveWriter.wait();
+
     try
     {
         cleanup();
 
         mTimePlayed = slot->mProfile.mTimePlayed;
 
+        // Combined with its bases, if it is a delta
+        std::string file;
+        SaveTable table;
+        int depth = 0;
+        SaveChain::read (slot->mPath, file, table, depth);
+
         ESM::ESMReader reader;
-        reader.open (slot->mPath.string());
+        reader.open (Ogre::DataStreamPtr (new Ogre::MemoryDataStream (&file[0], file.size(), false,
+            true)), slot->mPath.string());
 
         std::map<int, int> contentFileMap = buildContentFileIndexMap (reader);
 
@@ -295,6 +311,11 @@ void MWState::StateManager::loadGame (const Character *character, const Slot *sl
             }
         }
 
+        reader.close();
+
+        if (Settings::Manager::getInt ("max deltas", "Saves")>0)
+            mSaveWriter.setBase (slot->mPath, table, depth);
+
         mCharacterManager.setCurrentCharacter(character);
 
         mState = State_Running;
@@ -347,6 +368,25 @@ void MWState::StateManager::update (float duration)
 {
     mTimePlayed += duration;
 
+    SaveWriter::Result result;
+
+    while (mSaveWriter.getResult (result))
+    {
+        if (result.mError.empty())
+            mCharacterManager.finishSlot (result.mPath);
+        else
+        {
+            std::cerr << "failed to write saved game " << result.mPath.string() << ": "
+                << result.mError << std::endl;
+
+            // The saved game that was there before (if any) has been left alone
+            mCharacterManager.failSlot (result.mPath);
+
+            MWBase::Environment::get().getWindowManager()->messageBox (
+                "Failed to save the game: " + result.mError);
+        }
+    }
+
     // Note: It would be nicer to trigger this from InputManager, i.e. the very beginning of the frame update.
     if (mAskLoadRecent)
     {
@@ -8,6 +8,7 @@
 #include <boost/filesystem/path.hpp>
 
 #include "charactermanager.hpp"
+#include "savewriter.hpp"
 
 namespace MWState
 {
@@ -18,6 +19,7 @@ namespace MWState
             State mState;
             CharacterManager mCharacterManager;
             double mTimePlayed;
+            SaveWriter mSaveWriter;
 
         private:
 
@@ -45,7 +47,8 @@ namespace MWState
             virtual void endGame();
 
             virtual void saveGame (const std::string& description, const Slot *slot = 0);
-            ///< Write a saved game to \a slot or create a new slot if \a slot == 0.
+            ///< Write a saved game to \a slot or create a new slot if \a slot == 0. The file is
+            /// written in the background.
             ///
             /// \note Slot must belong to the current character.
 
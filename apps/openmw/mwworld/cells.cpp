@@ -13,6 +13,45 @@
 #include "containerstore.hpp"
 #include "cellstore.hpp"
 
+namespace
+{
+    template<typename T>
+    void listModel (const MWWorld::ESMStore& store, const std::string& id,
+        std::vector<std::string>& models)
+    {
+        if (const T *record = store.get<T>().search (id))
+            if (!record->mModel.empty())
+                models.push_back ("meshes\\" + record->mModel);
+    }
+
+    void listModel (const MWWorld::ESMStore& store, const std::string& id,
+        std::vector<std::string>& models)
+    {
+        // the same types CellStore::listModels covers
+        switch (store.find (id))
+        {
+            case ESM::REC_ACTI: listModel<ESM::Activator> (store, id, models); break;
+            case ESM::REC_ALCH: listModel<ESM::Potion> (store, id, models); break;
+            case ESM::REC_APPA: listModel<ESM::Apparatus> (store, id, models); break;
+            case ESM::REC_ARMO: listModel<ESM::Armor> (store, id, models); break;
+            case ESM::REC_BOOK: listModel<ESM::Book> (store, id, models); break;
+            case ESM::REC_CLOT: listModel<ESM::Clothing> (store, id, models); break;
+            case ESM::REC_CONT: listModel<ESM::Container> (store, id, models); break;
+            case ESM::REC_CREA: listModel<ESM::Creature> (store, id, models); break;
+            case ESM::REC_DOOR: listModel<ESM::Door> (store, id, models); break;
+            case ESM::REC_INGR: listModel<ESM::Ingredient> (store, id, models); break;
+            case ESM::REC_LIGH: listModel<ESM::Light> (store, id, models); break;
+            case ESM::REC_LOCK: listModel<ESM::Lockpick> (store, id, models); break;
+            case ESM::REC_MISC: listModel<ESM::Miscellaneous> (store, id, models); break;
+            case ESM::REC_NPC_: listModel<ESM::NPC> (store, id, models); break;
+            case ESM::REC_PROB: listModel<ESM::Probe> (store, id, models); break;
+            case ESM::REC_REPA: listModel<ESM::Repair> (store, id, models); break;
+            case ESM::REC_STAT: listModel<ESM::Static> (store, id, models); break;
+            case ESM::REC_WEAP: listModel<ESM::Weapon> (store, id, models); break;
+        }
+    }
+}
+
 MWWorld::CellStore *MWWorld::Cells::getCellStore (const ESM::Cell *cell)
 {
     if (cell->mData.mFlags & ESM::Cell::Interior)
@@ -124,6 +163,47 @@ MWWorld::CellStore *MWWorld::Cells::getExterior (int x, int y)
     return &result->second;
 }
 
+void MWWorld::Cells::listExteriorModels (int x, int y, std::vector<std::string>& models)
+{
+    std::map<std::pair<int, int>, CellStore>::const_iterator result =
+        mExteriors.find (std::make_pair (x, y));
+
+    if (result!=mExteriors.end() && result->second.getState()==CellStore::State_Loaded)
+    {
+        result->second.listModels (models);
+        return;
+    }
+
+    const ESM::Cell *cell = mStore.get<ESM::Cell>().search (x, y);
+
+    if (!cell)
+        return; // would be generated on the fly, without any references
+
+    // Read the references like CellStore::loadRefs, but only look up their models
+    for (size_t i = 0; i < cell->mContextList.size(); i++)
+    {
+        int index = cell->mContextList.at (i).index;
+        cell->restore (mReader[index], i);
+
+        ESM::CellRef ref;
+        bool deleted = false;
+
+        while (cell->getNextRef (mReader[index], ref, deleted))
+        {
+            if (deleted ||
+                std::find (cell->mMovedRefs.begin(), cell->mMovedRefs.end(), ref.mRefNum)!=
+                cell->mMovedRefs.end())
+                continue;
+
+            listModel (mStore, Misc::StringUtils::lowerCase (ref.mRefID), models);
+        }
+    }
+
+    for (ESM::CellRefTracker::const_iterator iter (cell->mLeasedRefs.begin());
+        iter!=cell->mLeasedRefs.end(); ++iter)
+        listModel (mStore, Misc::StringUtils::lowerCase (iter->mRefID), models);
+}
+
 MWWorld::CellStore *MWWorld::Cells::getInterior (const std::string& name)
 {
     std::string lowerName = Misc::StringUtils::lowerCase(name);
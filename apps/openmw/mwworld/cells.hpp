@@ -46,6 +46,11 @@ namespace MWWorld
 
             CellStore *getExterior (int x, int y);
 
+            void listExteriorModels (int x, int y, std::vector<std::string>& models);
+            ///< Append the models of the references in an exterior cell to \a models, without
+            /// creating or loading its CellStore. Cells that do not exist in the content files
+            /// are skipped.
+
             CellStore *getInterior (const std::string& name);
 
             CellStore *getCell (const ESM::CellId& id);
@@ -22,6 +22,17 @@
 
 namespace
 {
+    template<typename T>
+    void listModelsImp (const MWWorld::CellRefList<T>& list, std::vector<std::string>& models)
+    {
+        for (typename MWWorld::CellRefList<T>::List::const_iterator iter (list.mList.begin());
+             iter!=list.mList.end(); ++iter)
+        {
+            if (iter->mData.getCount() && !iter->mBase->mModel.empty())
+                models.push_back ("meshes\\" + iter->mBase->mModel);
+        }
+    }
+
     template<typename T>
     MWWorld::Ptr searchInContainerList (MWWorld::CellRefList<T>& containerList, const std::string& id)
     {
@@ -448,6 +459,29 @@ namespace MWWorld
         }
     }
 
+    void CellStore::listModels (std::vector<std::string>& models) const
+    {
+        // levelled lists have no model of their own
+        listModelsImp (mActivators, models);
+        listModelsImp (mPotions, models);
+        listModelsImp (mAppas, models);
+        listModelsImp (mArmors, models);
+        listModelsImp (mBooks, models);
+        listModelsImp (mClothes, models);
+        listModelsImp (mContainers, models);
+        listModelsImp (mDoors, models);
+        listModelsImp (mIngreds, models);
+        listModelsImp (mLights, models);
+        listModelsImp (mLockpicks, models);
+        listModelsImp (mMiscItems, models);
+        listModelsImp (mProbes, models);
+        listModelsImp (mRepairs, models);
+        listModelsImp (mStatics, models);
+        listModelsImp (mWeapons, models);
+        listModelsImp (mCreatures, models);
+        listModelsImp (mNpcs, models);
+    }
+
     bool CellStore::isExterior() const
     {
         return mCell->isExterior();
@@ -124,6 +124,10 @@ namespace MWWorld
                     forEachImp (functor, mCreatureLists);
             }
 
+            void listModels (std::vector<std::string>& models) const;
+            ///< Append the model paths of all references with a non-zero count to \a models.
+            /// Unlike forEach, this does not mark the cell as having state.
+
             bool isExterior() const;
 
             Ptr searchInContainer (const std::string& id);
@@ -0,0 +1,240 @@
+#include "contentcache.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/esmwriter.hpp>
+#include <components/files/memorymappedfile.hpp>
+#include <components/version/version.hpp>
+
+#include "esmstore.hpp"
+
+namespace
+{
+    /// Changes whenever the layout of the cache changes
+    const int sFormat = 1;
+
+    std::string serialize (const MWWorld::ESMStore& store)
+    {
+        std::ostringstream stream;
+
+        ESM::ESMWriter writer;
+        writer.setVersion();
+        writer.setFormat (0);
+        writer.save (stream);
+        store.writeSnapshot (writer);
+        writer.close();
+
+        return stream.str();
+    }
+
+    uint32_t getChecksum (const std::string& path)
+    {
+        MemoryMappedFile file;
+        file.open (path.c_str());
+
+        boost::crc_32_type crc;
+        crc.process_bytes (file.data(), file.size());
+
+        return crc.checksum();
+    }
+
+    /// Records are stored as ESMStore::writeSnapshot writes them, which depends on the build
+    std::string getBuild()
+    {
+        return std::string (OPENMW_VERSION) + " " + OPENMW_VERSION_COMMITHASH;
+    }
+}
+
+namespace MWWorld
+{
+    ContentCache::ContentCache (const boost::filesystem::path& file, int encoding)
+    : mFile (file), mEncoding (encoding)
+    {}
+
+    void ContentCache::setContentFiles (const std::vector<boost::filesystem::path>& files)
+    {
+        mKey.clear();
+
+        for (std::vector<boost::filesystem::path>::const_iterator iter (files.begin());
+            iter!=files.end(); ++iter)
+        {
+            FileKey key;
+            key.mPath = iter->string();
+            key.mSize = 0;
+            key.mTime = 0;
+
+            if (!key.mPath.empty())
+            {
+                key.mSize = boost::filesystem::file_size (*iter);
+                key.mTime = boost::filesystem::last_write_time (*iter);
+            }
+
+            mKey.push_back (key);
+        }
+    }
+
+    bool ContentCache::read (ESMStore& store) const
+    {
+        if (!boost::filesystem::exists (mFile))
+            return false;
+
+        ESM::ESMReader reader;
+
+        // Strings were converted when the content files were loaded
+        reader.setEncoder (0);
+
+        try
+        {
+            reader.open (mFile.string());
+
+            if (reader.getRecName()!="SNAP")
+                return false;
+
+            reader.getRecHeader();
+
+            int format = 0;
+            reader.getHNT (format, "FORM");
+
+            if (format!=sFormat || reader.getHNString ("BILD")!=getBuild())
+                return false;
+
+            int encoding = 0;
+            reader.getHNT (encoding, "ENCD");
+
+            if (encoding!=mEncoding)
+                return false;
+
+            std::vector<FileKey>::const_iterator key (mKey.begin());
+
+            for (; reader.isNextSub ("FILE"); ++key)
+            {
+                FileKey stored;
+                stored.mPath = reader.getHString();
+                reader.getHNT (stored.mSize, "SIZE");
+                reader.getHNT (stored.mTime, "TIME");
+
+                uint32_t checksum = 0;
+                reader.getHNT (checksum, "CRC_");
+
+                if (key==mKey.end() || stored.mPath!=key->mPath || stored.mSize!=key->mSize ||
+                    (stored.mTime!=key->mTime && checksum!=getChecksum (key->mPath)))
+                {
+                    std::cout << "Content files have changed, rebuilding " << mFile.string() << std::endl;
+                    return false;
+                }
+            }
+
+            if (key!=mKey.end())
+            {
+                std::cout << "Content files have changed, rebuilding " << mFile.string() << std::endl;
+                return false;
+            }
+
+            reader.skipRecord();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Ignoring content cache: " << e.what() << std::endl;
+            return false;
+        }
+
+        std::cout << "Loading records from content cache " << mFile.string() << std::endl;
+
+        try
+        {
+            store.readSnapshot (reader);
+        }
+        catch (...)
+        {
+            // The store is only partially filled, so there is no way back; make sure the next
+            // launch rebuilds the cache at least
+            boost::system::error_code error;
+            boost::filesystem::remove (mFile, error);
+            throw;
+        }
+
+        return true;
+    }
+
+    bool ContentCache::verify (const boost::filesystem::path& file, const ESMStore& store) const
+    {
+        // Snapshots depend on every record type's save() writing what its load() reads
+        ESMStore restored;
+
+        ESM::ESMReader reader;
+        reader.setEncoder (0);
+        reader.open (file.string());
+
+        reader.getRecName();
+        reader.getRecHeader();
+        reader.skipRecord();
+
+        restored.readSnapshot (reader);
+
+        return serialize (restored)==serialize (store);
+    }
+
+    void ContentCache::write (const ESMStore& store) const
+    {
+        // Written next to the cache and renamed once complete, so an interrupted write never
+        // leaves a truncated cache behind
+        boost::filesystem::path temp (mFile.string() + ".tmp");
+
+        try
+        {
+            boost::filesystem::create_directories (mFile.parent_path());
+
+            boost::filesystem::ofstream stream (temp, std::ios::binary);
+
+            ESM::ESMWriter writer;
+            writer.setVersion();
+            writer.setFormat (0);
+            writer.setDescription ("OpenMW content cache");
+            writer.save (stream);
+
+            writer.startRecord ("SNAP");
+            writer.writeHNT ("FORM", sFormat);
+            writer.writeHNCString ("BILD", getBuild());
+            writer.writeHNT ("ENCD", mEncoding);
+
+            for (std::vector<FileKey>::const_iterator iter (mKey.begin()); iter!=mKey.end(); ++iter)
+            {
+                writer.writeHNCString ("FILE", iter->mPath);
+                writer.writeHNT ("SIZE", iter->mSize);
+                writer.writeHNT ("TIME", iter->mTime);
+                writer.writeHNT ("CRC_", iter->mPath.empty() ? 0 : getChecksum (iter->mPath));
+            }
+
+            writer.endRecord ("SNAP");
+
+            store.writeSnapshot (writer);
+
+            writer.close();
+            stream.close();
+
+            if (!stream)
+                throw std::runtime_error ("write failed");
+
+            if (!verify (temp, store))
+                throw std::runtime_error ("records do not survive the round trip");
+
+            boost::filesystem::remove (mFile);
+            boost::filesystem::rename (temp, mFile);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to write content cache " << mFile.string() << ": " << e.what()
+                << std::endl;
+
+            boost::system::error_code error;
+            boost::filesystem::remove (temp, error);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef GAME_MWWORLD_CONTENTCACHE_H
+#define GAME_MWWORLD_CONTENTCACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+namespace MWWorld
+{
+    class ESMStore;
+
+    /// \brief Snapshot of the records loaded from the content files
+    ///
+    /// Keeps the merged records of an ESMStore (see ESMStore::writeSnapshot) in a single file,
+    /// together with a key of the content files they came from. As long as the key matches, the
+    /// next launch restores the records from the snapshot and only reads cells, land and path
+    /// grids from the content files.
+    class ContentCache
+    {
+        public:
+
+            ContentCache (const boost::filesystem::path& file, int encoding);
+            ///< \param encoding Encoding the content files are converted from; part of the key.
+
+            void setContentFiles (const std::vector<boost::filesystem::path>& files);
+            ///< Build the key from the size and modification time of \a files, in load order. Empty
+            /// paths stand for missing files.
+            ///
+            /// The cache also stores a checksum of each file, but it is only computed when the
+            /// cache is written, or when a file has the stored size and a different modification
+            /// time (so touching a file does not invalidate the cache).
+
+            bool read (ESMStore& store) const;
+            ///< Restore the records into the empty \a store, if the cache matches the key. Returns
+            /// false without touching \a store otherwise.
+
+            void write (const ESMStore& store) const;
+            ///< Replace the cache with the records loaded into \a store. Failures are logged, not
+            /// thrown.
+
+        private:
+
+            bool verify (const boost::filesystem::path& file, const ESMStore& store) const;
+            ///< Check that reading \a file restores the records of \a store
+
+            struct FileKey
+            {
+                std::string mPath;
+                uint64_t mSize;
+                int64_t mTime;
+            };
+
+            boost::filesystem::path mFile;
+            int mEncoding;
+            std::vector<FileKey> mKey;
+    };
+}
+
+#endif
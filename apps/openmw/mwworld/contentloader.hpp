@@ -21,6 +21,11 @@ struct ContentLoader
     {
     }
 
+    /// Called for every file before the first load(), so loaders can start work ahead
+    virtual void prepare(const boost::filesystem::path& filepath, int index)
+    {
+    }
+
     virtual void load(const boost::filesystem::path& filepath, int& index)
     {
       std::cout << "Loading content file " << filepath.string() << std::endl;
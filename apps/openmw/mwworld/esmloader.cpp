@@ -1,5 +1,6 @@
 #include "esmloader.hpp"
 #include "esmstore.hpp"
+#include "esmparser.hpp"
 
 #include "components/to_utf8/to_utf8.hpp"
 
@@ -7,14 +8,21 @@ namespace MWWorld
 {
 
 EsmLoader::EsmLoader(MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& readers,
-  ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener)
+  ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener, ESMParser* parser)
   : ContentLoader(listener)
   , mStore(store)
   , mEsm(readers)
   , mEncoder(encoder)
+  , mParser(parser)
 {
 }
 
+void EsmLoader::prepare(const boost::filesystem::path& filepath, int index)
+{
+  if (mParser)
+    mParser->queue(filepath.string(), index);
+}
+
 void EsmLoader::load(const boost::filesystem::path& filepath, int& index)
 {
   ContentLoader::load(filepath.filename(), index);
@@ -25,7 +33,7 @@ void EsmLoader::load(const boost::filesystem::path& filepath, int& index)
   lEsm.setGlobalReaderList(&mEsm);
   lEsm.open(filepath.string());
   mEsm[index] = lEsm;
-  mStore.load(mEsm[index], &mListener);
+  mStore.load(mEsm[index], &mListener, mParser);
 }
 
 } /* namespace MWWorld */
@@ -15,11 +15,14 @@ namespace MWWorld
 {
 
 class ESMStore;
+class ESMParser;
 
 struct EsmLoader : public ContentLoader
 {
     EsmLoader(MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& readers,
-      ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener);
+      ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener, ESMParser* parser = 0);
+
+    void prepare(const boost::filesystem::path& filepath, int index);
 
     void load(const boost::filesystem::path& filepath, int& index);
 
@@ -27,6 +30,7 @@ struct EsmLoader : public ContentLoader
       std::vector<ESM::ESMReader>& mEsm;
       MWWorld::ESMStore& mStore;
       ToUTF8::Utf8Encoder* mEncoder;
+      ESMParser* mParser;
 };
 
 } /* namespace MWWorld */
@@ -0,0 +1,216 @@
+#include "esmparser.hpp"
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+
+#include <components/esm/esmreader.hpp>
+#include <components/to_utf8/to_utf8.hpp>
+
+#include "esmstore.hpp"
+
+namespace
+{
+    /// Files are split into chunks of about this many bytes, so the merge can start early and
+    /// large files spread over all workers
+    const size_t sChunkSize = 1024*1024;
+}
+
+namespace MWWorld
+{
+    ParsedRecord::ParsedRecord (size_t offset)
+    : mType (Type_InOrder), mName (0), mOffset (offset), mRecord (0)
+    {}
+
+    void ParsedRecord::reset()
+    {
+        delete mRecord;
+        mRecord = 0;
+        mId.clear();
+        mType = Type_InOrder;
+    }
+
+    ESMParser::Chunk::~Chunk()
+    {
+        for (std::vector<ParsedRecord>::iterator iter (mRecords.begin()); iter!=mRecords.end(); ++iter)
+            delete iter->mRecord;
+    }
+
+    ESMParser::ESMParser (const ESMStore& store, const ToUTF8::Utf8Encoder *encoder, int threads)
+    : mStore (store), mEncoder (encoder), mQuit (false)
+    {
+        for (int i=0; i<threads; ++i)
+            mThreads.create_thread (boost::bind (&ESMParser::run, this));
+    }
+
+    ESMParser::~ESMParser()
+    {
+        {
+            boost::mutex::scoped_lock lock (mMutex);
+            mQuit = true;
+        }
+
+        mCondition.notify_all();
+        mThreads.join_all();
+    }
+
+    void ESMParser::queue (const std::string& file, int index)
+    {
+        std::vector<ChunkPtr> chunks;
+
+        try
+        {
+            ESM::ESMReader reader;
+            reader.open (file);
+
+            ChunkPtr chunk;
+
+            while (reader.hasMoreRecs())
+            {
+                size_t offset = reader.getFileOffset();
+
+                if (!chunk || offset-chunk->mRecords.front().mOffset>=sChunkSize)
+                {
+                    chunk.reset (new Chunk);
+                    chunk->mFile = file;
+                    chunk->mIndex = index;
+                    chunk->mDone = false;
+                    chunks.push_back (chunk);
+                }
+
+                chunk->mRecords.push_back (ParsedRecord (offset));
+
+                reader.getRecName();
+                reader.getRecHeader();
+                reader.skipRecord();
+
+                chunk->mEnd = reader.getFileOffset();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Can't parse " << file << " in the background: " << e.what() << std::endl;
+            return;
+        }
+
+        {
+            boost::mutex::scoped_lock lock (mMutex);
+
+            std::deque<ChunkPtr>& pending = mFiles[index];
+            pending.insert (pending.end(), chunks.begin(), chunks.end());
+            mQueue.insert (mQueue.end(), chunks.begin(), chunks.end());
+        }
+
+        mCondition.notify_all();
+    }
+
+    bool ESMParser::isQueued (int index) const
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+        return mFiles.count (index)!=0;
+    }
+
+    ESMParser::ChunkPtr ESMParser::take (int index)
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+
+        std::map<int, std::deque<ChunkPtr> >::iterator file = mFiles.find (index);
+
+        if (file==mFiles.end())
+            return ChunkPtr();
+
+        if (file->second.empty())
+        {
+            mFiles.erase (file);
+            return ChunkPtr();
+        }
+
+        ChunkPtr chunk = file->second.front();
+        file->second.pop_front();
+
+        while (!chunk->mDone)
+            mCondition.wait (lock);
+
+        return chunk;
+    }
+
+    void ESMParser::run()
+    {
+        // Encoders keep a conversion buffer, so every worker needs its own
+        std::auto_ptr<ToUTF8::Utf8Encoder> encoder;
+        if (mEncoder)
+            encoder.reset (new ToUTF8::Utf8Encoder (*mEncoder));
+
+        ESM::ESMReader reader;
+        reader.setEncoder (encoder.get());
+
+        while (true)
+        {
+            ChunkPtr chunk;
+
+            {
+                boost::mutex::scoped_lock lock (mMutex);
+
+                while (mQueue.empty() && !mQuit)
+                    mCondition.wait (lock);
+
+                if (mQuit)
+                    return;
+
+                chunk = mQueue.front();
+                mQueue.pop_front();
+            }
+
+            parse (*chunk, reader);
+
+            {
+                boost::mutex::scoped_lock lock (mMutex);
+                chunk->mDone = true;
+            }
+
+            mCondition.notify_all();
+        }
+    }
+
+    void ESMParser::parse (Chunk& chunk, ESM::ESMReader& reader) const
+    {
+        try
+        {
+            if (reader.getName()!=chunk.mFile)
+            {
+                // Some records depend on the file header
+                reader.open (chunk.mFile);
+                reader.setIndex (chunk.mIndex);
+            }
+        }
+        catch (const std::exception&)
+        {
+            reader.close();
+
+            // All records stay Type_InOrder
+            return;
+        }
+
+        for (std::vector<ParsedRecord>::iterator iter (chunk.mRecords.begin());
+            iter!=chunk.mRecords.end(); ++iter)
+        {
+            try
+            {
+                reader.seekRecord (iter->mOffset);
+                mStore.parse (reader, *iter);
+
+                // The sequential load fails on the next record then
+                if (reader.hasMoreSubs())
+                    iter->reset();
+            }
+            catch (const std::exception&)
+            {
+                // Loading the record in order reports the error, at the point the sequential
+                // load would have
+                iter->reset();
+            }
+        }
+    }
+}
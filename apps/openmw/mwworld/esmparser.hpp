@@ -0,0 +1,116 @@
+#ifndef GAME_MWWORLD_ESMPARSER_H
+#define GAME_MWWORLD_ESMPARSER_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "store.hpp"
+
+namespace ESM
+{
+    class ESMReader;
+}
+
+namespace ToUTF8
+{
+    class Utf8Encoder;
+}
+
+namespace MWWorld
+{
+    class ESMStore;
+
+    /// One record of a content file, as read by ESMStore::parse
+    struct ParsedRecord
+    {
+        enum Type
+        {
+            Type_InOrder,   ///< has to be loaded from the file by ESMStore::load
+            Type_Store,     ///< record of a store, in mRecord
+            Type_Deleted,   ///< record of a store, flagged as deleted
+            Type_Info,      ///< dialogue info, in mRecord; belongs to the last dialogue
+            Type_Skipped    ///< already restored by ESMStore::readSnapshot
+        };
+
+        Type mType;
+        int mName;
+        size_t mOffset; ///< start of the record in the file
+        std::string mId;
+        StoreBase::Parsed *mRecord;
+
+        ParsedRecord (size_t offset);
+
+        void reset();
+        ///< Drop the parsed data and fall back to Type_InOrder
+    };
+
+    /// \brief Parses content files on worker threads ahead of ESMStore::load
+    ///
+    /// Each queued file is split into chunks of consecutive records, which the workers parse
+    /// into ParsedRecords without touching the store. ESMStore::load then merges the chunks in
+    /// file order on the calling thread. Records that depend on what was loaded before them
+    /// (cells, land, dialogues ...) or that failed to parse are left to the merge, which reads
+    /// them from the file like a sequential load would.
+    class ESMParser
+    {
+        public:
+
+            /// Consecutive records of a file
+            struct Chunk
+            {
+                std::string mFile;
+                int mIndex;
+                std::vector<ParsedRecord> mRecords;
+                size_t mEnd; ///< end of the last record in the file
+                bool mDone;
+
+                ~Chunk();
+            };
+
+            typedef boost::shared_ptr<Chunk> ChunkPtr;
+
+            ESMParser (const ESMStore& store, const ToUTF8::Utf8Encoder *encoder, int threads);
+            ///< \param encoder Copied for each worker. May be 0.
+
+            ~ESMParser();
+
+            void queue (const std::string& file, int index);
+            ///< Start parsing \a file, which will be loaded as content file number \a index. Files
+            /// that can not be split into records are not queued; loading them reports the error.
+
+            bool isQueued (int index) const;
+
+            ChunkPtr take (int index);
+            ///< Wait for the next chunk of file \a index, in file order. Returns an empty pointer
+            /// once all chunks have been taken.
+
+        private:
+
+            ESMParser (const ESMParser&);
+            ESMParser& operator= (const ESMParser&);
+
+            void run();
+
+            void parse (Chunk& chunk, ESM::ESMReader& reader) const;
+
+            const ESMStore& mStore;
+            const ToUTF8::Utf8Encoder *mEncoder;
+
+            std::deque<ChunkPtr> mQueue;
+            std::map<int, std::deque<ChunkPtr> > mFiles;
+
+            bool mQuit;
+            mutable boost::mutex mMutex;
+            boost::condition_variable mCondition;
+            boost::thread_group mThreads;
+    };
+}
+
+#endif
@@ -7,6 +7,8 @@
 
 #include <components/loadinglistener/loadinglistener.hpp>
 
+#include "esmparser.hpp"
+
 namespace MWWorld
 {
 
@@ -23,7 +25,22 @@ static bool isCacheableRecord(int id)
     return false;
 }
 
-void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
+// Records that refer back to their content file are not part of a snapshot
+static bool isSnapshotRecord(int id)
+{
+    return id != ESM::REC_CELL && id != ESM::REC_LAND && id != ESM::REC_LTEX && id != ESM::REC_PGRD;
+}
+
+namespace
+{
+    /// An INFO record parsed by ESMStore::parse
+    struct ParsedInfo : public StoreBase::Parsed
+    {
+        ESM::DialInfo mInfo;
+    };
+}
+
+void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener, ESMParser *parser)
 {
     listener->setProgressRange(1000);
 
@@ -59,59 +76,52 @@ void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
         mast.index = index;
     }
 
-    // Loop through all records
-    while(esm.hasMoreRecs())
-    {
-        ESM::NAME n = esm.getRecName();
-        esm.getRecHeader();
+    std::map<int, ESM::RecordIndex>::const_iterator recordIndex = mIndices.find(esm.getIndex());
 
-        // Look up the record type.
-        std::map<int, StoreBase *>::iterator it = mStores.find(n.val);
-
-        if (it == mStores.end()) {
-            if (n.val == ESM::REC_INFO) {
-                std::string id = esm.getHNOString("INAM");
-                if (dialogue) {
-                    dialogue->mInfo.push_back(ESM::DialInfo());
-                    dialogue->mInfo.back().mId = id;
-                    dialogue->mInfo.back().load(esm);
-                } else {
-                    std::cerr << "error: info record without dialog" << std::endl;
-                    esm.skipRecord();
-                }
-            } else if (n.val == ESM::REC_MGEF) {
-                mMagicEffects.load (esm);
-            } else if (n.val == ESM::REC_SKIL) {
-                mSkills.load (esm);
-            } else {
-                // Not found (this would be an error later)
-                esm.skipRecord();
-                missing.insert(n.toString());
-            }
-        } else {
-            // Load it
-            std::string id = esm.getHNOString("NAME");
-            // ... unless it got deleted! This means that the following record
-            //  has been deleted, and trying to load it using standard assumptions
-            //  on the structure will (probably) fail.
-            if (esm.isNextSub("DELE")) {
-              esm.skipRecord();
-              it->second->eraseStatic(id);
-              continue;
-            }
-            it->second->load(esm, id);
+    if (!mSnapshot) {
+        mIndices[esm.getIndex()].clear();
+    }
 
-            if (n.val==ESM::REC_DIAL) {
-                dialogue = const_cast<ESM::Dialogue*>(mDialogs.find(id));
-            } else {
-                dialogue = 0;
+    if (mSnapshot && recordIndex != mIndices.end()) {
+        // Only visit the records the snapshot does not have. Land and path grids are not even
+        // read until they are needed.
+        const std::vector<ESM::RecordIndex::Entry> &entries = recordIndex->second.getEntries();
+
+        for (std::vector<ESM::RecordIndex::Entry>::const_iterator it = entries.begin();
+             it != entries.end(); ++it) {
+            std::map<int, StoreBase *>::iterator store = mStores.find(it->mType);
+
+            if (store == mStores.end() || !store->second->loadLazy(esm, it->mOffset, it->mId)) {
+                esm.seekRecord(it->mOffset);
+                ESM::NAME n = esm.getRecName();
+                esm.getRecHeader();
+                loadRecord(esm, n, dialogue, missing);
             }
-            // Insert the reference into the global lookup
-            if (!id.empty() && isCacheableRecord(n.val)) {
-                mIds[Misc::StringUtils::lowerCase (id)] = n.val;
+            listener->setProgress(it->mOffset / (float)esm.getFileSize() * 1000);
+        }
+
+        esm.seekRecord(esm.getFileSize());
+    } else if (parser && parser->isQueued(esm.getIndex())) {
+        // Merge the records parsed in the background, in file order
+        while (ESMParser::ChunkPtr chunk = parser->take(esm.getIndex())) {
+            for (std::vector<ParsedRecord>::const_iterator it = chunk->mRecords.begin();
+                 it != chunk->mRecords.end(); ++it) {
+                mergeRecord(esm, *it, dialogue, missing);
             }
+            listener->setProgress(chunk->mEnd / (float)esm.getFileSize() * 1000);
+        }
+
+        // Leave the reader where a sequential load would have
+        esm.seekRecord(esm.getFileSize());
+    } else {
+        // Loop through all records
+        while(esm.hasMoreRecs())
+        {
+            ESM::NAME n = esm.getRecName();
+            esm.getRecHeader();
+            loadRecord(esm, n, dialogue, missing);
+            listener->setProgress(esm.getFileOffset() / (float)esm.getFileSize() * 1000);
         }
-        listener->setProgress(esm.getFileOffset() / (float)esm.getFileSize() * 1000);
     }
 
   /* This information isn't needed on screen. But keep the code around
@@ -128,6 +138,221 @@ void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
   */
 }
 
+void ESMStore::loadRecord(ESM::ESMReader &esm, ESM::NAME n, ESM::Dialogue *&dialogue,
+    std::set<std::string> &missing)
+{
+    if (mSnapshot && isSnapshotRecord(n.val)) {
+        esm.skipRecord();
+        return;
+    }
+
+    if (!mSnapshot && !isSnapshotRecord(n.val)) {
+        // Index the record for the snapshot, see writeSnapshot()
+        ESM::ESM_Context context = esm.getContext();
+        std::string id = ESM::RecordIndex::readId(esm, n.val);
+        esm.restoreContext(context);
+
+        mIndices[esm.getIndex()].add(n.val, esm.getRecordOffset(), id);
+    }
+
+    // Look up the record type.
+    std::map<int, StoreBase *>::iterator it = mStores.find(n.val);
+
+    if (it == mStores.end()) {
+        if (n.val == ESM::REC_INFO) {
+            std::string id = esm.getHNOString("INAM");
+            if (dialogue) {
+                dialogue->mInfo.push_back(ESM::DialInfo());
+                dialogue->mInfo.back().mId = id;
+                dialogue->mInfo.back().load(esm);
+            } else {
+                std::cerr << "error: info record without dialog" << std::endl;
+                esm.skipRecord();
+            }
+        } else if (n.val == ESM::REC_MGEF) {
+            mMagicEffects.load (esm);
+        } else if (n.val == ESM::REC_SKIL) {
+            mSkills.load (esm);
+        } else {
+            // Not found (this would be an error later)
+            esm.skipRecord();
+            missing.insert(n.toString());
+        }
+    } else {
+        // Load it
+        std::string id = esm.getHNOString("NAME");
+        // ... unless it got deleted! This means that the following record
+        //  has been deleted, and trying to load it using standard assumptions
+        //  on the structure will (probably) fail.
+        if (esm.isNextSub("DELE")) {
+          esm.skipRecord();
+          it->second->eraseStatic(id);
+          return;
+        }
+        it->second->load(esm, id);
+
+        if (n.val==ESM::REC_DIAL) {
+            dialogue = const_cast<ESM::Dialogue*>(mDialogs.find(id));
+        } else {
+            dialogue = 0;
+        }
+        // Insert the reference into the global lookup
+        if (!id.empty() && isCacheableRecord(n.val)) {
+            setId(id, n.val);
+        }
+    }
+}
+
+void ESMStore::parse(ESM::ESMReader &esm, ParsedRecord &record) const
+{
+    // Mirrors loadRecord(). Everything that depends on records before this one is
+    // left as Type_InOrder.
+    ESM::NAME n = esm.getRecName();
+    esm.getRecHeader();
+    record.mName = n.val;
+
+    if (mSnapshot && isSnapshotRecord(n.val)) {
+        record.mType = ParsedRecord::Type_Skipped;
+        return;
+    }
+
+    std::map<int, StoreBase *>::const_iterator it = mStores.find(n.val);
+
+    if (it == mStores.end()) {
+        if (n.val == ESM::REC_INFO) {
+            ParsedInfo *info = new ParsedInfo;
+            record.mRecord = info;
+            info->mInfo.mId = esm.getHNOString("INAM");
+            info->mInfo.load(esm);
+            record.mType = ParsedRecord::Type_Info;
+        }
+        return;
+    }
+
+    record.mId = esm.getHNOString("NAME");
+    if (esm.isNextSub("DELE")) {
+        record.mType = ParsedRecord::Type_Deleted;
+        return;
+    }
+
+    record.mRecord = it->second->parse(esm, record.mId);
+    if (record.mRecord) {
+        record.mType = ParsedRecord::Type_Store;
+    }
+}
+
+void ESMStore::mergeRecord(ESM::ESMReader &esm, const ParsedRecord &record, ESM::Dialogue *&dialogue,
+    std::set<std::string> &missing)
+{
+    switch (record.mType) {
+        case ParsedRecord::Type_InOrder:
+        {
+            esm.seekRecord(record.mOffset);
+            ESM::NAME n = esm.getRecName();
+            esm.getRecHeader();
+            loadRecord(esm, n, dialogue, missing);
+
+            // Seeking to the next record would hide this
+            if (esm.hasMoreSubs() && esm.hasMoreRecs()) {
+                esm.fail("Previous record contains unread bytes");
+            }
+            break;
+        }
+
+        case ParsedRecord::Type_Skipped:
+            break;
+
+        case ParsedRecord::Type_Store:
+            mStores[record.mName]->merge(*record.mRecord);
+
+            // Dialogues are always loaded in order
+            dialogue = 0;
+            if (!record.mId.empty() && isCacheableRecord(record.mName)) {
+                setId(record.mId, record.mName);
+            }
+            break;
+
+        case ParsedRecord::Type_Deleted:
+            mStores[record.mName]->eraseStatic(record.mId);
+            break;
+
+        case ParsedRecord::Type_Info:
+            if (dialogue) {
+                dialogue->mInfo.push_back(static_cast<const ParsedInfo *>(record.mRecord)->mInfo);
+            } else {
+                std::cerr << "error: info record without dialog" << std::endl;
+            }
+            break;
+    }
+}
+
+void ESMStore::setId(const std::string &id, int type)
+{
+    Misc::IdAtoms::Atom atom = Misc::IdAtoms::intern(id);
+    if (atom >= mIds.size()) {
+        mIds.resize(atom + 1, 0);
+    }
+    mIds[atom] = type;
+}
+
+void ESMStore::writeSnapshot(ESM::ESMWriter &writer) const
+{
+    for (std::map<int, StoreBase *>::const_iterator it = mStores.begin(); it != mStores.end(); ++it) {
+        it->second->writeStatic(writer);
+    }
+    mMagicEffects.writeStatic(writer);
+    mSkills.writeStatic(writer);
+
+    // mIds keeps deleted records as well, so it can't be rebuilt from the stores
+    writer.startRecord("IDMP");
+    for (Misc::IdAtoms::Atom id = 1; id < mIds.size(); ++id) {
+        if (mIds[id] != 0) {
+            writer.writeHNCString("NAME", Misc::IdAtoms::getId(id));
+            writer.writeHNT("INDX", mIds[id]);
+        }
+    }
+    writer.endRecord("IDMP");
+
+    for (std::map<int, ESM::RecordIndex>::const_iterator it = mIndices.begin(); it != mIndices.end(); ++it) {
+        writer.startRecord("RIDX");
+        writer.writeHNT("FILE", it->first);
+        it->second.save(writer);
+        writer.endRecord("RIDX");
+    }
+}
+
+void ESMStore::readSnapshot(ESM::ESMReader &esm)
+{
+    std::set<std::string> missing;
+    std::vector<int> ids;
+
+    ESM::Dialogue *dialogue = 0;
+
+    while (esm.hasMoreRecs()) {
+        ESM::NAME n = esm.getRecName();
+        esm.getRecHeader();
+
+        if (n == "IDMP") {
+            while (esm.hasMoreSubs()) {
+                Misc::IdAtoms::Atom id = Misc::IdAtoms::intern(esm.getHNString("NAME"));
+                if (id >= ids.size()) {
+                    ids.resize(id + 1, 0);
+                }
+                esm.getHNT(ids[id], "INDX");
+            }
+        } else if (n == "RIDX") {
+            int file;
+            esm.getHNT(file, "FILE");
+            mIndices[file].load(esm);
+        } else {
+            loadRecord(esm, n, dialogue, missing);
+        }
+    }
+
+    mIds.swap(ids);
+    mSnapshot = true;
+}
+
 void ESMStore::setUp()
 {
     std::map<int, StoreBase *>::iterator it = mStores.begin();
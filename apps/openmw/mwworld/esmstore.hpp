@@ -1,6 +1,7 @@
 #ifndef OPENMW_MWWORLD_ESMSTORE_H
 #define OPENMW_MWWORLD_ESMSTORE_H
 
+#include <set>
 #include <stdexcept>
 
 #include <components/esm/records.hpp>
@@ -13,6 +14,9 @@ namespace Loading
 
 namespace MWWorld
 {
+    struct ParsedRecord;
+    class ESMParser;
+
     class ESMStore
     {
         Store<ESM::Activator>       mActivators;
@@ -65,14 +69,31 @@ namespace MWWorld
         Store<ESM::Attribute>   mAttributes;
 
         // Lookup of all IDs. Makes looking up references faster. Just
-        // maps the id name to the record type.
-        std::map<std::string, int> mIds;
+        // maps the id atom to the record type (0 for unknown ids).
+        std::vector<int> mIds;
         std::map<int, StoreBase *> mStores;
 
         ESM::NPC mPlayerTemplate;
 
         unsigned int mDynamicCount;
 
+        /// True once readSnapshot() restored the records content files would provide
+        bool mSnapshot;
+
+        /// Records of each content file that are not part of a snapshot, by content file index
+        std::map<int, ESM::RecordIndex> mIndices;
+
+        void loadRecord(ESM::ESMReader &esm, ESM::NAME n, ESM::Dialogue *&dialogue,
+            std::set<std::string> &missing);
+        ///< Load the record \a n, whose header has just been read from \a esm
+
+        void mergeRecord(ESM::ESMReader &esm, const ParsedRecord &record, ESM::Dialogue *&dialogue,
+            std::set<std::string> &missing);
+        ///< Same effect as loadRecord() for the record \a record was parsed from
+
+        void setId(const std::string &id, int type);
+        ///< Add \a id to the lookup of all IDs
+
     public:
         /// \todo replace with SharedIterator<StoreBase>
         typedef std::map<int, StoreBase *>::const_iterator iterator;
@@ -88,15 +109,19 @@ namespace MWWorld
         // Look up the given ID in 'all'. Returns 0 if not found.
         int find(const std::string &id) const
         {
-            std::map<std::string, int>::const_iterator it = mIds.find(id);
-            if (it == mIds.end()) {
+            return find(Misc::IdAtoms::search(id));
+        }
+
+        int find(Misc::IdAtoms::Atom id) const
+        {
+            if (id >= mIds.size()) {
                 return 0;
             }
-            return it->second;
+            return mIds[id];
         }
 
         ESMStore()
-          : mDynamicCount(0)
+          : mDynamicCount(0), mSnapshot(false)
         {
             // Cell store needs access to this for tracking moved references
             mCells.mEsmStore = this;
@@ -157,7 +182,13 @@ namespace MWWorld
             mNpcs.insert(mPlayerTemplate);
         }
 
-        void load(ESM::ESMReader &esm, Loading::Listener* listener);
+        void load(ESM::ESMReader &esm, Loading::Listener* listener, ESMParser *parser = 0);
+        ///< \param parser If the file of \a esm was queued there, merge the records parsed in the
+        /// background instead of reading them all from \a esm. The result is the same.
+
+        void parse(ESM::ESMReader &esm, ParsedRecord &record) const;
+        ///< Parse the record at the current position of \a esm for a later load(), without
+        /// modifying the store. Called from the worker threads of an ESMParser.
 
         template <class T>
         const Store<T> &get() const {
@@ -181,7 +212,7 @@ namespace MWWorld
             T *ptr = store.insert(record);
             for (iterator it = mStores.begin(); it != mStores.end(); ++it) {
                 if (it->second == &store) {
-                    mIds[ptr->mId] = it->first;
+                    setId(ptr->mId, it->first);
                 }
             }
             return ptr;
@@ -200,12 +231,22 @@ namespace MWWorld
             T *ptr = store.insertStatic(record);
             for (iterator it = mStores.begin(); it != mStores.end(); ++it) {
                 if (it->second == &store) {
-                    mIds[ptr->mId] = it->first;
+                    setId(ptr->mId, it->first);
                 }
             }
             return ptr;
         }
 
+        void writeSnapshot(ESM::ESMWriter &writer) const;
+        ///< Write the records loaded so far in merged form, except cells, land, land textures
+        /// and path grids, which refer back to their content files. These are written as an
+        /// index of their offsets instead.
+
+        void readSnapshot(ESM::ESMReader &esm);
+        ///< Restore the records of a snapshot into an empty store. Content files loaded
+        /// afterwards only contribute the records that are not part of a snapshot, which are
+        /// looked up in the index instead of reading the whole file.
+
         // This method must be called once, after loading all master/plugin files. This can only be done
         //  from the outside, so it must be public.
         void setUp();
@@ -239,7 +280,7 @@ namespace MWWorld
         record.mId = id.str();
 
         ESM::NPC *ptr = mNpcs.insert(record);
-        mIds[ptr->mId] = ESM::REC_NPC_;
+        setId(ptr->mId, ESM::REC_NPC_);
         return ptr;
     }
 
@@ -0,0 +1,55 @@
+#include "flatindex.hpp"
+
+namespace MWWorld
+{
+    const unsigned int FlatIndex::sNone;
+
+    FlatIndex::FlatIndex() : mSize (0) {}
+
+    void FlatIndex::grow()
+    {
+        Slot free;
+        free.mHash = 0;
+        free.mRecord = sNone;
+
+        std::vector<Slot> slots (mSlots.empty() ? 16 : mSlots.size()*2, free);
+        mSlots.swap (slots);
+        mSize = 0;
+
+        for (std::vector<Slot>::const_iterator iter (slots.begin()); iter!=slots.end(); ++iter)
+            if (iter->mRecord!=sNone)
+                insert (iter->mHash, iter->mRecord);
+    }
+
+    void FlatIndex::insert (unsigned int hash, unsigned int record)
+    {
+        if ((mSize+1)*2 > mSlots.size())
+            grow();
+
+        std::size_t mask = mSlots.size()-1;
+        std::size_t slot = hash & mask;
+
+        while (mSlots[slot].mRecord!=sNone)
+            slot = (slot+1) & mask;
+
+        mSlots[slot].mHash = hash;
+        mSlots[slot].mRecord = record;
+        ++mSize;
+    }
+
+    void FlatIndex::clear()
+    {
+        mSlots.clear();
+        mSize = 0;
+    }
+
+    std::size_t FlatIndex::size() const
+    {
+        return mSize;
+    }
+
+    std::size_t FlatIndex::getMemoryUsage() const
+    {
+        return mSlots.capacity() * sizeof (Slot);
+    }
+}
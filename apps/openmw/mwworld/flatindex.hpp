@@ -0,0 +1,105 @@
+#ifndef GAME_MWWORLD_FLATINDEX_H
+#define GAME_MWWORLD_FLATINDEX_H
+
+#include <cstddef>
+#include <vector>
+
+namespace MWWorld
+{
+    /// \brief Open addressing hash table of record numbers
+    ///
+    /// Maps hashes to the numbers of records kept elsewhere, for example in a std::deque. Lookups
+    /// check the candidate records with a predicate, so the index itself holds no keys. Uses
+    /// linear probing and stays at most half full, so probe sequences stay short.
+    class FlatIndex
+    {
+            struct Slot
+            {
+                unsigned int mHash;
+                unsigned int mRecord; ///< sNone for free slots
+            };
+
+            std::vector<Slot> mSlots;
+            std::size_t mSize;
+
+            void grow();
+
+        public:
+
+            static const unsigned int sNone = static_cast<unsigned int> (-1);
+
+            FlatIndex();
+
+            template<class Match>
+            unsigned int find (unsigned int hash, const Match& match) const
+            ///< Number of the record with hash \a hash for which \a match returns true, or sNone.
+            {
+                if (mSlots.empty())
+                    return sNone;
+
+                std::size_t mask = mSlots.size()-1;
+
+                for (std::size_t slot = hash & mask; mSlots[slot].mRecord!=sNone; slot = (slot+1) & mask)
+                    if (mSlots[slot].mHash==hash && match (mSlots[slot].mRecord))
+                        return mSlots[slot].mRecord;
+
+                return sNone;
+            }
+
+            void insert (unsigned int hash, unsigned int record);
+            ///< \attention \a record must not be in the index already.
+
+            template<class Match>
+            bool erase (unsigned int hash, const Match& match)
+            ///< Remove the record find() would return. \return Was there such a record?
+            {
+                if (mSlots.empty())
+                    return false;
+
+                std::size_t mask = mSlots.size()-1;
+                std::size_t slot = hash & mask;
+
+                for (; mSlots[slot].mRecord!=sNone; slot = (slot+1) & mask)
+                    if (mSlots[slot].mHash==hash && match (mSlots[slot].mRecord))
+                        break;
+
+                if (mSlots[slot].mRecord==sNone)
+                    return false;
+
+                // Move later entries of the probe sequence up, instead of leaving a tombstone
+                std::size_t next = slot;
+
+                while (true)
+                {
+                    next = (next+1) & mask;
+
+                    if (mSlots[next].mRecord==sNone)
+                        break;
+
+                    std::size_t home = mSlots[next].mHash & mask;
+
+                    // Can the entry at next move to slot without leaving its probe sequence?
+                    if (((next-home) & mask) >= ((next-slot) & mask))
+                    {
+                        mSlots[slot] = mSlots[next];
+                        slot = next;
+                    }
+                }
+
+                mSlots[slot].mRecord = sNone;
+                --mSize;
+
+                return true;
+            }
+
+            void clear();
+
+            std::size_t size() const;
+            ///< Number of records in the index
+
+            std::size_t getMemoryUsage() const;
+            ///< Bytes allocated by the index
+    };
+}
+
+#endif
@@ -19,7 +19,7 @@ namespace MWWorld
             ManualRef& operator= (const ManualRef&);
 
             template<typename T>
-            bool create (const MWWorld::Store<T>& list, const std::string& name)
+            bool create (const MWWorld::Store<T>& list, Misc::IdAtoms::Atom name)
             {
                 if (const T *instance = list.search (name))
                 {
@@ -39,9 +39,11 @@ namespace MWWorld
 
         public:
 
-            ManualRef (const MWWorld::ESMStore& store, const std::string& name, const int count=1)
+            ManualRef (const MWWorld::ESMStore& store, const std::string& id, const int count=1)
             {
                 // create
+                Misc::IdAtoms::Atom name = Misc::IdAtoms::search (id);
+
                 if (!create (store.get<ESM::Activator>(), name) &&
                     !create (store.get<ESM::Potion>(), name) &&
                     !create (store.get<ESM::Apparatus>(), name) &&
@@ -62,11 +64,11 @@ namespace MWWorld
                     !create (store.get<ESM::Repair>(), name) &&
                     !create (store.get<ESM::Static>(), name) &&
                     !create (store.get<ESM::Weapon>(), name))
-                    throw std::logic_error ("failed to create manual cell ref for " + name);
+                    throw std::logic_error ("failed to create manual cell ref for " + id);
 
                 // initialise
                 ESM::CellRef& cellRef = mPtr.getCellRef();
-                cellRef.mRefID = Misc::StringUtils::lowerCase (name);
+                cellRef.mRefID = Misc::IdAtoms::getId (name);
                 cellRef.mRefNum.mIndex = 0;
                 cellRef.mRefNum.mContentFile = -1;
                 cellRef.mScale = 1;
@@ -1,8 +1,14 @@
 #include "scene.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+
 #include <OgreSceneNode.h>
 
+#include <components/misc/stringops.hpp>
 #include <components/nif/niffile.hpp>
+#include <components/nif/preloader.hpp>
+#include <components/vfs/prefetcher.hpp>
 
 #include <libs/openengine/ogre/fader.hpp>
 
@@ -261,6 +267,7 @@ namespace MWWorld
         }
 
         int refsToLoad = 0;
+        std::vector<CellStore *> cellsToLoad;
         // get the number of refs to load
         for (int x=X-1; x<=X+1; ++x)
             for (int y=Y-1; y<=Y+1; ++y)
@@ -279,11 +286,16 @@ namespace MWWorld
                 }
 
                 if (iter==mActiveCells.end())
-                    refsToLoad += MWBase::Environment::get().getWorld()->getExterior(x, y)->count();
+                {
+                    cellsToLoad.push_back (MWBase::Environment::get().getWorld()->getExterior(x, y));
+                    refsToLoad += cellsToLoad.back()->count();
+                }
             }
 
         loadingListener->setProgressRange(refsToLoad);
 
+        preloadModels (cellsToLoad);
+
         // Load cells
         for (int x=X-1; x<=X+1; ++x)
             for (int y=Y-1; y<=Y+1; ++y)
@@ -309,6 +321,9 @@ namespace MWWorld
                 }
             }
 
+        if (mNifPreloader)
+            mNifPreloader->clear();
+
         // find current cell
         CellStoreCollection::iterator iter = mActiveCells.begin();
 
@@ -337,12 +352,57 @@ namespace MWWorld
 
         mCellChanged = true;
 
+        prefetchNeighbours (X, Y);
+
         loadingListener->removeWallpaper();
     }
 
+    void Scene::preloadModels (const std::vector<CellStore *>& cells)
+    {
+        if (!mNifPreloader)
+            return;
+
+        std::vector<std::string> models;
+
+        for (std::vector<CellStore *>::const_iterator iter (cells.begin()); iter!=cells.end(); ++iter)
+            (*iter)->listModels (models);
+
+        // the same names NifOgre::Loader asks the NIFFile cache for
+        for (std::vector<std::string>::iterator iter (models.begin()); iter!=models.end(); ++iter)
+            Misc::StringUtils::toLower (*iter);
+
+        mNifPreloader->preload (models);
+    }
+
+    void Scene::prefetchNeighbours (int X, int Y)
+    {
+        if (!mPrefetcher)
+            return;
+
+        std::vector<std::string> models;
+
+        for (int x=X-2; x<=X+2; ++x)
+            for (int y=Y-2; y<=Y+2; ++y)
+            {
+                // the 3x3 grid itself is already loaded
+                if (std::abs (x-X)<=1 && std::abs (y-Y)<=1)
+                    continue;
+
+                // only reads the references, loading the cells would block the main thread
+                MWBase::Environment::get().getWorld()->listExteriorModels (x, y, models);
+            }
+
+        std::sort (models.begin(), models.end());
+        models.erase (std::unique (models.begin(), models.end()), models.end());
+
+        mPrefetcher->prefetch (models);
+    }
+
     //We need the ogre renderer and a scene node.
-    Scene::Scene (MWRender::RenderingManager& rendering, PhysicsSystem *physics)
-    : mCurrentCell (0), mCellChanged (false), mPhysics(physics), mRendering(rendering)
+    Scene::Scene (MWRender::RenderingManager& rendering, PhysicsSystem *physics,
+        VFS::Prefetcher *prefetcher, Nif::Preloader *nifPreloader)
+    : mCurrentCell (0), mCellChanged (false), mPhysics(physics), mRendering(rendering),
+      mPrefetcher (prefetcher), mNifPreloader (nifPreloader)
     {
     }
 
@@ -423,8 +483,13 @@ namespace MWWorld
 
         //Loading Interior loading text
 
+        preloadModels (std::vector<CellStore *> (1, cell));
+
         loadCell (cell, loadingListener);
 
+        if (mNifPreloader)
+            mNifPreloader->clear();
+
         mCurrentCell = cell;
 
         // adjust fog
@@ -26,6 +26,16 @@ namespace Loading
     class Listener;
 }
 
+namespace VFS
+{
+    class Prefetcher;
+}
+
+namespace Nif
+{
+    class Preloader;
+}
+
 namespace Render
 {
     class OgreRenderer;
@@ -57,15 +67,28 @@ namespace MWWorld
             bool mCellChanged;
             PhysicsSystem *mPhysics;
             MWRender::RenderingManager& mRendering;
+            VFS::Prefetcher *mPrefetcher;
+            Nif::Preloader *mNifPreloader;
 
             void playerCellChange (CellStore *cell, const ESM::Position& position,
                 bool adjustPlayerPos = true);
 
             void insertCell (CellStore &cell, bool rescale, Loading::Listener* loadingListener);
 
+            void preloadModels (const std::vector<CellStore *>& cells);
+            ///< Start parsing the models of \a cells on the preloader's workers, so that
+            /// inserting their references mostly finds them parsed.
+
+            void prefetchNeighbours (int X, int Y);
+            ///< Queue the models of the exterior cells bordering the active 3x3 grid around
+            /// (X, Y) for prefetching, so the next exterior cell change finds them warm.
+
         public:
 
-            Scene (MWRender::RenderingManager& rendering, PhysicsSystem *physics);
+            Scene (MWRender::RenderingManager& rendering, PhysicsSystem *physics,
+                VFS::Prefetcher *prefetcher, Nif::Preloader *nifPreloader);
+            ///< \param prefetcher May be 0 to disable prefetching.
+            /// \param nifPreloader May be 0 to parse all models on the main thread.
 
             ~Scene();
 
@@ -3,12 +3,22 @@
 
 #include <string>
 #include <vector>
+#include <deque>
 #include <map>
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
+#include <components/esm/recordindex.hpp>
+#include <components/misc/idatoms.hpp>
 
 #include "recordcmp.hpp"
+#include "flatindex.hpp"
 
 namespace MWWorld
 {
@@ -23,6 +33,24 @@ namespace MWWorld
         virtual int getDynamicSize() const { return 0; }
         virtual void load(ESM::ESMReader &esm, const std::string &id) = 0;
 
+        /// A record read by parse(), waiting for merge()
+        struct Parsed
+        {
+            virtual ~Parsed() {}
+        };
+
+        virtual Parsed *parse(ESM::ESMReader &esm, const std::string &id) const { return 0; }
+        ///< Read a record without modifying the store. Must be safe to call from other threads.
+        /// \return 0 if records of this store have to be loaded in order through load().
+
+        virtual void merge(const Parsed &record) {}
+        ///< Add a record returned by parse(), with the same effect load() would have had.
+
+        virtual bool loadLazy(ESM::ESMReader &esm, size_t offset, const std::string &id) { return false; }
+        ///< Add the record at \a offset in \a esm without reading it, using the id from an
+        /// ESM::RecordIndex. The record is read when it is first looked up.
+        /// \return false if records of this store have to be loaded through load().
+
         virtual bool eraseStatic(const std::string &id) {return false;}
         virtual void clearDynamic() {}
 
@@ -30,8 +58,32 @@ namespace MWWorld
 
         virtual void read (ESM::ESMReader& reader) {}
         ///< Read into dynamic storage
+
+        virtual void writeStatic (ESM::ESMWriter& writer) const {}
+        ///< Write the records loaded from content files, so that loading them through load()
+        /// restores the store. Stores whose records refer back to their content files write
+        /// nothing.
     };
 
+    /// Flags of the record header the record was loaded from
+    template <class T>
+    inline uint32_t getRecordFlags (const T& record)
+    {
+        return 0;
+    }
+
+    template <>
+    inline uint32_t getRecordFlags (const ESM::NPC& record)
+    {
+        return record.mPersistent ? 0x0400 : 0;
+    }
+
+    template <>
+    inline uint32_t getRecordFlags (const ESM::Creature& record)
+    {
+        return record.mPersistent ? 0x0400 : 0;
+    }
+
     template <class T>
     class SharedIterator
     {
@@ -96,12 +148,30 @@ namespace MWWorld
     template <class T>
     class Store : public StoreBase
     {
-        std::map<std::string, T>      mStatic;
+        /// A record loaded from a content file
+        struct StaticRecord
+        {
+            const std::string *mKey; ///< lower case id, owned by Misc::IdAtoms
+            Misc::IdAtoms::Atom mAtom;
+            bool mErased; ///< no longer indexed, see eraseStatic()
+            T mRecord;
+        };
+
+        // Records are numbered by their position in mStatic, which only grows, so that pointers
+        // to them stay valid. mStaticKeys indexes the records by key, mStaticAtoms by atom.
+        std::deque<StaticRecord> mStatic;
+        FlatIndex mStaticKeys;
+        FlatIndex mStaticAtoms;
+
         std::vector<T *>    mShared;
         std::map<std::string, T> mDynamic;
 
         typedef std::map<std::string, T> Dynamic;
-        typedef std::map<std::string, T> Static;
+
+        /// Records by the atom of their id, see search(Misc::IdAtoms::Atom)
+        typedef std::map<Misc::IdAtoms::Atom, T *> AtomIndex;
+
+        AtomIndex mDynamicAtoms;
 
         class GetRecords {
             const std::string mFind;
@@ -119,39 +189,122 @@ namespace MWWorld
             }
         };
 
+        class MatchKey {
+            const std::deque<StaticRecord> &mRecords;
+            const std::string &mId;
 
-        friend class ESMStore;
+        public:
+            MatchKey(const std::deque<StaticRecord> &records, const std::string &id)
+              : mRecords(records), mId(id)
+            { }
 
-    public:
-        Store()
-        {}
+            bool operator()(unsigned int record) const {
+                return Misc::StringUtils::ciEqual(*mRecords[record].mKey, mId);
+            }
+        };
 
-        Store(const Store<T> &orig)
-          : mStatic(orig.mData)
-        {}
+        class MatchAtom {
+            const std::deque<StaticRecord> &mRecords;
+            Misc::IdAtoms::Atom mAtom;
+
+        public:
+            MatchAtom(const std::deque<StaticRecord> &records, Misc::IdAtoms::Atom atom)
+              : mRecords(records), mAtom(atom)
+            { }
+
+            bool operator()(unsigned int record) const {
+                return mRecords[record].mAtom == mAtom;
+            }
+        };
+
+        struct KeyOrdering {
+            bool operator()(const StaticRecord *x, const StaticRecord *y) const {
+                return *x->mKey < *y->mKey;
+            }
+        };
+
+        static unsigned int hashAtom(Misc::IdAtoms::Atom atom) {
+            return atom * 2654435761u;
+        }
+
+        T *searchStatic(const std::string &id) const {
+            unsigned int record =
+                mStaticKeys.find(Misc::StringUtils::ciHash(id), MatchKey(mStatic, id));
+
+            if (record == FlatIndex::sNone) {
+                return 0;
+            }
+            return const_cast<T *>(&mStatic[record].mRecord);
+        }
+
+        /// Record stored under \a key (lower case), added if there is none yet
+        T &getStatic(const std::string &key, bool *added = 0) {
+            unsigned int hash = Misc::StringUtils::ciHash(key);
+            unsigned int record = mStaticKeys.find(hash, MatchKey(mStatic, key));
+
+            if (added) {
+                *added = record == FlatIndex::sNone;
+            }
+
+            if (record == FlatIndex::sNone) {
+                record = mStatic.size();
+
+                mStatic.push_back(StaticRecord());
+                mStatic.back().mAtom = Misc::IdAtoms::intern(key);
+                mStatic.back().mKey = &Misc::IdAtoms::getId(mStatic.back().mAtom);
+                mStatic.back().mErased = false;
+
+                mStaticKeys.insert(hash, record);
+                mStaticAtoms.insert(hashAtom(mStatic.back().mAtom), record);
+            }
+
+            return mStatic[record].mRecord;
+        }
 
+        struct ParsedRecord : public Parsed
+        {
+            std::string mKey;
+            T mRecord;
+        };
+
+        friend class ESMStore;
+
+    public:
         typedef SharedIterator<T> iterator;
 
         // setUp needs to be called again after
         virtual void clearDynamic()
         {
             mDynamic.clear();
+            mDynamicAtoms.clear();
             mShared.clear();
         }
 
         const T *search(const std::string &id) const {
-            T item;
-            item.mId = Misc::StringUtils::lowerCase(id);
+            if (const T *ptr = searchStatic(id)) {
+                return ptr;
+            }
 
-            typename std::map<std::string, T>::const_iterator it = mStatic.find(item.mId);
+            if (!mDynamic.empty()) {
+                typename Dynamic::const_iterator dit = mDynamic.find(Misc::StringUtils::lowerCase(id));
+                if (dit != mDynamic.end()) {
+                    return &dit->second;
+                }
+            }
 
-            if (it != mStatic.end() && Misc::StringUtils::ciEqual(it->second.mId, id)) {
-                return &(it->second);
+            return 0;
+        }
+
+        /// Same as search(Misc::IdAtoms::getId(id)), without any string handling
+        const T *search(Misc::IdAtoms::Atom id) const {
+            unsigned int record = mStaticAtoms.find(hashAtom(id), MatchAtom(mStatic, id));
+            if (record != FlatIndex::sNone) {
+                return &mStatic[record].mRecord;
             }
 
-            typename Dynamic::const_iterator dit = mDynamic.find(item.mId);
-            if (dit != mDynamic.end()) {
-                return &dit->second;
+            typename AtomIndex::const_iterator it = mDynamicAtoms.find(id);
+            if (it != mDynamicAtoms.end()) {
+                return it->second;
             }
 
             return 0;
@@ -185,6 +338,16 @@ namespace MWWorld
             return ptr;
         }
 
+        const T *find(Misc::IdAtoms::Atom id) const {
+            const T *ptr = search(id);
+            if (ptr == 0) {
+                std::ostringstream msg;
+                msg << "Object '" << Misc::IdAtoms::getId(id) << "' not found (const)";
+                throw std::runtime_error(msg.str());
+            }
+            return ptr;
+        }
+
         /** Returns a random record that starts with the named ID. An exception is thrown if none
          * are found. */
         const T *findRandom(const std::string &id) const
@@ -201,19 +364,41 @@ namespace MWWorld
 
         void load(ESM::ESMReader &esm, const std::string &id) {
             std::string idLower = Misc::StringUtils::lowerCase(id);
-            mStatic[idLower] = T();
-            mStatic[idLower].mId = idLower;
-            mStatic[idLower].load(esm);
+            T &record = getStatic(idLower);
+            record = T();
+            record.mId = idLower;
+            record.load(esm);
+        }
+
+        Parsed *parse(ESM::ESMReader &esm, const std::string &id) const {
+            std::auto_ptr<ParsedRecord> parsed(new ParsedRecord);
+            parsed->mKey = Misc::StringUtils::lowerCase(id);
+            parsed->mRecord.mId = parsed->mKey;
+            parsed->mRecord.load(esm);
+            return parsed.release();
+        }
+
+        void merge(const Parsed &record) {
+            const ParsedRecord &parsed = static_cast<const ParsedRecord &>(record);
+            getStatic(parsed.mKey) = parsed.mRecord;
         }
 
         void setUp() {
-            //std::sort(mStatic.begin(), mStatic.end(), RecordCmp());
+            // Iterate in the order of the ids, like the map based store used to
+            std::vector<const StaticRecord *> records;
+            records.reserve(mStaticKeys.size());
+            typename std::deque<StaticRecord>::const_iterator it = mStatic.begin();
+            for (; it != mStatic.end(); ++it) {
+                if (!it->mErased) {
+                    records.push_back(&*it);
+                }
+            }
+            std::sort(records.begin(), records.end(), KeyOrdering());
 
             mShared.clear();
-            mShared.reserve(mStatic.size());
-            typename std::map<std::string, T>::iterator it = mStatic.begin();
-            for (; it != mStatic.end(); ++it) {
-                mShared.push_back(&(it->second));
+            mShared.reserve(records.size());
+            for (size_t i = 0; i < records.size(); ++i) {
+                mShared.push_back(const_cast<T *>(&records[i]->mRecord));
             }
         }
 
@@ -249,6 +434,7 @@ namespace MWWorld
             T *ptr = &result.first->second;
             if (result.second) {
                 mShared.push_back(ptr);
+                mDynamicAtoms[Misc::IdAtoms::intern(id)] = ptr;
             } else {
                 *ptr = item;
             }
@@ -256,38 +442,40 @@ namespace MWWorld
         }
 
         T *insertStatic(const T &item) {
-            std::string id = Misc::StringUtils::lowerCase(item.mId);
-            std::pair<typename Static::iterator, bool> result =
-                mStatic.insert(std::pair<std::string, T>(id, item));
-            T *ptr = &result.first->second;
-            if (result.second) {
+            bool added;
+            T *ptr = &getStatic(Misc::StringUtils::lowerCase(item.mId), &added);
+            *ptr = item;
+            if (added) {
                 mShared.push_back(ptr);
-            } else {
-                *ptr = item;
             }
             return ptr;
         }
 
 
         bool eraseStatic(const std::string &id) {
-            T item;
-            item.mId = Misc::StringUtils::lowerCase(id);
+            unsigned int record =
+                mStaticKeys.find(Misc::StringUtils::ciHash(id), MatchKey(mStatic, id));
 
-            typename std::map<std::string, T>::iterator it = mStatic.find(item.mId);
+            if (record != FlatIndex::sNone) {
+                StaticRecord &erased = mStatic[record];
 
-            if (it != mStatic.end() && Misc::StringUtils::ciEqual(it->second.mId, id)) {
                 // delete from the static part of mShared
                 typename std::vector<T *>::iterator sharedIter = mShared.begin();
-                typename std::vector<T *>::iterator end = sharedIter + mStatic.size();
+                typename std::vector<T *>::iterator end = sharedIter + mStaticKeys.size();
 
                 while (sharedIter != mShared.end() && sharedIter != end) {
-                    if((*sharedIter)->mId == item.mId) {
+                    if(*sharedIter == &erased.mRecord) {
                         mShared.erase(sharedIter);
                         break;
                     }
                     ++sharedIter;
                 }
-                mStatic.erase(it);
+
+                // The record itself stays, so that the numbers of the others don't change
+                mStaticKeys.erase(Misc::StringUtils::ciHash(id), MatchKey(mStatic, id));
+                mStaticAtoms.erase(hashAtom(erased.mAtom), MatchAtom(mStatic, erased.mAtom));
+                erased.mErased = true;
+                erased.mRecord = T();
             }
 
             return true;
@@ -300,9 +488,10 @@ namespace MWWorld
                 return false;
             }
             mDynamic.erase(it);
+            mDynamicAtoms.erase(Misc::IdAtoms::search(key));
 
             // have to reinit the whole shared part
-            mShared.erase(mShared.begin() + mStatic.size(), mShared.end());
+            mShared.erase(mShared.begin() + mStaticKeys.size(), mShared.end());
             for (it = mDynamic.begin(); it != mDynamic.end(); ++it) {
                 mShared.push_back(&it->second);
             }
@@ -332,6 +521,21 @@ namespace MWWorld
             record.load (reader);
             insert (record);
         }
+
+        void writeStatic (ESM::ESMWriter& writer) const
+        {
+            for (typename std::deque<StaticRecord>::const_iterator iter (mStatic.begin());
+                 iter!=mStatic.end(); ++iter)
+            {
+                if (iter->mErased)
+                    continue;
+
+                writer.startRecord (T::sRecordId, getRecordFlags (iter->mRecord));
+                writer.writeHNCString ("NAME", iter->mRecord.mId);
+                iter->mRecord.save (writer);
+                writer.endRecord (T::sRecordId);
+            }
+        }
     };
 
     template <>
@@ -343,7 +547,10 @@ namespace MWWorld
             if (iter->first=="player")
                 ++iter;
             else
+            {
+                mDynamicAtoms.erase (Misc::IdAtoms::search (iter->first));
                 mDynamic.erase (iter++);
+            }
 
         mShared.clear();
     }
@@ -352,14 +559,45 @@ namespace MWWorld
     inline void Store<ESM::Dialogue>::load(ESM::ESMReader &esm, const std::string &id) {
         std::string idLower = Misc::StringUtils::lowerCase(id);
 
-        std::map<std::string, ESM::Dialogue>::iterator it = mStatic.find(idLower);
-        if (it == mStatic.end()) {
-            it = mStatic.insert( std::make_pair( idLower, ESM::Dialogue() ) ).first;
-            it->second.mId = id; // don't smash case here, as this line is printed... I think
+        bool added;
+        ESM::Dialogue &dialogue = getStatic(idLower, &added);
+        if (added) {
+            dialogue.mId = id; // don't smash case here, as this line is printed... I think
         }
 
         //I am not sure is it need to load the dialog from a plugin if it was already loaded from prevois plugins
-        it->second.load(esm);
+        dialogue.load(esm);
+    }
+
+    template <>
+    inline void Store<ESM::Dialogue>::writeStatic (ESM::ESMWriter& writer) const
+    {
+        for (std::deque<StaticRecord>::const_iterator iter (mStatic.begin()); iter!=mStatic.end(); ++iter)
+        {
+            if (iter->mErased)
+                continue;
+
+            writer.startRecord (ESM::Dialogue::sRecordId);
+            writer.writeHNCString ("NAME", iter->mRecord.mId);
+            iter->mRecord.save (writer);
+            writer.endRecord (ESM::Dialogue::sRecordId);
+
+            // Infos attach to the dialogue before them
+            for (std::vector<ESM::DialInfo>::const_iterator info (iter->mRecord.mInfo.begin());
+                 info!=iter->mRecord.mInfo.end(); ++info)
+            {
+                writer.startRecord (ESM::DialInfo::sRecordId);
+                writer.writeHNCString ("INAM", info->mId);
+                info->save (writer);
+                writer.endRecord (ESM::DialInfo::sRecordId);
+            }
+        }
+    }
+
+    template <>
+    inline StoreBase::Parsed *Store<ESM::Dialogue>::parse(ESM::ESMReader &esm, const std::string &id) const {
+        // Loads into the existing record, and the following INFO records need it
+        return 0;
     }
 
     template <>
@@ -367,7 +605,31 @@ namespace MWWorld
         ESM::Script scpt;
         scpt.load(esm);
         Misc::StringUtils::toLower(scpt.mId);
-        mStatic[scpt.mId] = scpt;
+        getStatic(scpt.mId) = scpt;
+    }
+
+    template <>
+    inline void Store<ESM::Script>::writeStatic (ESM::ESMWriter& writer) const
+    {
+        // The id is part of the script header
+        for (std::deque<StaticRecord>::const_iterator iter (mStatic.begin()); iter!=mStatic.end(); ++iter)
+        {
+            if (iter->mErased)
+                continue;
+
+            writer.startRecord (ESM::Script::sRecordId);
+            iter->mRecord.save (writer);
+            writer.endRecord (ESM::Script::sRecordId);
+        }
+    }
+
+    template <>
+    inline StoreBase::Parsed *Store<ESM::Script>::parse(ESM::ESMReader &esm, const std::string &id) const {
+        std::auto_ptr<ParsedRecord> parsed(new ParsedRecord);
+        parsed->mRecord.load(esm);
+        Misc::StringUtils::toLower(parsed->mRecord.mId);
+        parsed->mKey = parsed->mRecord.mId;
+        return parsed.release();
     }
 
     template <>
@@ -375,7 +637,31 @@ namespace MWWorld
         ESM::StartScript s;
         s.load(esm);
         s.mId = Misc::StringUtils::toLower(s.mScript);
-        mStatic[s.mId] = s;
+        getStatic(s.mId) = s;
+    }
+
+    template <>
+    inline void Store<ESM::StartScript>::writeStatic (ESM::ESMWriter& writer) const
+    {
+        // The id is derived from the script name
+        for (std::deque<StaticRecord>::const_iterator iter (mStatic.begin()); iter!=mStatic.end(); ++iter)
+        {
+            if (iter->mErased)
+                continue;
+
+            writer.startRecord (ESM::StartScript::sRecordId);
+            iter->mRecord.save (writer);
+            writer.endRecord (ESM::StartScript::sRecordId);
+        }
+    }
+
+    template <>
+    inline StoreBase::Parsed *Store<ESM::StartScript>::parse(ESM::ESMReader &esm, const std::string &id) const {
+        std::auto_ptr<ParsedRecord> parsed(new ParsedRecord);
+        parsed->mRecord.load(esm);
+        parsed->mRecord.mId = Misc::StringUtils::toLower(parsed->mRecord.mScript);
+        parsed->mKey = parsed->mRecord.mId;
+        return parsed.release();
     }
 
     template <>
@@ -457,30 +743,104 @@ namespace MWWorld
         }
     };
 
+    /// \brief Readers of its own for a store that reads records on their first access
+    ///
+    /// The readers of the World are moved around by whoever loads cells, so lazy loads can not
+    /// share them. One reader per content file, opened when it is first needed. Not thread safe.
+    class LazyReaders
+    {
+        struct File
+        {
+            std::string mName;
+            int mIndex;
+            ToUTF8::Utf8Encoder *mEncoder;
+            boost::shared_ptr<ESM::ESMReader> mReader;
+        };
+
+        std::vector<File> mFiles;
+
+    public:
+        /// \return Handle of the content file \a esm has open, for seek()
+        /// \param strings Convert strings with the encoder of \a esm. The encoder is not thread
+        /// safe, so only pass true if the records are read in the thread that loads the content.
+        size_t add(ESM::ESMReader &esm, bool strings) {
+            for (size_t i = mFiles.size(); i > 0; --i) {
+                if (mFiles[i-1].mName == esm.getName()) {
+                    return i-1;
+                }
+            }
+
+            File file;
+            file.mName = esm.getName();
+            file.mIndex = esm.getIndex();
+            file.mEncoder = strings ? esm.getEncoder() : 0;
+            mFiles.push_back(file);
+            return mFiles.size()-1;
+        }
+
+        /// \return Reader of \a file, at the start of the data of the record at \a offset
+        ESM::ESMReader &seek(size_t file, size_t offset) {
+            File &entry = mFiles.at(file);
+
+            if (!entry.mReader) {
+                boost::shared_ptr<ESM::ESMReader> reader(new ESM::ESMReader);
+                reader->setEncoder(entry.mEncoder);
+                reader->setIndex(entry.mIndex);
+                reader->open(entry.mName);
+                entry.mReader = reader;
+            }
+
+            entry.mReader->seekRecord(offset);
+            entry.mReader->getRecName();
+            entry.mReader->getRecHeader();
+            return *entry.mReader;
+        }
+    };
+
     template <>
     class Store<ESM::Land> : public StoreBase
     {
-        std::vector<ESM::Land *> mStatic;
+        /// Land records are only read from their content file when they are first looked up
+        struct Entry
+        {
+            int mX, mY;
+            size_t mFile; ///< in mReaders
+            size_t mOffset;
+            ESM::Land *mLand;
+        };
+
+        mutable std::vector<Entry> mStatic;
+        mutable LazyReaders mReaders;
+        mutable boost::mutex mMutex; ///< for mReaders and the lazily loaded mLand
 
         struct Compare
         {
-            bool operator()(const ESM::Land *x, const ESM::Land *y) {
-                if (x->mX == y->mX) {
-                    return x->mY < y->mY;
+            bool operator()(const Entry &x, const Entry &y) const {
+                if (x.mX == y.mX) {
+                    return x.mY < y.mY;
                 }
-                return x->mX < y->mX;
+                return x.mX < y.mX;
             }
         };
 
-    public:
-        typedef SharedIterator<ESM::Land> iterator;
+        void add(ESM::ESMReader &esm, int x, int y, size_t offset) {
+            Entry entry;
+            entry.mX = x;
+            entry.mY = y;
+            // no strings in land records, they are read from the terrain threads
+            entry.mFile = mReaders.add(esm, false);
+            entry.mOffset = offset;
+            entry.mLand = 0;
+            mStatic.push_back(entry);
+        }
 
+    public:
         virtual ~Store<ESM::Land>()
         {
-            for (std::vector<ESM::Land *>::const_iterator it =
+            for (std::vector<Entry>::const_iterator it =
                              mStatic.begin(); it != mStatic.end(); ++it)
             {
-                delete *it;
+                delete it->mLand;
             }
 
         }
@@ -489,27 +849,30 @@ namespace MWWorld
             return mStatic.size();
         }
 
-        iterator begin() const {
-            return iterator(mStatic.begin());
-        }
-
-        iterator end() const {
-            return iterator(mStatic.end());
-        }
-
         // Must be threadsafe! Called from terrain background loading threads.
-        // Not a big deal here, since ESM::Land can never be modified or inserted/erased
+        // ESM::Land can never be modified or inserted/erased, only loaded on first access.
         ESM::Land *search(int x, int y) const {
-            ESM::Land land;
-            land.mX = x, land.mY = y;
+            Entry entry;
+            entry.mX = x, entry.mY = y;
+
+            std::vector<Entry>::iterator it =
+                std::lower_bound(mStatic.begin(), mStatic.end(), entry, Compare());
 
-            std::vector<ESM::Land *>::const_iterator it =
-                std::lower_bound(mStatic.begin(), mStatic.end(), &land, Compare());
+            if (it == mStatic.end() || it->mX != x || it->mY != y) {
+                return 0;
+            }
 
-            if (it != mStatic.end() && (*it)->mX == x && (*it)->mY == y) {
-                return const_cast<ESM::Land *>(*it);
+            boost::mutex::scoped_lock lock(mMutex);
+
+            if (!it->mLand) {
+                std::auto_ptr<ESM::Land> land(new ESM::Land());
+                land->load(mReaders.seek(it->mFile, it->mOffset));
+                // The land keeps using the reader for loadData, so everything is loaded while
+                // the reader is locked
+                land->loadData(land->mDataTypes);
+                it->mLand = land.release();
             }
-            return 0;
+            return it->mLand;
         }
 
         ESM::Land *find(int x, int y) const{
@@ -523,26 +886,41 @@ namespace MWWorld
         }
 
         void load(ESM::ESMReader &esm, const std::string &id) {
-            ESM::Land *ptr = new ESM::Land();
-            ptr->load(esm);
+            // Only the grid location is read here
+            int x, y;
+            esm.getSubNameIs("INTV");
+            esm.getSubHeaderIs(8);
+            esm.getT<int>(x);
+            esm.getT<int>(y);
+            esm.skipRecord();
 
-            // Same area defined in multiple plugins? -> last plugin wins
-            // Can't use search() because we aren't sorted yet - is there any other way to speed this up?
-            for (std::vector<ESM::Land*>::iterator it = mStatic.begin(); it != mStatic.end(); ++it)
-            {
-                if ((*it)->mX == ptr->mX && (*it)->mY == ptr->mY)
-                {
-                    delete *it;
-                    mStatic.erase(it);
-                    break;
-                }
-            }
+            add(esm, x, y, esm.getRecordOffset());
+        }
 
-            mStatic.push_back(ptr);
+        bool loadLazy(ESM::ESMReader &esm, size_t offset, const std::string &id) {
+            int x, y;
+            if (!ESM::RecordIndex::getGrid(id, x, y)) {
+                return false;
+            }
+            add(esm, x, y, offset);
+            return true;
         }
 
         void setUp() {
-            std::sort(mStatic.begin(), mStatic.end(), Compare());
+            // Same area defined in multiple plugins? -> last plugin wins
+            std::stable_sort(mStatic.begin(), mStatic.end(), Compare());
+
+            std::vector<Entry>::iterator out = mStatic.begin();
+            for (std::vector<Entry>::iterator it = mStatic.begin(); it != mStatic.end(); ++it)
+            {
+                if (out != mStatic.begin() && (out - 1)->mX == it->mX && (out - 1)->mY == it->mY) {
+                    delete (out - 1)->mLand;
+                    *(out - 1) = *it;
+                } else {
+                    *out++ = *it;
+                }
+            }
+            mStatic.erase(out, mStatic.end());
         }
     };
 
@@ -846,42 +1224,92 @@ namespace MWWorld
     template <>
     class Store<ESM::Pathgrid> : public StoreBase
     {
-    public:
-        typedef std::vector<ESM::Pathgrid>::const_iterator iterator;
+        /// Path grids are only read from their content file when they are first looked up. Until
+        /// then mPathgrid only holds the cell name and grid location.
+        struct Entry
+        {
+            ESM::Pathgrid mPathgrid;
+            size_t mFile; ///< in mReaders
+            size_t mOffset;
+            bool mLoaded;
+        };
+
+        mutable std::vector<Entry>  mStatic;
+        mutable LazyReaders mReaders;
+        mutable boost::mutex mMutex; ///< for mReaders and the lazily loaded mPathgrid
 
-    private:
-        std::vector<ESM::Pathgrid>  mStatic;
+        std::vector<Entry>::iterator mIntBegin, mIntEnd, mExtBegin, mExtEnd;
 
-        std::vector<ESM::Pathgrid>::iterator mIntBegin, mIntEnd, mExtBegin, mExtEnd;
+        static bool isInterior(const Entry &x) {
+            return x.mPathgrid.mData.mX == 0 && x.mPathgrid.mData.mY == 0;
+        }
 
         struct IntExtOrdering
         {
-            bool operator()(const ESM::Pathgrid &x, const ESM::Pathgrid &y) const {
+            bool operator()(const Entry &x, const Entry &y) const {
                 // interior pathgrids precedes exterior ones (x < y)
-                if ((x.mData.mX == 0 && x.mData.mY == 0) &&
-                    (y.mData.mX != 0 || y.mData.mY != 0))
-                {
-                    return true;
-                }
-                return false;
+                return isInterior(x) && !isInterior(y);
+            }
+        };
+
+        struct IntCompare
+        {
+            bool operator()(const Entry &x, const Entry &y) const {
+                return RecordCmp()(x.mPathgrid, y.mPathgrid);
             }
         };
 
         struct ExtCompare
         {
-            bool operator()(const ESM::Pathgrid &x, const ESM::Pathgrid &y) const {
-                if (x.mData.mX == y.mData.mX) {
-                    return x.mData.mY < y.mData.mY;
+            bool operator()(const Entry &x, const Entry &y) const {
+                if (x.mPathgrid.mData.mX == y.mPathgrid.mData.mX) {
+                    return x.mPathgrid.mData.mY < y.mPathgrid.mData.mY;
                 }
-                return x.mData.mX < y.mData.mX;
+                return x.mPathgrid.mData.mX < y.mPathgrid.mData.mX;
             }
         };
 
+        void add(ESM::ESMReader &esm, const ESM::Pathgrid &pathgrid, size_t offset) {
+            mStatic.push_back(Entry());
+            mStatic.back().mPathgrid = pathgrid;
+            // cell names are converted, path grids are only looked up from the main thread
+            mStatic.back().mFile = mReaders.add(esm, true);
+            mStatic.back().mOffset = offset;
+            mStatic.back().mLoaded = false;
+        }
+
+        const ESM::Pathgrid *get(std::vector<Entry>::iterator it) const {
+            boost::mutex::scoped_lock lock(mMutex);
+
+            if (!it->mLoaded) {
+                ESM::Pathgrid pathgrid;
+                pathgrid.load(mReaders.seek(it->mFile, it->mOffset));
+                it->mPathgrid = pathgrid;
+                it->mLoaded = true;
+            }
+            return &it->mPathgrid;
+        }
+
     public:
 
         void load(ESM::ESMReader &esm, const std::string &id) {
-            mStatic.push_back(ESM::Pathgrid());
-            mStatic.back().load(esm);
+            // Only the cell name and grid location are read here
+            ESM::Pathgrid pathgrid;
+            esm.getHNT(pathgrid.mData, "DATA", 12);
+            pathgrid.mCell = esm.getHNString("NAME");
+            esm.skipRecord();
+
+            add(esm, pathgrid, esm.getRecordOffset());
+        }
+
+        bool loadLazy(ESM::ESMReader &esm, size_t offset, const std::string &id) {
+            ESM::Pathgrid pathgrid;
+            pathgrid.mData.mX = pathgrid.mData.mY = 0;
+            if (!ESM::RecordIndex::getGrid(id, pathgrid.mData.mX, pathgrid.mData.mY)) {
+                pathgrid.mCell = id;
+            }
+            add(esm, pathgrid, offset);
+            return true;
         }
 
         size_t getSize() const {
@@ -892,8 +1320,8 @@ namespace MWWorld
             IntExtOrdering cmp;
             std::sort(mStatic.begin(), mStatic.end(), cmp);
 
-            ESM::Pathgrid pg;
-            pg.mData.mX = pg.mData.mY = 1;
+            Entry pg;
+            pg.mPathgrid.mData.mX = pg.mPathgrid.mData.mY = 1;
             mExtBegin =
                 std::lower_bound(mStatic.begin(), mStatic.end(), pg, cmp);
             mExtEnd = mStatic.end();
@@ -901,19 +1329,19 @@ namespace MWWorld
             mIntBegin = mStatic.begin();
             mIntEnd = mExtBegin;
 
-            std::sort(mIntBegin, mIntEnd, RecordCmp());
+            std::sort(mIntBegin, mIntEnd, IntCompare());
             std::sort(mExtBegin, mExtEnd, ExtCompare());
         }
 
         const ESM::Pathgrid *search(int x, int y) const {
-            ESM::Pathgrid pg;
-            pg.mData.mX = x;
-            pg.mData.mY = y;
+            Entry pg;
+            pg.mPathgrid.mData.mX = x;
+            pg.mPathgrid.mData.mY = y;
 
-            iterator it =
+            std::vector<Entry>::iterator it =
                 std::lower_bound(mExtBegin, mExtEnd, pg, ExtCompare());
-            if (it != mExtEnd && it->mData.mX == x && it->mData.mY == y) {
-                return &(*it);
+            if (it != mExtEnd && it->mPathgrid.mData.mX == x && it->mPathgrid.mData.mY == y) {
+                return get(it);
             }
             return 0;
         }
@@ -929,12 +1357,12 @@ namespace MWWorld
         }
 
         const ESM::Pathgrid *search(const std::string &name) const {
-            ESM::Pathgrid pg;
-            pg.mCell = name;
+            Entry pg;
+            pg.mPathgrid.mCell = name;
 
-            iterator it = std::lower_bound(mIntBegin, mIntEnd, pg, RecordCmp());
-            if (it != mIntEnd && Misc::StringUtils::ciEqual(it->mCell, name)) {
-                return &(*it);
+            std::vector<Entry>::iterator it = std::lower_bound(mIntBegin, mIntEnd, pg, IntCompare());
+            if (it != mIntEnd && Misc::StringUtils::ciEqual(it->mPathgrid.mCell, name)) {
+                return get(it);
             }
             return 0;
         }
@@ -962,30 +1390,6 @@ namespace MWWorld
             }
             return find(cell.mData.mX, cell.mData.mY);
         }
-
-        iterator begin() const {
-            return mStatic.begin();
-        }
-
-        iterator end() const {
-            return mStatic.end();
-        }
-
-        iterator interiorPathsBegin() const {
-            return mIntBegin;
-        }
-
-        iterator interiorPathsEnd() const {
-            return mIntEnd;
-        }
-
-        iterator exteriorPathsBegin() const {
-            return mExtBegin;
-        }
-
-        iterator exteriorPathsEnd() const {
-            return mExtEnd;
-        }
     };
 
     template <class T>
@@ -1023,6 +1427,14 @@ namespace MWWorld
             mStatic.back().load(esm);
         }
 
+        void writeStatic(ESM::ESMWriter &writer) const {
+            for (iterator it = mStatic.begin(); it != mStatic.end(); ++it) {
+                writer.startRecord(T::sRecordId);
+                it->save(writer);
+                writer.endRecord(T::sRecordId);
+            }
+        }
+
         int getSize() const {
             return mStatic.size();
         }
@@ -0,0 +1,254 @@
+#include <components/esm/loadstat.hpp>
+#include <components/misc/stringops.hpp>
+#include <components/misc/idatoms.hpp>
+
+#include "../store.hpp"
+
+/*
+  Benchmark of the record stores
+
+  Fills a store with generated static records and looks them up by id,
+  three ways, each in its own process:
+
+    map:    the std::map based storage MWWorld::Store used before, kept
+            here for comparison
+    flat:   MWWorld::Store, looked up by id
+    atom:   MWWorld::Store, looked up by id atoms resolved beforehand
+
+  A quarter of the lookups are for ids that do not exist, and the ids are
+  looked up in mixed case. Reports the time per lookup and the resident
+  memory taken by the store.
+
+  Usage: store_bench [records] (defaults to 50000)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdlib>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+
+const int lookupRounds = 20;
+
+long residentKiB()
+{
+  ifstream status("/proc/self/status");
+  string line;
+  while(getline(status, line))
+    if(line.compare(0, 6, "VmRSS:") == 0)
+      return atol(line.c_str() + 6);
+  return 0;
+}
+
+string makeId(int i)
+{
+  static const char *prefixes[] = { "Furn_Com_", "flora_", "ex_vivec_", "In_Hlaalu_", "T_Imp_Set" };
+  ostringstream id;
+  id << prefixes[i % 5] << "Record_" << i;
+  return id.str();
+}
+
+ESM::Static makeRecord(int i)
+{
+  ESM::Static record;
+  record.mId = makeId(i);
+  record.mModel = "meshes\\" + record.mId + ".nif";
+  return record;
+}
+
+/// Ids to look up: existing ids in a different case, and missing ids
+vector<string> makeQueries(int records)
+{
+  vector<string> queries;
+  srand(1);
+  for(int i=0; i<records; i++)
+    {
+      int n = rand() % records;
+      string id = makeId(rand() % 4 ? n : n + records);
+      for(size_t c=0; c<id.size(); c+=3)
+        id[c] = toupper(id[c]);
+      queries.push_back(id);
+    }
+  return queries;
+}
+
+/// The storage MWWorld::Store used before, reduced to what a lookup needs
+struct MapStore
+{
+  map<string, ESM::Static> mStatic;
+  vector<ESM::Static *> mShared;
+
+  void insertStatic(const ESM::Static &item)
+  {
+    mStatic[Misc::StringUtils::lowerCase(item.mId)] = item;
+  }
+
+  void setUp()
+  {
+    mShared.clear();
+    for(map<string, ESM::Static>::iterator it = mStatic.begin(); it != mStatic.end(); ++it)
+      mShared.push_back(&it->second);
+  }
+
+  const ESM::Static *search(const string &id) const
+  {
+    map<string, ESM::Static>::const_iterator it = mStatic.find(Misc::StringUtils::lowerCase(id));
+    if(it != mStatic.end() && Misc::StringUtils::ciEqual(it->second.mId, id))
+      return &it->second;
+    return 0;
+  }
+};
+
+double elapsed(const boost::posix_time::ptime &start)
+{
+  return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000000.0;
+}
+
+void report(const char *name, size_t found, size_t lookups, double secs, long kib)
+{
+  cout << setw(4) << name << ": " << found << " of " << lookups << " found, "
+       << fixed << setprecision(1) << secs * 1e9 / lookups << " ns per lookup, resident memory +"
+       << kib << " KiB" << endl;
+}
+
+void benchMap(int records, const vector<string> &queries)
+{
+  long before = residentKiB();
+
+  MapStore *store = new MapStore;
+  for(int i=0; i<records; i++)
+    store->insertStatic(makeRecord(i));
+  store->setUp();
+
+  long kib = residentKiB() - before;
+
+  size_t found = 0;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for(int round=0; round<lookupRounds; round++)
+    for(size_t i=0; i<queries.size(); i++)
+      found += store->search(queries[i]) != 0;
+
+  report("map", found, queries.size() * lookupRounds, elapsed(start), kib);
+}
+
+void benchFlat(int records, const vector<string> &queries, bool atoms)
+{
+  long before = residentKiB();
+
+  MWWorld::Store<ESM::Static> *store = new MWWorld::Store<ESM::Static>;
+  for(int i=0; i<records; i++)
+    store->insertStatic(makeRecord(i));
+  store->setUp();
+
+  long kib = residentKiB() - before;
+
+  vector<Misc::IdAtoms::Atom> ids;
+  for(size_t i=0; i<queries.size(); i++)
+    ids.push_back(Misc::IdAtoms::search(queries[i]));
+
+  size_t found = 0;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for(int round=0; round<lookupRounds; round++)
+    for(size_t i=0; i<queries.size(); i++)
+      found += (atoms ? store->search(ids[i]) : store->search(queries[i])) != 0;
+
+  report(atoms ? "atom" : "flat", found, queries.size() * lookupRounds, elapsed(start), kib);
+}
+
+/// Check that the store finds what the map finds, also after erasing records
+bool verify(int records, const vector<string> &queries)
+{
+  MapStore map;
+  MWWorld::Store<ESM::Static> store;
+
+  for(int i=0; i<records; i++)
+    {
+      map.insertStatic(makeRecord(i));
+      store.insertStatic(makeRecord(i));
+    }
+
+  for(int i=0; i<records; i+=7)
+    {
+      map.mStatic.erase(Misc::StringUtils::lowerCase(makeId(i)));
+      store.eraseStatic(makeId(i));
+    }
+
+  map.setUp();
+  store.setUp();
+
+  if(map.mShared.size() != store.getSize())
+    return false;
+
+  MWWorld::Store<ESM::Static>::iterator it = store.begin();
+  for(size_t i=0; i<map.mShared.size(); ++i, ++it)
+    if(map.mShared[i]->mId != it->mId)
+      return false;
+
+  for(size_t i=0; i<queries.size(); i++)
+    {
+      const ESM::Static *expected = map.search(queries[i]);
+      const ESM::Static *record = store.search(queries[i]);
+      const ESM::Static *atomRecord = store.search(Misc::IdAtoms::search(queries[i]));
+
+      if((expected == 0) != (record == 0) || record != atomRecord)
+        return false;
+      if(record && record->mModel != expected->mModel)
+        return false;
+    }
+
+  return true;
+}
+
+void run(void (*bench)(int, const vector<string>&), int records, const vector<string> &queries)
+{
+  cout.flush();
+
+  pid_t child = fork();
+  if(child != 0)
+    {
+      waitpid(child, NULL, 0);
+      return;
+    }
+
+  bench(records, queries);
+  _exit(0);
+}
+
+void benchFlatById(int records, const vector<string> &queries)
+{
+  benchFlat(records, queries, false);
+}
+
+void benchFlatByAtom(int records, const vector<string> &queries)
+{
+  benchFlat(records, queries, true);
+}
+
+int main(int argc, char **argv)
+{
+  int records = argc > 1 ? atoi(argv[1]) : 50000;
+  vector<string> queries = makeQueries(records);
+
+  cout << records << " records" << endl;
+
+  run(benchMap, records, queries);
+  run(benchFlatById, records, queries);
+  run(benchFlatByAtom, records, queries);
+
+  if(!verify(records, queries))
+    {
+      cout << "MWWorld::Store and the map disagree" << endl;
+      return 1;
+    }
+}
@@ -7,6 +7,8 @@
 #include <tr1/unordered_map>
 #endif
 
+#include <memory>
+
 #include <OgreSceneNode.h>
 
 #include <libs/openengine/bullet/physic.hpp>
@@ -15,6 +17,7 @@
 #include <components/files/collections.hpp>
 #include <components/compiler/locals.hpp>
 #include <components/esm/cellid.hpp>
+#include <components/misc/idatoms.hpp>
 
 #include <boost/math/special_functions/sign.hpp>
 
@@ -44,6 +47,8 @@
 
 #include "contentloader.hpp"
 #include "esmloader.hpp"
+#include "esmparser.hpp"
+#include "contentcache.hpp"
 #include "omwloader.hpp"
 
 using namespace Ogre;
@@ -62,6 +67,15 @@ namespace MWWorld
             return mLoaders.insert(std::make_pair(extension, loader)).second;
         }
 
+        void prepare(const boost::filesystem::path& filepath, int index)
+        {
+            LoadersContainer::iterator it(mLoaders.find(Misc::StringUtils::lowerCase(filepath.extension().string())));
+            if (it != mLoaders.end())
+            {
+                it->second->prepare(filepath, index);
+            }
+        }
+
         void load(const boost::filesystem::path& filepath, int& index)
         {
             LoadersContainer::iterator it(mLoaders.find(Misc::StringUtils::lowerCase(filepath.extension().string())));
@@ -122,7 +136,9 @@ namespace MWWorld
         const std::vector<std::string>& contentFiles,
         const boost::filesystem::path& resDir, const boost::filesystem::path& cacheDir,
         ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
-        int activationDistanceOverride, const std::string& startCell)
+        int activationDistanceOverride, const std::string& startCell,
+        VFS::Prefetcher *prefetcher, Nif::Preloader *nifPreloader, int loaderThreads,
+        ContentCache *contentCache)
     : mPlayer (0), mLocalScripts (mStore),
       mSky (true), mCells (mStore, mEsm),
       mActivationDistanceOverride (activationDistanceOverride),
@@ -145,8 +161,12 @@ namespace MWWorld
         Loading::Listener* listener = MWBase::Environment::get().getWindowManager()->getLoadingScreen();
         listener->loadingOn();
 
+        std::auto_ptr<ESMParser> parser;
+        if (loaderThreads>0)
+            parser.reset (new ESMParser (mStore, encoder, loaderThreads));
+
         GameContentLoader gameContentLoader(*listener);
-        EsmLoader esmLoader(mStore, mEsm, encoder, *listener);
+        EsmLoader esmLoader(mStore, mEsm, encoder, *listener, parser.get());
         OmwLoader omwLoader(*listener);
 
         gameContentLoader.addLoader(".esm", &esmLoader);
@@ -154,7 +174,9 @@ namespace MWWorld
         gameContentLoader.addLoader(".omwgame", &omwLoader);
         gameContentLoader.addLoader(".omwaddon", &omwLoader);
 
-        loadContentFiles(fileCollections, contentFiles, gameContentLoader);
+        loadContentFiles(fileCollections, contentFiles, gameContentLoader, contentCache);
+
+        parser.reset();
 
         listener->loadingOff();
 
@@ -165,9 +187,12 @@ namespace MWWorld
         mStore.setUp();
         mStore.movePlayerRecord();
 
+        // All ids of the content files are known now; later lookups do not need to lock
+        Misc::IdAtoms::freeze();
+
         mGlobalVariables.fill (mStore);
 
-        mWorldScene = new Scene(*mRendering, mPhysics);
+        mWorldScene = new Scene(*mRendering, mPhysics, prefetcher, nifPreloader);
     }
 
     void World::startNewGame (bool bypass)
@@ -372,6 +397,11 @@ namespace MWWorld
         return mCells.getExterior (x, y);
     }
 
+    void World::listExteriorModels (int x, int y, std::vector<std::string>& models)
+    {
+        mCells.listExteriorModels (x, y, models);
+    }
+
     CellStore *World::getInterior (const std::string& name)
     {
         return mCells.getInterior (name);
@@ -2059,19 +2089,49 @@ namespace MWWorld
     }
 
     void World::loadContentFiles(const Files::Collections& fileCollections,
-        const std::vector<std::string>& content, ContentLoader& contentLoader)
+        const std::vector<std::string>& content, ContentLoader& contentLoader, ContentCache* cache)
     {
-        std::vector<std::string>::const_iterator it(content.begin());
-        std::vector<std::string>::const_iterator end(content.end());
-        for (int idx = 0; it != end; ++it, ++idx)
+        std::vector<boost::filesystem::path> paths(content.size());
+
+        for (size_t idx = 0; idx < content.size(); ++idx)
         {
-            boost::filesystem::path filename(*it);
+            boost::filesystem::path filename(content[idx]);
             const Files::MultiDirCollection& col = fileCollections.getCollection(filename.extension().string());
-            if (col.doesExist(*it))
+            if (col.doesExist(content[idx]))
             {
-                contentLoader.load(col.getPath(*it), idx);
+                paths[idx] = col.getPath(content[idx]);
             }
         }
+
+        bool cached = false;
+        if (cache)
+        {
+            cache->setContentFiles(paths);
+            cached = cache->read(mStore);
+        }
+
+        // Let the loaders start on all files, then load them in order. With the cache, only the
+        // indexed records are left to load, which is not worth parsing ahead.
+        for (size_t idx = 0; idx < paths.size() && !cached; ++idx)
+        {
+            if (!paths[idx].empty())
+            {
+                contentLoader.prepare(paths[idx], idx);
+            }
+        }
+
+        for (int idx = 0; idx < static_cast<int>(paths.size()); ++idx)
+        {
+            if (!paths[idx].empty())
+            {
+                contentLoader.load(paths[idx], idx);
+            }
+        }
+
+        if (cache && !cached)
+        {
+            cache->write(mStore);
+        }
     }
 
     bool World::startSpellCast(const Ptr &actor)
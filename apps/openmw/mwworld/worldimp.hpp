@@ -32,6 +32,16 @@ namespace Files
     class Collections;
 }
 
+namespace VFS
+{
+    class Prefetcher;
+}
+
+namespace Nif
+{
+    class Preloader;
+}
+
 namespace Render
 {
     class OgreRenderer;
@@ -51,6 +61,7 @@ namespace MWWorld
 {
     class WeatherManager;
     class Player;
+    class ContentCache;
 
     /// \brief The game world and its visual representation
 
@@ -161,9 +172,11 @@ namespace MWWorld
              * @param fileCollections- Container which holds content file names and their paths
              * @param content - Container which holds content file names
              * @param contentLoader -
+             * @param cache - Snapshot to restore records from, or to update; may be 0
              */
             void loadContentFiles(const Files::Collections& fileCollections,
-                const std::vector<std::string>& content, ContentLoader& contentLoader);
+                const std::vector<std::string>& content, ContentLoader& contentLoader,
+                ContentCache* cache);
 
             int mPlayIntro;
 
@@ -183,7 +196,14 @@ namespace MWWorld
                 const std::vector<std::string>& contentFiles,
                 const boost::filesystem::path& resDir, const boost::filesystem::path& cacheDir,
                 ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
-                int activationDistanceOverride, const std::string& startCell);
+                int activationDistanceOverride, const std::string& startCell,
+                VFS::Prefetcher *prefetcher, Nif::Preloader *nifPreloader, int loaderThreads,
+                ContentCache *contentCache);
+            ///< \param prefetcher Warms the resources of nearby cells, may be 0.
+            /// \param nifPreloader Parses the models of cells being loaded in parallel, may be 0.
+            /// \param loaderThreads Worker threads parsing content files, 0 to parse them while
+            /// loading.
+            /// \param contentCache Restores the records of unchanged content files, may be 0.
 
             virtual ~World();
 
@@ -204,6 +224,10 @@ namespace MWWorld
 
             virtual CellStore *getExterior (int x, int y);
 
+            virtual void listExteriorModels (int x, int y, std::vector<std::string>& models);
+            ///< Append the models of the references in an exterior cell to \a models, without
+            /// loading the cell.
+
             virtual CellStore *getInterior (const std::string& name);
 
             virtual CellStore *getCell (const ESM::CellId& id);
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "components/misc/idatoms.hpp"
+
+struct IdAtomsTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(IdAtomsTest, intern_ignores_case)
+{
+  Misc::IdAtoms::Atom atom = Misc::IdAtoms::intern("IdAtomsTest_Iron_Dagger");
+
+  ASSERT_NE(Misc::IdAtoms::sNone, atom);
+  ASSERT_EQ(atom, Misc::IdAtoms::intern("idatomstest_iron_dagger"));
+  ASSERT_EQ(atom, Misc::IdAtoms::intern("IDATOMSTEST_IRON_DAGGER"));
+  ASSERT_NE(atom, Misc::IdAtoms::intern("idatomstest_iron_dagger2"));
+}
+
+TEST_F(IdAtomsTest, get_id_is_lower_case)
+{
+  Misc::IdAtoms::Atom atom = Misc::IdAtoms::intern("IdAtomsTest_Fargoth");
+
+  ASSERT_EQ("idatomstest_fargoth", Misc::IdAtoms::getId(atom));
+}
+
+TEST_F(IdAtomsTest, search_does_not_intern)
+{
+  size_t size = Misc::IdAtoms::getSize();
+
+  ASSERT_EQ(Misc::IdAtoms::sNone, Misc::IdAtoms::search("IdAtomsTest_Unknown"));
+  ASSERT_EQ(size, Misc::IdAtoms::getSize());
+
+  Misc::IdAtoms::Atom atom = Misc::IdAtoms::intern("IdAtomsTest_Unknown");
+  ASSERT_EQ(atom, Misc::IdAtoms::search("IDATOMSTEST_UNKNOWN"));
+  ASSERT_EQ(size + 1, Misc::IdAtoms::getSize());
+}
+
+TEST_F(IdAtomsTest, atoms_are_stable)
+{
+  // Enough ids to grow the table several times
+  std::vector<Misc::IdAtoms::Atom> atoms;
+  for (int i = 0; i < 5000; ++i)
+  {
+    std::ostringstream id;
+    id << "IdAtomsTest_Record" << i;
+    atoms.push_back(Misc::IdAtoms::intern(id.str()));
+  }
+
+  const std::string &first = Misc::IdAtoms::getId(atoms.front());
+
+  for (int i = 0; i < 5000; ++i)
+  {
+    std::ostringstream id;
+    id << "idatomstest_record" << i;
+    ASSERT_EQ(atoms[i], Misc::IdAtoms::search(id.str()));
+    ASSERT_EQ(id.str(), Misc::IdAtoms::getId(atoms[i]));
+  }
+
+  ASSERT_EQ("idatomstest_record0", first);
+}
+
+TEST_F(IdAtomsTest, ids_interned_after_freeze_are_found)
+{
+  // Freezing is once per process; the other tests keep working afterwards
+  Misc::IdAtoms::Atom before = Misc::IdAtoms::intern("IdAtomsTest_Frozen");
+  Misc::IdAtoms::freeze();
+  Misc::IdAtoms::Atom after = Misc::IdAtoms::intern("IdAtomsTest_Thawed");
+
+  ASSERT_EQ(before, Misc::IdAtoms::intern("IDATOMSTEST_FROZEN"));
+  ASSERT_EQ(before, Misc::IdAtoms::search("idatomstest_frozen"));
+  ASSERT_EQ(after, Misc::IdAtoms::search("IdAtomsTest_THAWED"));
+  ASSERT_EQ("idatomstest_frozen", Misc::IdAtoms::getId(before));
+  ASSERT_EQ("idatomstest_thawed", Misc::IdAtoms::getId(after));
+  ASSERT_EQ(Misc::IdAtoms::sNone, Misc::IdAtoms::search("IdAtomsTest_Neither"));
+}
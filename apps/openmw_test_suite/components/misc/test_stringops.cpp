@@ -77,3 +77,17 @@ TEST_F(StringOpsTest, iends_not_matching)
   ASSERT_FALSE(Misc::iends("abc", "abcd"));
 }
 
+
+TEST_F(StringOpsTest, ci_hash_ignores_case)
+{
+  ASSERT_EQ(Misc::StringUtils::ciHash("iron dagger"), Misc::StringUtils::ciHash("Iron Dagger"));
+  ASSERT_EQ(Misc::StringUtils::ciHash(""), Misc::StringUtils::ciHash(""));
+  ASSERT_NE(Misc::StringUtils::ciHash("iron dagger"), Misc::StringUtils::ciHash("iron daggers"));
+}
+
+TEST_F(StringOpsTest, ci_equal)
+{
+  ASSERT_TRUE(Misc::StringUtils::ciEqual("Fargoth", "fARGOTH"));
+  ASSERT_FALSE(Misc::StringUtils::ciEqual("Fargoth", "Fargot"));
+  ASSERT_FALSE(Misc::StringUtils::ciEqual("Fargoth[", "Fargoth{"));
+}
@@ -0,0 +1,40 @@
+# Locate LZ4
+# This module defines
+# LZ4_LIBRARY
+# LZ4_FOUND, if false, do not try to link to LZ4 
+# LZ4_INCLUDE_DIR, where to find the headers
+#
+# Created for OpenMW (http://openmw.com), after FindMPG123.cmake
+
+FIND_PATH(LZ4_INCLUDE_DIR lz4.h
+  HINTS
+  PATHS
+  ~/Library/Frameworks
+  /Library/Frameworks
+  /usr/local
+  /usr
+  /sw # Fink
+  /opt/local # DarwinPorts
+  /opt/csw # Blastwave
+  /opt
+)
+
+FIND_LIBRARY(LZ4_LIBRARY 
+  NAMES lz4 liblz4
+  HINTS
+  PATH_SUFFIXES lib64 lib libs64 libs libs/Win32 libs/Win64
+  PATHS
+  ~/Library/Frameworks
+  /Library/Frameworks
+  /usr/local
+  /usr
+  /sw
+  /opt/local
+  /opt/csw
+  /opt
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(LZ4 DEFAULT_MSG LZ4_LIBRARY LZ4_INCLUDE_DIR)
+
+MARK_AS_ADVANCED(LZ4_INCLUDE_DIR LZ4_LIBRARY)
@@ -23,6 +23,9 @@
 
 #include "bsa_archive.hpp"
 
+#include <map>
+#include <cstring>
+
 #include <boost/filesystem.hpp>
 
 #include <OgreFileSystem.h>
@@ -37,6 +40,7 @@
 using namespace Ogre;
 
 static bool fsstrict = false;
+static bool bsamapped = false;
 
 static char strict_normalize_char(char ch)
 {
@@ -58,6 +62,52 @@ static std::string normalize_path(T1 begin, T2 end)
     return normalized;
 }
 
+/// Normalize a pattern for matching against BSA entries. Without fsstrict it is lowercased the
+/// way the archive's normalizedName is.
+static std::string normalize_pattern(const std::string &pattern)
+{
+    if(fsstrict)
+        return normalize_path(pattern.begin(), pattern.end());
+
+    std::string normalized(pattern);
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(), &Bsa::BSAFile::normalizeChar);
+    return normalized;
+}
+
+/// Same as Ogre::StringUtil::match, without needing a std::string for str. With \a strict,
+/// backslashes in str match slashes in the pattern, so raw archive names can be compared in place.
+static bool wildcard_match(const char *str, const char *pattern, bool strict)
+{
+    const char *star = NULL;
+    const char *resume = NULL;
+
+    while(*str)
+    {
+        if(*pattern == '*')
+        {
+            star = pattern++;
+            resume = str;
+        }
+        else if(*pattern == (strict ? strict_normalize_char(*str) : *str))
+        {
+            ++pattern;
+            ++str;
+        }
+        else if(star)
+        {
+            pattern = star + 1;
+            str = ++resume;
+        }
+        else
+            return false;
+    }
+
+    while(*pattern == '*')
+        ++pattern;
+
+    return *pattern == 0;
+}
+
 /// An OGRE Archive wrapping a BSAFile archive
 class DirArchive: public Ogre::Archive
 {
@@ -131,7 +181,7 @@ public:
     StringVectorPtr find(const String& pattern, bool recursive = true,
                         bool dirs = false)
     {
-        std::string normalizedPattern = normalize_path(pattern.begin(), pattern.end());
+        std::string normalizedPattern = normalize_pattern(pattern);
         StringVectorPtr ptr = StringVectorPtr(new StringVector());
         for(index::const_iterator iter = mIndex.begin();iter != mIndex.end();++iter)
         {
@@ -152,7 +202,7 @@ public:
     FileInfoListPtr findFileInfo(const String& pattern, bool recursive = true,
                             bool dirs = false) const
     {
-        std::string normalizedPattern = normalize_path(pattern.begin(), pattern.end());
+        std::string normalizedPattern = normalize_pattern(pattern);
         FileInfoListPtr ptr = FileInfoListPtr(new FileInfoList());
 
         index::const_iterator i = mIndex.find(normalizedPattern);
@@ -208,7 +258,7 @@ class BSAArchive : public Archive
 public:
   BSAArchive(const String& name)
              : Archive(name, "BSA")
-  { arc.open(name); }
+  { arc.open(name, bsamapped); }
 
   bool isCaseSensitive() const { return false; }
 
@@ -249,14 +299,13 @@ public:
     StringVectorPtr find(const String& pattern, bool recursive = true,
                          bool dirs = false)
     {
-        std::string normalizedPattern = normalize_path(pattern.begin(), pattern.end());
+        std::string normalizedPattern = normalize_pattern(pattern);
+        std::string recursivePattern = "*/" + normalizedPattern;
         const Bsa::BSAFile::FileList &filelist = arc.getList();
         StringVectorPtr ptr = StringVectorPtr(new StringVector());
         for(Bsa::BSAFile::FileList::const_iterator iter = filelist.begin();iter != filelist.end();++iter)
         {
-            std::string ent = normalize_path(iter->name, iter->name+std::strlen(iter->name));
-            if(Ogre::StringUtil::match(ent, normalizedPattern) ||
-               (recursive && Ogre::StringUtil::match(ent, "*/"+normalizedPattern)))
+            if(matches(*iter, normalizedPattern, recursive ? &recursivePattern : NULL))
                 ptr->push_back(iter->name);
         }
         return ptr;
@@ -265,32 +314,56 @@ public:
     FileInfoListPtr findFileInfo(const String& pattern, bool recursive = true,
                                 bool dirs = false) const
     {
-        std::string normalizedPattern = normalize_path(pattern.begin(), pattern.end());
         FileInfoListPtr ptr = FileInfoListPtr(new FileInfoList());
         const Bsa::BSAFile::FileList &filelist = arc.getList();
 
-        for(Bsa::BSAFile::FileList::const_iterator iter = filelist.begin();iter != filelist.end();++iter)
+        // A plain file name only matches itself unless the search is recursive, which also
+        // matches it in any directory. The archive's hash lookup ignores case, so it can only
+        // answer when fsstrict is off.
+        if(!recursive && !fsstrict && pattern.find('*') == String::npos)
         {
-            std::string ent = normalize_path(iter->name, iter->name+std::strlen(iter->name));
-            if(Ogre::StringUtil::match(ent, normalizedPattern) ||
-                (recursive && Ogre::StringUtil::match(ent, "*/"+normalizedPattern)))
-            {
-                std::string::size_type pt = ent.rfind('/');
-                if(pt == std::string::npos)
-                    pt = 0;
+            int index = arc.getIndex(pattern.c_str());
+            if(index != -1)
+                ptr->push_back(makeFileInfo(filelist[index]));
+            return ptr;
+        }
 
-                FileInfo fi;
-                fi.archive = const_cast<BSAArchive*>(this);
-                fi.path = std::string(iter->name, pt);
-                fi.filename = std::string(iter->name + ((ent[pt]=='/') ? pt+1 : pt));
-                fi.compressedSize = fi.uncompressedSize = iter->fileSize;
+        std::string normalizedPattern = normalize_pattern(pattern);
+        std::string recursivePattern = "*/" + normalizedPattern;
 
-                ptr->push_back(fi);
-            }
+        for(Bsa::BSAFile::FileList::const_iterator iter = filelist.begin();iter != filelist.end();++iter)
+        {
+            if(matches(*iter, normalizedPattern, recursive ? &recursivePattern : NULL))
+                ptr->push_back(makeFileInfo(*iter));
         }
 
         return ptr;
     }
+
+private:
+    /// Match the name of \a entry against patterns from normalize_pattern
+    static bool matches(const Bsa::BSAFile::FileStruct &entry, const std::string &pattern,
+                        const std::string *recursivePattern)
+    {
+        // normalizedName is lowercase, so with fsstrict the raw name is compared, keeping its case
+        const char *name = fsstrict ? entry.name : entry.normalizedName;
+
+        return wildcard_match(name, pattern.c_str(), fsstrict) ||
+            (recursivePattern && wildcard_match(name, recursivePattern->c_str(), fsstrict));
+    }
+
+    FileInfo makeFileInfo(const Bsa::BSAFile::FileStruct &entry) const
+    {
+        const char *sep = std::strrchr(entry.normalizedName, '/');
+        size_t pt = sep ? sep - entry.normalizedName : 0;
+
+        FileInfo fi;
+        fi.archive = const_cast<BSAArchive*>(this);
+        fi.path = std::string(entry.name, pt);
+        fi.filename = std::string(entry.name + (sep ? pt+1 : pt));
+        fi.compressedSize = fi.uncompressedSize = entry.fileSize;
+        return fi;
+    }
 };
 
 // An archive factory for BSA archives
@@ -366,8 +439,9 @@ namespace Bsa
 
 // The function below is the only publicly exposed part of this file
 
-void addBSA(const std::string& name, const std::string& group)
+void addBSA(const std::string& name, const std::string& group, bool memoryMapped)
 {
+  bsamapped = memoryMapped;
   insertBSAFactory();
   ResourceGroupManager::getSingleton().
     addResourceLocation(name, "BSA", group, true);
@@ -31,8 +31,9 @@ namespace Bsa
 {
 
 /// Add the given BSA file as an input archive in the Ogre resource
-/// system.
-void addBSA(const std::string& file, const std::string& group="General");
+/// system. If \a memoryMapped is set, the archive is mapped into memory
+/// once instead of opening the file again for every resource.
+void addBSA(const std::string& file, const std::string& group="General", bool memoryMapped=false);
 void addDir(const std::string& file, const bool& fs, const std::string& group="General");
 
 }
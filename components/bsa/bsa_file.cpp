@@ -24,8 +24,13 @@
 #include "bsa_file.hpp"
 
 #include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
 
 #include "../files/constrainedfiledatastream.hpp"
+#include "../files/mappedfiledatastream.hpp"
+#include "../files/lowlevelfile.hpp"
 
 using namespace std;
 using namespace Bsa;
@@ -61,7 +66,8 @@ void BSAFile::readHeader()
      *
      * ---------- end of directory block -------------
      *
-     * - 8*filenum - hash table block, we currently ignore this
+     * - 8*filenum - hash table block, we rebuild this from the names
+     *   (see getHash) so archives with stale tables still work
      *
      * ----------- start of data buffer --------------
      *
@@ -126,6 +132,11 @@ void BSAFile::readHeader()
     // (skipped)
     size_t fileDataOffset = 12 + dirsize + 8*filenum;
 
+    // Normalize all names once, so lookups and pattern matches don't
+    // have to do it for every entry
+    normalizedBuf.resize(stringBuf.size());
+    std::transform(stringBuf.begin(), stringBuf.end(), normalizedBuf.begin(), &normalizeChar);
+
     // Set up the the FileStruct table
     files.resize(filenum);
     for(size_t i=0;i<filenum;i++)
@@ -133,35 +144,155 @@ void BSAFile::readHeader()
         FileStruct &fs = files[i];
         fs.fileSize = offsets[i*2];
         fs.offset = offsets[i*2+1] + fileDataOffset;
-        fs.name = &stringBuf[offsets[2*filenum+i]];
+
+        size_t nameOffset = offsets[2*filenum+i];
+        if(nameOffset >= stringBuf.size())
+            fail("Archive contains names outside the string table");
+
+        fs.name = &stringBuf[nameOffset];
+        fs.normalizedName = &normalizedBuf[nameOffset];
+        fs.hash = getHash(fs.name);
 
         if(fs.offset + fs.fileSize > fsize)
             fail("Archive contains offsets outside itself");
-
-        // Add the file name to the lookup
-        lookup[fs.name] = i;
     }
 
+    buildLookup();
+
     isLoaded = true;
 }
 
+/// Characters are hashed in the form the archives store them: lower case
+/// with '\\' as separator
+static uint32_t hashChar(char ch)
+{
+    ch = BSAFile::normalizeChar(ch);
+    return static_cast<unsigned char>(ch == '/' ? '\\' : ch);
+}
+
+/// Starting slot in the lookup table. The Morrowind hash mostly varies in
+/// the low bits of each byte, so mix it up before masking.
+static size_t hashSlot(const BSAFile::Hash &hash, size_t mask)
+{
+    uint32_t h = hash.low ^ hash.high;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    return h & mask;
+}
+
+BSAFile::Hash BSAFile::getHash(const char *name)
+{
+    // The first half of the name is XORed into the low word, the second
+    // half into the high word with an extra rotation per character.
+    size_t len = strlen(name);
+    size_t half = len >> 1;
+    uint32_t sum = 0, off = 0;
+    size_t i = 0;
+
+    Hash hash;
+
+    for(; i < half; i++)
+    {
+        sum ^= hashChar(name[i]) << (off & 0x1F);
+        off += 8;
+    }
+    hash.low = sum;
+
+    for(sum = off = 0; i < len; i++)
+    {
+        uint32_t temp = hashChar(name[i]) << (off & 0x1F);
+        sum ^= temp;
+        uint32_t n = temp & 0x1F;
+        if(n != 0)
+            sum = (sum << (32 - n)) | (sum >> n);  // rotate right
+        off += 8;
+    }
+    hash.high = sum;
+
+    return hash;
+}
+
+void BSAFile::buildLookup()
+{
+    // Keep the table at most half full so probe sequences stay short
+    size_t size = 1;
+    while(size < files.size() * 2)
+        size <<= 1;
+
+    lookup.assign(size, -1);
+    size_t mask = size - 1;
+
+    for(size_t i=0;i<files.size();i++)
+    {
+        size_t slot = hashSlot(files[i].hash, mask);
+        while(lookup[slot] != -1)
+        {
+            // Archives with duplicate names resolve to the last entry,
+            // like the old std::map based lookup did
+            if(strcmp(files[lookup[slot]].normalizedName, files[i].normalizedName) == 0)
+                break;
+            slot = (slot + 1) & mask;
+        }
+        lookup[slot] = i;
+    }
+}
+
 /// Get the index of a given file name, or -1 if not found
 int BSAFile::getIndex(const char *str) const
 {
-    Lookup::const_iterator it = lookup.find(str);
-    if(it == lookup.end())
+    if(lookup.empty())
         return -1;
 
-    int res = it->second;
-    assert(res >= 0 && (size_t)res < files.size());
-    return res;
+    Hash hash = getHash(str);
+    size_t mask = lookup.size() - 1;
+
+    for(size_t slot = hashSlot(hash, mask); lookup[slot] != -1; slot = (slot + 1) & mask)
+    {
+        int res = lookup[slot];
+        assert(res >= 0 && (size_t)res < files.size());
+
+        const FileStruct &fs = files[res];
+        if(fs.hash.low != hash.low || fs.hash.high != hash.high)
+            continue;
+
+        // Compare the normalized names without building a copy of str
+        const char *a = fs.normalizedName;
+        const char *b = str;
+        while(*a && *a == normalizeChar(*b))
+        {
+            ++a;
+            ++b;
+        }
+        if(*a == 0 && *b == 0)
+            return res;
+    }
+
+    return -1;
 }
 
 /// Open an archive file.
-void BSAFile::open(const string &file)
+void BSAFile::open(const string &file, bool memoryMapped)
 {
     filename = file;
     readHeader();
+
+    if(memoryMapped)
+    {
+        mapping.reset(new MemoryMappedFile);
+
+        try
+        {
+            mapping->open(filename.c_str());
+        }
+        catch(const std::exception &e)
+        {
+            // e.g. out of address space on 32 bit systems; the archive is still readable
+            std::cerr << "Failed to map " << filename << " into memory, reading it instead: "
+                      << e.what() << std::endl;
+            mapping.reset();
+        }
+    }
 }
 
 Ogre::DataStreamPtr BSAFile::getFile(const char *file)
@@ -172,5 +303,20 @@ Ogre::DataStreamPtr BSAFile::getFile(const char *file)
         fail("File not found: " + string(file));
 
     const FileStruct &fs = files[i];
-	return openConstrainedFileDataStream (filename.c_str (), fs.offset, fs.fileSize);
+    return getFile(fs.offset, fs.fileSize);
+}
+
+Ogre::DataStreamPtr BSAFile::getFile(uint32_t offset, uint32_t fileSize)
+{
+    if(mapping)
+        return openMappedFileDataStream (mapping, offset, fileSize);
+    return openConstrainedFileDataStream (filename.c_str (), offset, fileSize);
+}
+
+void BSAFile::prefetch(uint32_t offset, uint32_t fileSize)
+{
+    if(mapping)
+        mapping->prefetch(offset, fileSize);
+    else
+        openSharedLowLevelFile(filename.c_str())->prefetch(offset, fileSize);
 }
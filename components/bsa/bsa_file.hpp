@@ -28,10 +28,11 @@
 #include <libs/platform/strings.h>
 #include <string>
 #include <vector>
-#include <map>
 
 #include <OgreDataStream.h>
 
+#include "../files/memorymappedfile.hpp"
+
 
 namespace Bsa
 {
@@ -42,6 +43,12 @@ namespace Bsa
 class BSAFile
 {
 public:
+    /// File name hash, as stored in the archive's hash table
+    struct Hash
+    {
+        uint32_t low, high;
+    };
+
     /// Represents one file entry in the archive
     struct FileStruct
     {
@@ -52,6 +59,13 @@ public:
 
         // Zero-terminated file name
         const char *name;
+
+        // The same name in lower case with '/' as separator. Computed once
+        // when the archive is opened, for lookups and pattern matching.
+        const char *normalizedName;
+
+        // Hash of the file name, see getHash()
+        Hash hash;
     };
     typedef std::vector<FileStruct> FileList;
 
@@ -62,24 +76,23 @@ private:
     /// Filename string buffer
     std::vector<char> stringBuf;
 
+    /// Normalized filenames, laid out like stringBuf
+    std::vector<char> normalizedBuf;
+
     /// True when an archive has been loaded
     bool isLoaded;
 
     /// Used for error messages
     std::string filename;
 
-    /// Case insensitive string comparison
-    struct iltstr
-    {
-        bool operator()(const char *s1, const char *s2) const
-        { return strcasecmp(s1,s2) < 0; }
-    };
+    /// Mapping of the whole archive, null unless opened memory mapped
+    MemoryMappedFilePtr mapping;
 
-    /** A map used for fast file name lookup. The value is the index into
-        the files[] vector above. The iltstr ensures that file name
-        checks are case insensitive.
+    /** Open addressing hash table used for fast file name lookup, keyed
+        by the file name hash. The values are indices into the files[]
+        vector above, -1 marks an empty slot. The size is a power of two.
     */
-    typedef std::map<const char*, int, iltstr> Lookup;
+    typedef std::vector<int> Lookup;
     Lookup lookup;
 
     /// Error handling
@@ -88,8 +101,8 @@ private:
     /// Read header information from the input source
     void readHeader();
 
-    /// Get the index of a given file name, or -1 if not found
-    int getIndex(const char *str) const;
+    /// Build the lookup table from files[]
+    void buildLookup();
 
 public:
     /* -----------------------------------
@@ -101,14 +114,26 @@ public:
       : isLoaded(false)
     { }
 
-    /// Open an archive file.
-    void open(const std::string &file);
+    /** Open an archive file.
+
+        When \a memoryMapped is set the whole archive is mapped into the
+        address space once, and the streams returned by getFile() read
+        straight from the mapping instead of opening the file again.
+    */
+    void open(const std::string &file, bool memoryMapped = false);
+
+    /// Check if the archive was opened memory mapped
+    bool isMemoryMapped() const
+    { return mapping.get() != NULL; }
 
     /* -----------------------------------
      * Archive file routines
      * -----------------------------------
      */
 
+    /// Get the index of a given file name in getList(), or -1 if not found
+    int getIndex(const char *str) const;
+
     /// Check if a file exists
     bool exists(const char *file) const
     { return getIndex(file) != -1; }
@@ -118,9 +143,25 @@ public:
     */
     Ogre::DataStreamPtr getFile(const char *file);
 
+    /// Open the data of an entry, as given by the offset and fileSize
+    /// of its FileStruct
+    Ogre::DataStreamPtr getFile(uint32_t offset, uint32_t fileSize);
+
+    /// Hint that the given range of the archive will be read soon
+    void prefetch(uint32_t offset, uint32_t fileSize);
+
     /// Get a list of all files
     const FileList &getList() const
     { return files; }
+
+    /** Compute the hash Morrowind uses for \a name. The name is treated
+        case insensitively, and '/' is the same as '\\'.
+    */
+    static Hash getHash(const char *name);
+
+    /// Normalize a file name character the way normalizedName is
+    static char normalizeChar(char ch)
+    { return ch == '\\' ? '/' : (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch; }
 };
 
 }
@@ -0,0 +1,205 @@
+#include "bsa_writer.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+
+#include "bsa_file.hpp"
+#include "../files/lowlevelfile.hpp"
+
+using namespace Bsa;
+
+namespace
+{
+    void writeUInt(std::ostream &stream, uint32_t value)
+    {
+        char bytes[4] = {
+            static_cast<char>(value & 0xff), static_cast<char>((value >> 8) & 0xff),
+            static_cast<char>((value >> 16) & 0xff), static_cast<char>((value >> 24) & 0xff)
+        };
+        stream.write(bytes, 4);
+    }
+
+    std::string normalize(const std::string &name)
+    {
+        std::string result(name);
+        std::transform(result.begin(), result.end(), result.begin(), &BSAFile::normalizeChar);
+        return result;
+    }
+
+    /// Orders entries the way the archive's hash table is sorted
+    struct HashLess
+    {
+        const std::vector<BSAFile::Hash> &hashes;
+
+        HashLess(const std::vector<BSAFile::Hash> &hashes_) : hashes(hashes_) {}
+
+        bool operator()(size_t left, size_t right) const
+        {
+            if(hashes[left].low != hashes[right].low)
+                return hashes[left].low < hashes[right].low;
+            return hashes[left].high < hashes[right].high;
+        }
+    };
+
+    /// Orders entries by their position in the requested order, or after
+    /// all of those by their current position
+    struct RankLess
+    {
+        const std::vector<size_t> &ranks;
+
+        RankLess(const std::vector<size_t> &ranks_) : ranks(ranks_) {}
+
+        bool operator()(size_t left, size_t right) const
+        { return ranks[left] < ranks[right]; }
+    };
+}
+
+void BSAWriter::fail(const std::string &msg)
+{
+    throw std::runtime_error("BSA Error: " + msg);
+}
+
+void BSAWriter::addFile(const std::string &name, const std::string &source,
+    uint32_t offset, uint32_t size)
+{
+    Entry entry;
+    entry.name = name;
+    std::replace(entry.name.begin(), entry.name.end(), '/', '\\');
+    entry.source = source;
+    entry.offset = offset;
+    entry.size = size;
+
+    if(size == 0xFFFFFFFF)
+    {
+        size_t fileSize = openSharedLowLevelFile(source.c_str())->size();
+        if(fileSize < offset || fileSize - offset >= 0xFFFFFFFF)
+            fail("File too large for a BSA archive: " + source);
+        entry.size = fileSize - offset;
+    }
+
+    std::pair<std::map<std::string, size_t>::iterator, bool> result =
+        index.insert(std::make_pair(normalize(entry.name), entries.size()));
+
+    if(result.second)
+        entries.push_back(entry);
+    else
+        entries[result.first->second] = entry;
+}
+
+void BSAWriter::setOrder(const std::vector<std::string> &order)
+{
+    std::vector<size_t> ranks(entries.size());
+    for(size_t i=0;i<entries.size();i++)
+        ranks[i] = order.size() + i;
+
+    for(size_t i=order.size(); i>0; i--)
+    {
+        // Walk backwards, so the first mention of a name wins
+        std::map<std::string, size_t>::const_iterator iter = index.find(order[i-1]);
+        if(iter != index.end())
+            ranks[iter->second] = i-1;
+    }
+
+    std::vector<size_t> permutation(entries.size());
+    for(size_t i=0;i<permutation.size();i++)
+        permutation[i] = i;
+
+    std::sort(permutation.begin(), permutation.end(), RankLess(ranks));
+
+    EntryList sorted;
+    sorted.reserve(entries.size());
+    for(size_t i=0;i<permutation.size();i++)
+    {
+        sorted.push_back(entries[permutation[i]]);
+        index[normalize(sorted.back().name)] = i;
+    }
+
+    entries.swap(sorted);
+}
+
+void BSAWriter::write(const std::string &path)
+{
+    // See BSAFile::readHeader for the layout
+    size_t count = entries.size();
+
+    std::vector<BSAFile::Hash> hashes(count);
+    std::vector<uint32_t> dataOffsets(count);
+    uint64_t dataSize = 0;
+
+    for(size_t i=0;i<count;i++)
+    {
+        hashes[i] = BSAFile::getHash(entries[i].name.c_str());
+        dataOffsets[i] = dataSize;
+        dataSize += entries[i].size;
+    }
+
+    std::vector<size_t> hashOrder(count);
+    for(size_t i=0;i<count;i++)
+        hashOrder[i] = i;
+    std::sort(hashOrder.begin(), hashOrder.end(), HashLess(hashes));
+
+    std::vector<uint32_t> nameOffsets(count);
+    uint32_t namesSize = 0;
+    for(size_t i=0;i<count;i++)
+    {
+        nameOffsets[i] = namesSize;
+        namesSize += entries[hashOrder[i]].name.size() + 1;
+    }
+
+    uint64_t dirSize = 12*count + namesSize;
+    if(12 + dirSize + 8*count + dataSize > 0xFFFFFFFF)
+        fail("Archive would be larger than 4 GB: " + path);
+
+    std::ofstream stream(path.c_str(), std::ios::binary);
+    if(!stream)
+        fail("Can't write archive: " + path);
+
+    writeUInt(stream, 0x100);
+    writeUInt(stream, dirSize);
+    writeUInt(stream, count);
+
+    for(size_t i=0;i<count;i++)
+    {
+        writeUInt(stream, entries[hashOrder[i]].size);
+        writeUInt(stream, dataOffsets[hashOrder[i]]);
+    }
+
+    for(size_t i=0;i<count;i++)
+        writeUInt(stream, nameOffsets[i]);
+
+    for(size_t i=0;i<count;i++)
+    {
+        const std::string &name = entries[hashOrder[i]].name;
+        stream.write(name.c_str(), name.size()+1);
+    }
+
+    for(size_t i=0;i<count;i++)
+    {
+        writeUInt(stream, hashes[hashOrder[i]].low);
+        writeUInt(stream, hashes[hashOrder[i]].high);
+    }
+
+    std::vector<char> buffer(64*1024);
+
+    for(size_t i=0;i<count;i++)
+    {
+        const Entry &entry = entries[i];
+        LowLevelFilePtr file = openSharedLowLevelFile(entry.source.c_str());
+
+        for(uint32_t done = 0; done < entry.size; )
+        {
+            size_t chunk = std::min<size_t>(buffer.size(), entry.size - done);
+
+            if(file->readAt(&buffer[0], chunk, entry.offset + done) != chunk)
+                fail("Unexpected end of file: " + entry.source);
+
+            stream.write(&buffer[0], chunk);
+            done += chunk;
+        }
+    }
+
+    stream.close();
+    if(!stream)
+        fail("Error writing archive: " + path);
+}
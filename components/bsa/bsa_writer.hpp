@@ -0,0 +1,67 @@
+#ifndef BSA_BSA_WRITER_H
+#define BSA_BSA_WRITER_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Bsa
+{
+
+/**
+   Writes Morrowind format BSA archives.
+
+   The directory and hash table are written sorted by hash, as the game
+   expects. File data is written in the order the files were added, so the
+   caller controls the layout on disk.
+ */
+class BSAWriter
+{
+public:
+    /// One file of the new archive, and where to copy its data from
+    struct Entry
+    {
+        std::string name;     ///< name as stored in the archive, with '\\' separators
+        std::string source;   ///< file on disk holding the data
+        uint32_t offset;      ///< start of the data in source
+        uint32_t size;        ///< size of the data
+    };
+    typedef std::vector<Entry> EntryList;
+
+private:
+    EntryList entries;
+
+    /// Normalized name -> index into entries
+    std::map<std::string, size_t> index;
+
+    void fail(const std::string &msg);
+
+public:
+    /** Add a file. \a name may use '/' or '\\' as separator. Adding a name
+        that is already present (ignoring case) replaces the data of the
+        earlier entry, but keeps its position.
+
+        \param size 0xFFFFFFFF for everything from \a offset to the end of
+        \a source
+    */
+    void addFile(const std::string &name, const std::string &source,
+        uint32_t offset = 0, uint32_t size = 0xFFFFFFFF);
+
+    /// Entries in data order
+    const EntryList &getEntries() const
+    { return entries; }
+
+    /** Reorder the file data. Files named in \a order (normalized, see
+        BSAFile::normalizeChar) come first, in that order; the rest keep
+        their current relative order after them.
+    */
+    void setOrder(const std::vector<std::string> &order);
+
+    /// Write the archive. Throws an exception on failure.
+    void write(const std::string &path);
+};
+
+}
+
+#endif
@@ -0,0 +1,351 @@
+#ifdef OPENMW_USE_LZ4
+
+#include "compressed_file.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <boost/shared_ptr.hpp>
+
+#include <lz4.h>
+#include <lz4hc.h>
+
+#include "../files/constrainedfiledatastream.hpp"
+#include "../files/lowlevelfile.hpp"
+
+using namespace Bsa;
+
+/*
+  The layout of a compressed archive is as follows:
+
+  - 16 bytes header, contains 4 ints:
+         signature - "OMWA"
+         version - equal to 1
+         numfiles - number of files
+         namesize - size of the name buffer
+
+  - 32 bytes*numfiles, sorted by hash, each record contains:
+         hash low and high word (see BSAFile::getHash)
+         offset of the name in the name buffer
+         codec (see CompressedFile::Codec)
+         uncompressed size
+         stored size
+         offset of the data from the start of the archive (64 bit)
+
+  - name buffer, each string is null-terminated
+
+  - The rest of the archive is file data. All integers are little endian.
+ */
+
+namespace
+{
+    const char signature[4] = { 'O', 'M', 'W', 'A' };
+    const uint32_t version = 1;
+    const size_t headerSize = 16;
+    const size_t recordSize = 32;
+
+    uint32_t readUInt(const char *data)
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    }
+
+    void writeUInt(char *data, uint32_t value)
+    {
+        for(int i=0;i<4;i++)
+            data[i] = static_cast<char>((value >> (8*i)) & 0xff);
+    }
+
+    bool hashLess(const CompressedFile::FileStruct &left, const BSAFile::Hash &right)
+    {
+        return left.hash.low != right.low ? left.hash.low < right.low : left.hash.high < right.high;
+    }
+
+    /// Orders record indices by hash
+    struct RecordLess
+    {
+        const std::vector<CompressedFile::FileStruct> &records;
+
+        RecordLess(const std::vector<CompressedFile::FileStruct> &records_) : records(records_) {}
+
+        bool operator()(size_t left, size_t right) const
+        { return hashLess(records[left], records[right].hash); }
+    };
+
+    /// Stream over a decompressed file, keeping the buffer alive while it is open
+    class BufferDataStream : public Ogre::MemoryDataStream
+    {
+            boost::shared_ptr<std::vector<char> > mBuffer;
+
+        public:
+
+            BufferDataStream (const std::string& name, const boost::shared_ptr<std::vector<char> >& buffer)
+            : Ogre::MemoryDataStream (name, buffer->empty() ? 0 : &(*buffer)[0], buffer->size(),
+                false, true),
+              mBuffer (buffer)
+            {}
+    };
+}
+
+void CompressedFile::fail(const std::string &msg) const
+{
+    throw std::runtime_error("Compressed archive error: " + msg + "\nArchive: " + filename);
+}
+
+bool CompressedFile::isCompressedFile(const std::string &file)
+{
+    std::ifstream input(file.c_str(), std::ios_base::binary);
+
+    char head[sizeof(signature)];
+    return input.read(head, sizeof(head)) && std::equal(head, head+sizeof(head), signature);
+}
+
+void CompressedFile::open(const std::string &file)
+{
+    filename = file;
+
+    std::ifstream input(filename.c_str(), std::ios_base::binary);
+
+    // Total archive size
+    uint64_t fsize = 0;
+    if(input.seekg(0, std::ios_base::end))
+    {
+        fsize = input.tellg();
+        input.seekg(0);
+    }
+
+    char head[headerSize];
+    if(fsize < headerSize || !input.read(head, headerSize))
+        fail("File too small to be a valid archive");
+
+    if(!std::equal(head, head+sizeof(signature), signature))
+        fail("Unrecognized archive header");
+
+    if(readUInt(head+4) != version)
+        fail("Unsupported archive version");
+
+    size_t filenum = readUInt(head+8);
+    size_t namesize = readUInt(head+12);
+
+    if(filenum*recordSize + namesize > fsize - headerSize)
+        fail("Directory information larger than entire archive");
+
+    std::vector<char> records(filenum*recordSize);
+    if(filenum > 0)
+        input.read(&records[0], records.size());
+
+    stringBuf.resize(namesize);
+    if(namesize > 0)
+        input.read(&stringBuf[0], namesize);
+
+    if(!input)
+        fail("Unexpected end of file");
+
+    // Names are required to be terminated, so a corrupt archive can't make
+    // us read past the buffer
+    if(namesize > 0 && stringBuf[namesize-1] != 0)
+        fail("Archive contains an unterminated name");
+
+    normalizedBuf.resize(stringBuf.size());
+    std::transform(stringBuf.begin(), stringBuf.end(), normalizedBuf.begin(), &BSAFile::normalizeChar);
+
+    files.resize(filenum);
+    for(size_t i=0;i<filenum;i++)
+    {
+        const char *record = &records[i*recordSize];
+        FileStruct &fs = files[i];
+
+        fs.hash.low = readUInt(record);
+        fs.hash.high = readUInt(record+4);
+
+        size_t nameOffset = readUInt(record+8);
+        if(nameOffset >= stringBuf.size())
+            fail("Archive contains names outside the string table");
+
+        fs.name = &stringBuf[nameOffset];
+        fs.normalizedName = &normalizedBuf[nameOffset];
+
+        uint32_t codec = readUInt(record+12);
+        if(codec != Codec_None && codec != Codec_LZ4)
+            fail(std::string("Unknown codec for ") + fs.name);
+        fs.codec = static_cast<Codec>(codec);
+
+        fs.fileSize = readUInt(record+16);
+        fs.compressedSize = readUInt(record+20);
+        fs.offset = readUInt(record+24) | (static_cast<uint64_t>(readUInt(record+28)) << 32);
+
+        if(fs.codec == Codec_None && fs.compressedSize != fs.fileSize)
+            fail(std::string("Size mismatch for ") + fs.name);
+
+        if(fs.offset + fs.compressedSize > fsize)
+            fail("Archive contains offsets outside itself");
+
+        if(i > 0 && hashLess(fs, files[i-1].hash))
+            fail("Archive directory is not sorted");
+    }
+}
+
+int CompressedFile::getIndex(const char *str) const
+{
+    BSAFile::Hash hash = BSAFile::getHash(str);
+
+    for(FileList::const_iterator iter = std::lower_bound(files.begin(), files.end(), hash, hashLess);
+        iter != files.end() && iter->hash.low == hash.low && iter->hash.high == hash.high; ++iter)
+    {
+        // Compare the normalized names without building a copy of str
+        const char *a = iter->normalizedName;
+        const char *b = str;
+        while(*a && *a == BSAFile::normalizeChar(*b))
+        {
+            ++a;
+            ++b;
+        }
+        if(*a == 0 && *b == 0)
+            return iter - files.begin();
+    }
+
+    return -1;
+}
+
+Ogre::DataStreamPtr CompressedFile::getFile(const char *file) const
+{
+    int i = getIndex(file);
+    if(i == -1)
+        fail("File not found: " + std::string(file));
+
+    return getFile(i);
+}
+
+Ogre::DataStreamPtr CompressedFile::getFile(size_t index) const
+{
+    const FileStruct &fs = files.at(index);
+
+    if(fs.codec == Codec_None)
+        return openConstrainedFileDataStream(filename.c_str(), fs.offset, fs.fileSize);
+
+    std::vector<char> compressed(fs.compressedSize);
+    if(!compressed.empty() &&
+        openSharedLowLevelFile(filename.c_str())->readAt(&compressed[0], compressed.size(), fs.offset) != compressed.size())
+        fail(std::string("Unexpected end of file reading ") + fs.name);
+
+    boost::shared_ptr<std::vector<char> > buffer(new std::vector<char>(fs.fileSize));
+
+    if(fs.fileSize > 0 &&
+        LZ4_decompress_safe(&compressed[0], &(*buffer)[0], compressed.size(), buffer->size()) != static_cast<int>(fs.fileSize))
+        fail(std::string("Corrupt data in ") + fs.name);
+
+    return Ogre::DataStreamPtr(new BufferDataStream(fs.name, buffer));
+}
+
+void CompressedFile::prefetch(size_t index) const
+{
+    const FileStruct &fs = files.at(index);
+    openSharedLowLevelFile(filename.c_str())->prefetch(fs.offset, fs.compressedSize);
+}
+
+void CompressedFile::write(const std::string &path, const BSAWriter::EntryList &entries)
+{
+    size_t count = entries.size();
+
+    std::vector<FileStruct> records(count);
+    std::vector<uint32_t> nameOffsets(count);
+    std::vector<size_t> hashOrder(count);
+    uint32_t namesize = 0;
+
+    for(size_t i=0;i<count;i++)
+    {
+        records[i].hash = BSAFile::getHash(entries[i].name.c_str());
+        hashOrder[i] = i;
+    }
+
+    std::sort(hashOrder.begin(), hashOrder.end(), RecordLess(records));
+
+    for(size_t i=0;i<count;i++)
+    {
+        nameOffsets[hashOrder[i]] = namesize;
+        namesize += entries[hashOrder[i]].name.size() + 1;
+    }
+
+    std::ofstream stream(path.c_str(), std::ios::binary);
+    if(!stream)
+        throw std::runtime_error("Can't write archive: " + path);
+
+    // The directory is written once the stored sizes are known
+    uint64_t offset = headerSize + count*recordSize + namesize;
+    stream.seekp(offset);
+
+    std::vector<char> data;
+    std::vector<char> compressed;
+
+    for(size_t i=0;i<count;i++)
+    {
+        const BSAWriter::Entry &entry = entries[i];
+        FileStruct &fs = records[i];
+
+        data.resize(entry.size);
+        if(!data.empty() &&
+            openSharedLowLevelFile(entry.source.c_str())->readAt(&data[0], data.size(), entry.offset) != data.size())
+            throw std::runtime_error("Unexpected end of file: " + entry.source);
+
+        fs.fileSize = entry.size;
+        fs.offset = offset;
+        fs.codec = Codec_None;
+
+        const char *stored = data.empty() ? 0 : &data[0];
+        fs.compressedSize = data.size();
+
+        if(!data.empty() && data.size() <= LZ4_MAX_INPUT_SIZE)
+        {
+            compressed.resize(LZ4_compressBound(data.size()));
+
+            int size = LZ4_compress_HC(&data[0], &compressed[0], data.size(), compressed.size(), LZ4HC_CLEVEL_DEFAULT);
+
+            if(size > 0 && static_cast<size_t>(size) < data.size())
+            {
+                fs.codec = Codec_LZ4;
+                fs.compressedSize = size;
+                stored = &compressed[0];
+            }
+        }
+
+        stream.write(stored, fs.compressedSize);
+        offset += fs.compressedSize;
+    }
+
+    std::vector<char> directory(headerSize + count*recordSize + namesize);
+
+    std::copy(signature, signature+sizeof(signature), directory.begin());
+    writeUInt(&directory[4], version);
+    writeUInt(&directory[8], count);
+    writeUInt(&directory[12], namesize);
+
+    for(size_t i=0;i<count;i++)
+    {
+        const FileStruct &fs = records[hashOrder[i]];
+        char *record = &directory[headerSize + i*recordSize];
+
+        writeUInt(record, fs.hash.low);
+        writeUInt(record+4, fs.hash.high);
+        writeUInt(record+8, nameOffsets[hashOrder[i]]);
+        writeUInt(record+12, fs.codec);
+        writeUInt(record+16, fs.fileSize);
+        writeUInt(record+20, fs.compressedSize);
+        writeUInt(record+24, static_cast<uint32_t>(fs.offset));
+        writeUInt(record+28, static_cast<uint32_t>(fs.offset >> 32));
+
+        const std::string &name = entries[hashOrder[i]].name;
+        std::copy(name.c_str(), name.c_str()+name.size()+1,
+            directory.begin() + headerSize + count*recordSize + nameOffsets[hashOrder[i]]);
+    }
+
+    stream.seekp(0);
+    stream.write(&directory[0], directory.size());
+
+    stream.close();
+    if(!stream)
+        throw std::runtime_error("Error writing archive: " + path);
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef BSA_COMPRESSED_FILE_H
+#define BSA_COMPRESSED_FILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <OgreDataStream.h>
+
+#include "bsa_file.hpp"
+#include "bsa_writer.hpp"
+
+namespace Bsa
+{
+
+/**
+   This class is used to read OpenMW compressed archives (.omwa).
+
+   Every file is compressed on its own, so any file can be read without
+   touching the others. The directory is sorted by the same name hash BSA
+   archives use, and is searched in place.
+ */
+class CompressedFile
+{
+public:
+    /// How the data of a file is stored
+    enum Codec
+    {
+        Codec_None = 0,     ///< uncompressed, for data that does not shrink
+        Codec_LZ4 = 1       ///< a single LZ4 block
+    };
+
+    /// Represents one file entry in the archive
+    struct FileStruct
+    {
+        BSAFile::Hash hash;
+
+        // Zero-terminated file name, and the same name normalized as in
+        // BSAFile::FileStruct
+        const char *name;
+        const char *normalizedName;
+
+        // Offset of the stored data from the beginning of the archive
+        uint64_t offset;
+
+        // Stored and uncompressed size
+        uint32_t compressedSize, fileSize;
+
+        Codec codec;
+    };
+    typedef std::vector<FileStruct> FileList;
+
+private:
+    /// Table of files in this archive, sorted by hash
+    FileList files;
+
+    /// Filename string buffers
+    std::vector<char> stringBuf;
+    std::vector<char> normalizedBuf;
+
+    /// Used for error messages
+    std::string filename;
+
+    /// Error handling
+    void fail(const std::string &msg) const;
+
+public:
+    /// Open an archive file.
+    void open(const std::string &file);
+
+    /// Check if \a file starts with the signature of a compressed archive
+    static bool isCompressedFile(const std::string &file);
+
+    /// Get the index of a given file name in getList(), or -1 if not found
+    int getIndex(const char *str) const;
+
+    /// Check if a file exists
+    bool exists(const char *file) const
+    { return getIndex(file) != -1; }
+
+    /** Open a file contained in the archive. Throws an exception if the
+        file doesn't exist.
+    */
+    Ogre::DataStreamPtr getFile(const char *file) const;
+
+    /** Open the entry \a index of getList(). Compressed files are
+        decompressed completely before this returns. Safe to call from
+        several threads at once.
+    */
+    Ogre::DataStreamPtr getFile(size_t index) const;
+
+    /// Hint that the entry \a index will be read soon
+    void prefetch(size_t index) const;
+
+    /// Get a list of all files
+    const FileList &getList() const
+    { return files; }
+
+    /** Write an archive with the data of \a entries, in that order. Each
+        file is compressed with LZ4, or stored if it does not shrink.
+    */
+    static void write(const std::string &path, const BSAWriter::EntryList &entries);
+};
+
+}
+
+#endif
@@ -4,44 +4,24 @@
 #include <iostream>
 
 #include <OgreResourceGroupManager.h>
-#include <OgreStringConverter.h>
 
-#include "bsa_archive.hpp"
+#include "../vfs/index.hpp"
+#include "../vfs/archive.hpp"
 
-void Bsa::registerResources (const Files::Collections& collections,
-    const std::vector<std::string>& archives, bool useLooseFiles, bool fsStrict)
+boost::shared_ptr<VFS::Index> Bsa::registerResources (const Files::Collections& collections,
+    const std::vector<std::string>& archives, bool useLooseFiles, bool fsStrict, bool mapArchives)
 {
-    const Files::PathContainer& dataDirs = collections.getPaths();
+    boost::shared_ptr<VFS::Index> index (new VFS::Index (fsStrict));
 
-    int i=0;
-
-    if (useLooseFiles)
-        for (Files::PathContainer::const_iterator iter = dataDirs.begin(); iter != dataDirs.end(); ++iter)
-        {
-            // Last data dir has the highest priority
-            std::string groupName = "Data" + Ogre::StringConverter::toString(dataDirs.size()-i, 8, '0');
-            Ogre::ResourceGroupManager::getSingleton ().createResourceGroup (groupName);
-
-            std::string dataDirectory = iter->string();
-            std::cout << "Data dir " << dataDirectory << std::endl;
-            Bsa::addDir(dataDirectory, fsStrict, groupName);
-            ++i;
-        }
-
-    i=0;
+    // Sources are added with increasing priority: later BSAs override earlier ones, and loose
+    // files override all BSAs.
     for (std::vector<std::string>::const_iterator archive = archives.begin(); archive != archives.end(); ++archive)
     {
         if (collections.doesExist(*archive))
         {
-            // Last BSA has the highest priority
-            std::string groupName = "DataBSA" + Ogre::StringConverter::toString(archives.size()-i, 8, '0');
-
-            Ogre::ResourceGroupManager::getSingleton ().createResourceGroup (groupName);
-
             const std::string archivePath = collections.getPath(*archive).string();
             std::cout << "Adding BSA archive " << archivePath << std::endl;
-            Bsa::addBSA(archivePath, groupName);
-            ++i;
+            index->addArchive(archivePath, mapArchives);
         }
         else
         {
@@ -50,4 +30,25 @@ void Bsa::registerResources (const Files::Collections& collections,
             throw std::runtime_error(message.str());
         }
     }
-}
\ No newline at end of file
+
+    if (useLooseFiles)
+    {
+        const Files::PathContainer& dataDirs = collections.getPaths();
+
+        for (Files::PathContainer::const_iterator iter = dataDirs.begin(); iter != dataDirs.end(); ++iter)
+        {
+            std::cout << "Data dir " << iter->string() << std::endl;
+            index->addDirectory(*iter);
+        }
+    }
+
+    std::cout
+        << "Resource index: " << index->getSize() << " files from "
+        << index->getSources().size() << " sources, built in "
+        << static_cast<int> (index->getBuildTime()*1000) << " ms" << std::endl;
+
+    Ogre::ResourceGroupManager::getSingleton ().createResourceGroup ("Data");
+    VFS::registerIndex (index, "Data");
+
+    return index;
+}
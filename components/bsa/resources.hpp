@@ -4,13 +4,25 @@
 #include <vector>
 #include <string>
 
+#include <boost/shared_ptr.hpp>
+
 #include "../files/collections.hpp"
 
+namespace VFS
+{
+    class Index;
+}
+
 namespace Bsa
 {
-    void registerResources (const Files::Collections& collections,
-        const std::vector<std::string>& archives, bool useLooseFiles, bool fsStrict);
-    ///< Register resources directories and archives as OGRE resources groups
+    boost::shared_ptr<VFS::Index> registerResources (const Files::Collections& collections,
+        const std::vector<std::string>& archives, bool useLooseFiles, bool fsStrict,
+        bool mapArchives = false);
+    ///< Merge resources directories and archives into a single VFS::Index and register it as
+    /// the OGRE resource group "Data".
+    ///
+    /// \param mapArchives Memory map BSA archives instead of reading them through file handles
+    /// \return The index, for looking up resources without going through OGRE
 }
 
 #endif
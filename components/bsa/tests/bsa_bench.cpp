@@ -0,0 +1,57 @@
+#include "../bsa_file.hpp"
+
+/*
+  Benchmark of the two BSAFile read paths
+
+  Opens every file in the archive through getFile() and reads it to the
+  end, once through per-file handles and once through a memory mapping,
+  and reports the throughput of each. Run it twice to compare with a warm
+  page cache.
+
+  Usage: bsa_bench [archive] (defaults to data/Morrowind.bsa in the root
+  directory of OpenMW)
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+using namespace Bsa;
+
+void bench(const char *archive, bool mapped)
+{
+  BSAFile bsa;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  bsa.open(archive, mapped);
+
+  const BSAFile::FileList &files = bsa.getList();
+  vector<char> buffer;
+  size_t bytes = 0;
+
+  for(size_t i=0; i<files.size(); i++)
+    {
+      Ogre::DataStreamPtr stream = bsa.getFile(files[i].name);
+      buffer.resize(stream->size() + 1);
+      bytes += stream->read(&buffer[0], stream->size());
+    }
+
+  double secs = (boost::posix_time::microsec_clock::universal_time() - start)
+    .total_microseconds() / 1000000.0;
+
+  cout << (mapped ? "mapped:     " : "file handle:")
+       << " " << files.size() << " files, " << bytes << " bytes in "
+       << fixed << setprecision(3) << secs << "s ("
+       << setprecision(0) << files.size() / secs << " files/s, "
+       << setprecision(1) << bytes / secs / (1024*1024) << " MB/s)\n";
+}
+
+int main(int argc, char **argv)
+{
+  const char *archive = argc > 1 ? argv[1] : "../../data/Morrowind.bsa";
+
+  bench(archive, false);
+  bench(archive, true);
+}
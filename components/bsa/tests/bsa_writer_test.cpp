@@ -0,0 +1,48 @@
+#include "../bsa_writer.hpp"
+#include "../bsa_file.hpp"
+
+/*
+  Test of the BSAWriter class
+
+  Packs a few files of this directory into an archive, with the data
+  in a custom order, and reads it back with BSAFile.
+
+ */
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace Bsa;
+
+int main()
+{
+  BSAWriter writer;
+  writer.addFile("tests/Makefile", "Makefile");
+  writer.addFile("tests\\test.sh", "test.sh");
+  writer.addFile("tests/bsa_file_test.cpp", "bsa_file_test.cpp", 0, 64);
+
+  vector<string> order;
+  order.push_back("tests/test.sh");
+  writer.setOrder(order);
+
+  cout << "Writing bsa_writer_test.bsa\n";
+  writer.write("bsa_writer_test.bsa");
+
+  BSAFile bsa;
+  bsa.open("bsa_writer_test.bsa");
+
+  const BSAFile::FileList &files = bsa.getList();
+
+  cout << "Files in hash order:\n";
+  for(size_t i=0; i<files.size(); i++)
+    cout << "  " << files[i].name
+         << " (" << files[i].hash.low << " " << files[i].hash.high << ")\n";
+
+  cout << "First file in data order:\n  "
+       << writer.getEntries()[0].name << " @" << bsa.getList()[bsa.getIndex("tests/test.sh")].offset << "\n";
+
+  cout << "Does 'TESTS\\BSA_FILE_TEST.CPP' exist?\n  "
+       << (bsa.exists("TESTS\\BSA_FILE_TEST.CPP") ? "Yes" : "No") << ", "
+       << files[bsa.getIndex("TESTS\\BSA_FILE_TEST.CPP")].fileSize << " bytes\n";
+}
@@ -0,0 +1,60 @@
+#include "../compressed_file.hpp"
+
+/*
+  Test of the CompressedFile class
+
+  Converts a few files of this directory into a compressed archive and
+  reads them back.
+
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace Bsa;
+
+string readFile(const char *name)
+{
+  ifstream in(name, ios::binary);
+  stringstream data;
+  data << in.rdbuf();
+  return data.str();
+}
+
+void check(const CompressedFile &archive, const char *name, const char *source)
+{
+  cout << "Does file '" << name << "' exist?\n  ";
+  int index = archive.getIndex(name);
+  if(index == -1)
+    {
+      cout << "No.\n";
+      return;
+    }
+
+  Ogre::DataStreamPtr stream = archive.getFile(index);
+  string data(stream->size(), 0);
+  stream->read(&data[0], data.size());
+
+  cout << "Yes, " << (archive.getList()[index].codec == CompressedFile::Codec_LZ4 ? "compressed" : "stored")
+       << ", contents " << (data == readFile(source) ? "match" : "differ") << "\n";
+}
+
+int main()
+{
+  BSAWriter writer;
+  writer.addFile("tests/Makefile", "Makefile");
+  writer.addFile("tests/test.sh", "test.sh");
+  writer.addFile("tests/bsa_file_test.cpp", "bsa_file_test.cpp");
+
+  cout << "Writing compressed_file_test.omwa\n";
+  CompressedFile::write("compressed_file_test.omwa", writer.getEntries());
+
+  CompressedFile archive;
+  archive.open("compressed_file_test.omwa");
+
+  check(archive, "TESTS\\MAKEFILE", "Makefile");
+  check(archive, "tests/bsa_file_test.cpp", "bsa_file_test.cpp");
+  check(archive, "tests\\humdrum", "test.sh");
+}
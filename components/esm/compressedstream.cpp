@@ -0,0 +1,228 @@
+#ifdef OPENMW_USE_LZ4
+
+#include "compressedstream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+#include <lz4.h>
+
+namespace
+{
+    const char sSignature[4] = { 'O', 'M', 'W', 'Z' };
+    const uint32_t sVersion = 1;
+
+    const size_t sNoBlock = static_cast<size_t> (-1);
+
+    uint32_t readUInt (const char *data)
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *> (data);
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t> (bytes[3]) << 24);
+    }
+
+    void writeUInt (char *data, uint32_t value)
+    {
+        for (int i=0; i<4; ++i)
+            data[i] = static_cast<char> ((value >> (8*i)) & 0xff);
+    }
+}
+
+const size_t ESM::CompressedDataStream::sHeaderSize;
+const size_t ESM::CompressedDataStream::sBlockHeaderSize;
+const size_t ESM::CompressedDataStream::sBlockSize;
+
+bool ESM::CompressedDataStream::startsAfter (size_t pos, const Block& block)
+{
+    return pos<block.mStart;
+}
+
+void ESM::CompressedDataStream::fail (const std::string& message) const
+{
+    throw std::runtime_error ("Compressed file error: " + message + "\nFile: " + mName);
+}
+
+bool ESM::CompressedDataStream::nextBlock()
+{
+    Block block;
+    block.mStart = 0;
+    block.mOffset = sHeaderSize;
+
+    if (!mBlocks.empty())
+    {
+        const Block& last = mBlocks.back();
+        block.mStart = last.mStart + last.mSize;
+        block.mOffset = last.mOffset + sBlockHeaderSize + last.mStored;
+    }
+
+    if (block.mStart>=mSize)
+        return false;
+
+    char header[sBlockHeaderSize];
+
+    mSource->seek (block.mOffset);
+    if (mSource->read (header, sBlockHeaderSize)!=sBlockHeaderSize)
+        fail ("Unexpected end of file");
+
+    block.mSize = readUInt (header);
+    block.mStored = readUInt (header+4);
+
+    if (block.mSize==0 || block.mSize>sBlockSize || block.mSize>mSize-block.mStart ||
+        block.mStored==0 || block.mStored>static_cast<size_t> (LZ4_compressBound (block.mSize)))
+        fail ("Invalid block header");
+
+    mBlocks.push_back (block);
+    return true;
+}
+
+void ESM::CompressedDataStream::load (size_t pos)
+{
+    if (mCurrent!=sNoBlock && pos>=mBlocks[mCurrent].mStart &&
+        pos-mBlocks[mCurrent].mStart<mBlocks[mCurrent].mSize)
+        return;
+
+    while (mBlocks.empty() || pos>=mBlocks.back().mStart+mBlocks.back().mSize)
+        if (!nextBlock())
+            fail ("Read beyond the end of the file");
+
+    mCurrent = std::upper_bound (mBlocks.begin(), mBlocks.end(), pos, startsAfter) - mBlocks.begin() - 1;
+
+    const Block& block = mBlocks[mCurrent];
+
+    mData.resize (block.mSize);
+    mStored.resize (block.mStored);
+
+    mSource->seek (block.mOffset + sBlockHeaderSize);
+    if (mSource->read (&mStored[0], block.mStored)!=block.mStored)
+        fail ("Unexpected end of file");
+
+    if (block.mStored==block.mSize)
+        mData.swap (mStored);
+    else if (LZ4_decompress_safe (&mStored[0], &mData[0], block.mStored, block.mSize)!=
+        static_cast<int> (block.mSize))
+    {
+        mCurrent = sNoBlock;
+        fail ("Corrupt block");
+    }
+}
+
+bool ESM::CompressedDataStream::isCompressed (Ogre::DataStreamPtr stream)
+{
+    char head[sizeof (sSignature)];
+    bool compressed = isCompressed (head, stream->read (head, sizeof (head)));
+
+    stream->seek (0);
+    return compressed;
+}
+
+bool ESM::CompressedDataStream::isCompressed (const char *data, size_t size)
+{
+    return size>=sizeof (sSignature) && std::equal (data, data+sizeof (sSignature), sSignature);
+}
+
+void ESM::CompressedDataStream::writeHeader (std::ostream& stream, uint64_t size)
+{
+    char header[sHeaderSize];
+    std::memcpy (header, sSignature, sizeof (sSignature));
+    writeUInt (header+4, sVersion);
+    writeUInt (header+8, static_cast<uint32_t> (size));
+    writeUInt (header+12, static_cast<uint32_t> (size >> 32));
+
+    stream.write (header, sHeaderSize);
+}
+
+void ESM::CompressedDataStream::writeBlock (std::ostream& stream, const char *data, size_t size)
+{
+    std::vector<char> block (sBlockHeaderSize + LZ4_compressBound (size));
+
+    int stored = LZ4_compress_default (data, &block[sBlockHeaderSize], size, block.size()-sBlockHeaderSize);
+
+    if (stored<=0 || static_cast<size_t> (stored)>=size)
+    {
+        // Not worth compressing
+        stored = size;
+        std::memcpy (&block[sBlockHeaderSize], data, size);
+    }
+
+    writeUInt (&block[0], size);
+    writeUInt (&block[4], stored);
+
+    stream.write (&block[0], sBlockHeaderSize + stored);
+}
+
+ESM::CompressedDataStream::CompressedDataStream (Ogre::DataStreamPtr source)
+: Ogre::DataStream (source->getName()), mSource (source), mCurrent (sNoBlock), mPos (0)
+{
+    char header[sHeaderSize];
+
+    if (mSource->read (header, sHeaderSize)!=sHeaderSize ||
+        !std::equal (header, header+sizeof (sSignature), sSignature))
+        fail ("Not a compressed file");
+
+    if (readUInt (header+4)!=sVersion)
+        fail ("Unsupported version");
+
+    uint64_t size = readUInt (header+8) | (static_cast<uint64_t> (readUInt (header+12)) << 32);
+
+    if (size>static_cast<size_t> (-1))
+        fail ("File too large");
+
+    mSize = static_cast<size_t> (size);
+}
+
+size_t ESM::CompressedDataStream::read (void *buffer, size_t count)
+{
+    char *target = static_cast<char *> (buffer);
+    size_t done = 0;
+
+    while (done<count && mPos<mSize)
+    {
+        load (mPos);
+
+        const Block& block = mBlocks[mCurrent];
+        size_t offset = mPos - block.mStart;
+        size_t size = std::min (count-done, block.mSize-offset);
+
+        std::memcpy (target+done, &mData[offset], size);
+
+        done += size;
+        mPos += size;
+    }
+
+    return done;
+}
+
+void ESM::CompressedDataStream::skip (long count)
+{
+    if (count<0 && static_cast<size_t> (-count)>mPos)
+        mPos = 0;
+    else
+        seek (mPos + count);
+}
+
+void ESM::CompressedDataStream::seek (size_t pos)
+{
+    mPos = std::min (pos, mSize);
+}
+
+size_t ESM::CompressedDataStream::tell() const
+{
+    return mPos;
+}
+
+bool ESM::CompressedDataStream::eof() const
+{
+    return mPos>=mSize;
+}
+
+void ESM::CompressedDataStream::close()
+{
+    mSource->close();
+    mBlocks.clear();
+    mData.clear();
+    mStored.clear();
+    mCurrent = sNoBlock;
+}
+
+#endif
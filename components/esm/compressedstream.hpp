@@ -0,0 +1,86 @@
+#ifndef OPENMW_ESM_COMPRESSEDSTREAM_H
+#define OPENMW_ESM_COMPRESSEDSTREAM_H
+
+#include <iosfwd>
+#include <vector>
+
+#include <stdint.h>
+
+#include <OgreDataStream.h>
+
+namespace ESM
+{
+    /// \brief Reads an LZ4 compressed ESM file as if it was not compressed
+    ///
+    /// A compressed file starts with a 16 byte header: the signature "OMWZ", the format version
+    /// and the size of the uncompressed data (64 bit). It is followed by blocks of at most
+    /// sBlockSize uncompressed bytes, each with an 8 byte header holding its uncompressed and its
+    /// stored size. A block that does not compress is stored as is, with both sizes equal. All
+    /// integers are little endian.
+    ///
+    /// Blocks are decompressed when they are read, so reading the start of a file (e.g. its TES3
+    /// header) only decompresses the blocks that hold it.
+    class CompressedDataStream : public Ogre::DataStream
+    {
+            struct Block
+            {
+                size_t mStart; ///< offset in the uncompressed data
+                size_t mSize; ///< uncompressed
+                size_t mOffset; ///< of the block header in the file
+                size_t mStored;
+            };
+
+            Ogre::DataStreamPtr mSource;
+            std::vector<Block> mBlocks; ///< the blocks found so far, in file order
+            size_t mCurrent; ///< index of the block in mData
+            std::vector<char> mData;
+            std::vector<char> mStored;
+            size_t mPos;
+
+            static bool startsAfter (size_t pos, const Block& block);
+
+            void fail (const std::string& message) const;
+
+            bool nextBlock();
+            ///< Add the block after the last one found to mBlocks.
+            /// \return Is there one?
+
+            void load (size_t pos);
+            ///< Decompress the block holding \a pos into mData.
+
+        public:
+
+            static const size_t sHeaderSize = 16;
+            static const size_t sBlockHeaderSize = 8;
+            static const size_t sBlockSize = 1 << 18;
+
+            static bool isCompressed (Ogre::DataStreamPtr stream);
+            ///< Does \a stream start with the signature of a compressed file? Rewinds \a stream.
+
+            static bool isCompressed (const char *data, size_t size);
+            ///< Do the first \a size bytes of a file start with the signature of a compressed file?
+
+            static void writeHeader (std::ostream& stream, uint64_t size);
+            ///< Write the file header, for \a size bytes of uncompressed data.
+
+            static void writeBlock (std::ostream& stream, const char *data, size_t size);
+            ///< Compress \a size bytes (at most sBlockSize) into a block.
+
+            CompressedDataStream (Ogre::DataStreamPtr source);
+            ///< \a source must be positioned at the start of the file.
+
+            virtual size_t read (void *buffer, size_t count);
+
+            virtual void skip (long count);
+
+            virtual void seek (size_t pos);
+
+            virtual size_t tell() const;
+
+            virtual bool eof() const;
+
+            virtual void close();
+    };
+}
+
+#endif
@@ -93,6 +93,8 @@ enum RecNameInts
     REC_GMAP = 0x50414d47,
     REC_DIAS = 0x53414944,
     REC_WTHR = 0x52485457,
+    REC_DELT = 0x544c4544,
+    REC_SLOT = 0x544f4c53,
 
     // format 1
     REC_FILT = 0x544C4946
@@ -3,6 +3,8 @@
 
 #include "../files/constrainedfiledatastream.hpp"
 
+#include "compressedstream.hpp"
+
 namespace ESM
 {
 
@@ -16,16 +18,21 @@ using namespace Misc;
 ESM_Context ESMReader::getContext()
 {
     // Update the file position before returning
-    mCtx.filePos = mEsm->tell();
+    mCtx.filePos = tell();
     return mCtx;
 }
 
 ESMReader::ESMReader()
     : mBuffer(50*1024)
     , mRecordFlags(0)
+    , mRecordOffset(0)
     , mIdx(0)
     , mGlobalReaderList(NULL)
     , mEncoder(NULL)
+    , mData(NULL)
+    , mSize(0)
+    , mPos(0)
+    , mMemoryMapped(true)
 {
 }
 
@@ -44,12 +51,37 @@ void ESMReader::restoreContext(const ESM_Context &rc)
     mCtx = rc;
 
     // Make sure we seek to the right place
-    mEsm->seek(mCtx.filePos);
+    seek(mCtx.filePos);
+}
+
+void ESMReader::seekRecord(size_t offset)
+{
+    size_t size = getFileSize();
+    if (offset > size)
+        fail("Record offset beyond the end of the file");
+
+    mCtx.leftFile = size - offset;
+    mCtx.leftRec = 0;
+    mCtx.leftSub = 0;
+    mCtx.subCached = false;
+    seek(offset);
+}
+
+void ESMReader::seek(size_t pos)
+{
+    if (mData)
+        mPos = pos < mSize ? pos : mSize;
+    else
+        mEsm->seek(pos);
 }
 
 void ESMReader::close()
 {
     mEsm.setNull();
+    mMapping.reset();
+    mData = NULL;
+    mSize = 0;
+    mPos = 0;
     mCtx.filename.clear();
     mCtx.leftFile = 0;
     mCtx.leftRec = 0;
@@ -62,7 +94,12 @@ void ESMReader::close()
 void ESMReader::openRaw(Ogre::DataStreamPtr _esm, const std::string &name)
 {
     close();
+#ifdef OPENMW_USE_LZ4
+    mEsm = CompressedDataStream::isCompressed (_esm) ?
+        Ogre::DataStreamPtr (new CompressedDataStream (_esm)) : _esm;
+#else
     mEsm = _esm;
+#endif
     mCtx.filename = name;
     mCtx.leftFile = mEsm->size();
 }
@@ -70,7 +107,11 @@ void ESMReader::openRaw(Ogre::DataStreamPtr _esm, const std::string &name)
 void ESMReader::open(Ogre::DataStreamPtr _esm, const std::string &name)
 {
     openRaw(_esm, name);
+    readHeader();
+}
 
+void ESMReader::readHeader()
+{
     if (getRecName() != "TES3")
         fail("Not a valid Morrowind file");
 
@@ -81,12 +122,38 @@ void ESMReader::open(Ogre::DataStreamPtr _esm, const std::string &name)
 
 void ESMReader::open(const std::string &file)
 {
-    open (openConstrainedFileDataStream (file.c_str ()), file);
+    openRaw (file);
+    readHeader();
 }
 
 void ESMReader::openRaw(const std::string &file)
 {
-    openRaw (openConstrainedFileDataStream (file.c_str ()), file);
+    if (!mMemoryMapped)
+    {
+        openRaw (openConstrainedFileDataStream (file.c_str ()), file);
+        return;
+    }
+
+    close();
+
+    MemoryMappedFilePtr mapping (new MemoryMappedFile);
+    mapping->open (file.c_str ());
+
+#ifdef OPENMW_USE_LZ4
+    if (CompressedDataStream::isCompressed (mapping->data(), mapping->size()))
+    {
+        // Decompressed block by block instead
+        openRaw (openConstrainedFileDataStream (file.c_str ()), file);
+        return;
+    }
+#endif
+
+    mMapping = mapping;
+    mData = mapping->data();
+    mSize = mapping->size();
+    mPos = 0;
+    mCtx.filename = file;
+    mCtx.leftFile = mSize;
 }
 
 int64_t ESMReader::getHNLong(const char *name)
@@ -122,8 +189,8 @@ std::string ESMReader::getHString()
     {
         // Skip the following zero byte
         mCtx.leftRec--;
-        char c;
-        mEsm->read(&c, 1);
+        if (tell() < getFileSize())
+            skip(1);
         return "";
     }
 
@@ -182,7 +249,7 @@ void ESMReader::getSubName()
     }
 
     // reading the subrecord data anyway.
-    mEsm->read(mCtx.subName.name, 4);
+    getExact(mCtx.subName.name, 4);
     mCtx.leftRec -= 4;
 }
 
@@ -190,7 +257,7 @@ bool ESMReader::isEmptyOrGetName()
 {
     if (mCtx.leftRec)
     {
-        mEsm->read(mCtx.subName.name, 4);
+        getExact(mCtx.subName.name, 4);
         mCtx.leftRec -= 4;
         return false;
     }
@@ -233,6 +300,7 @@ NAME ESMReader::getRecName()
 {
     if (!hasMoreRecs())
         fail("No more records, getRecName() failed");
+    mRecordOffset = tell();
     getName(mCtx.recName);
     mCtx.leftFile -= 4;
 
@@ -285,15 +353,31 @@ void ESMReader::getRecHeader(uint32_t &flags)
  *
  *************************************************************************/
 
-void ESMReader::getExact(void*x, int size)
+void ESMReader::getExactSlow(void*x, int size)
 {
-    int t = mEsm->read(x, size);
-    if (t != size)
+    // Mapped files only get here when reading past the end
+    if (mData || mEsm->read(x, size) != static_cast<size_t>(size))
         fail("Read error");
 }
 
 std::string ESMReader::getString(int size)
 {
+    // Mapped strings are converted in place, without a copy to mBuffer.
+    // The encoder needs a terminator though, which not all strings have.
+    if (mData && static_cast<size_t>(size) <= mSize - mPos &&
+        (!mEncoder || (size>0 && mData[mPos+size-1]==0)))
+    {
+        const char *ptr = getView(size);
+
+        if (size>0 && ptr[size-1]==0)
+            --size;
+
+        if (mEncoder)
+            return mEncoder->getUtf8(ptr, size);
+
+        return std::string (ptr, size);
+    }
+
     size_t s = size;
     if (mBuffer.size() <= s)
         // Add some extra padding to reduce the chance of having to resize
@@ -327,8 +411,8 @@ void ESMReader::fail(const std::string &msg)
     ss << "\n  File: " << mCtx.filename;
     ss << "\n  Record: " << mCtx.recName.toString();
     ss << "\n  Subrecord: " << mCtx.subName.toString();
-    if (!mEsm.isNull())
-        ss << "\n  Offset: 0x" << hex << mEsm->tell();
+    if (mData || !mEsm.isNull())
+        ss << "\n  Offset: 0x" << hex << tell();
     throw std::runtime_error(ss.str());
 }
 
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <libs/platform/string.h>
 #include <cassert>
+#include <cstring>
 #include <vector>
 #include <sstream>
 
@@ -13,6 +14,8 @@
 
 #include <components/to_utf8/to_utf8.hpp>
 
+#include <components/files/memorymappedfile.hpp>
+
 #include "esmcommon.hpp"
 #include "loadtes3.hpp"
 
@@ -54,13 +57,19 @@ public:
   /** Restore a previously saved context */
   void restoreContext(const ESM_Context &rc);
 
+  /** Move to the start of the record at \a offset, as found by an
+      earlier pass over the same file
+   */
+  void seekRecord(size_t offset);
+
   /** Close the file, resets all information. After calling close()
       the structure may be reused to load a new file.
   */
   void close();
 
   /// Raw opening. Opens the file and sets everything up but doesn't
-  /// parse the header.
+  /// parse the header. Compressed files (see CompressedDataStream) are
+  /// decompressed as they are read.
   void openRaw(Ogre::DataStreamPtr _esm, const std::string &name);
 
   /// Load ES file from a new stream, parses the header. Closes the
@@ -71,10 +80,17 @@ public:
 
   void openRaw(const std::string &file);
 
+  /// Map files opened by name into memory instead of reading them
+  /// through a stream (default: true). Takes effect on the next open.
+  void setMemoryMapped(bool mapped) { mMemoryMapped = mapped; }
+  bool isMemoryMapped() const { return mData != NULL; }
+
   /// Get the file size. Make sure that the file has been opened!
-  size_t getFileSize() { return mEsm->size(); }
+  size_t getFileSize() { return mData ? mSize : mEsm->size(); }
   /// Get the current position in the file. Make sure that the file has been opened!
-  size_t getFileOffset() { return mEsm->tell(); }
+  size_t getFileOffset() { return tell(); }
+  /// Get the position of the record whose name was read last, for seekRecord()
+  size_t getRecordOffset() const { return mRecordOffset; }
 
   // This is a quick hack for multiple esm/esp files. Each plugin introduces its own
   //  terrain palette, but ESMReader does not pass a reference to the correct plugin
@@ -157,6 +173,12 @@ public:
   // Read a string, including the sub-record header (but not the name)
   std::string getHString();
 
+  // Get the data of the current sub-record, after getSubHeader(),
+  // without copying it. Only valid while the file stays open, and
+  // only for memory mapped files; returns NULL otherwise and leaves
+  // the sub-record unread.
+  const char *getSubView() { return getView(mCtx.leftSub); }
+
   // Read the given number of bytes from a subrecord
   void getHExact(void*p, int size);
 
@@ -238,7 +260,32 @@ public:
   template <typename X>
   void getT(X &x) { getExact(&x, sizeof(X)); }
 
-  void getExact(void*x, int size);
+  void getExact(void*x, int size)
+  {
+      // Fast path for mapped files, used for every name, header and
+      // fixed size sub-record
+      if (mData && static_cast<size_t>(size) <= mSize - mPos)
+      {
+          std::memcpy(x, mData + mPos, size);
+          mPos += size;
+      }
+      else
+          getExactSlow(x, size);
+  }
+
+  // Return a pointer to the next 'size' bytes and skip them, or NULL
+  // if the file is not memory mapped (nothing is skipped then).
+  const char *getView(size_t size)
+  {
+      if (!mData)
+          return NULL;
+      if (size > mSize - mPos)
+          fail("Read error");
+      const char *view = mData + mPos;
+      mPos += size;
+      return view;
+  }
+
   void getName(NAME &name) { getT(name); }
   void getUint(uint32_t &u) { getT(u); }
 
@@ -246,24 +293,34 @@ public:
   // them from native encoding to UTF8 in the process.
   std::string getString(int size);
 
-  void skip(int bytes) { mEsm->seek(mEsm->tell()+bytes); }
-  uint64_t getOffset() { return mEsm->tell(); }
+  void skip(int bytes) { seek(tell()+bytes); }
+  uint64_t getOffset() { return tell(); }
 
   /// Used for error handling
   void fail(const std::string &msg);
 
   /// Sets font encoder for ESM strings
   void setEncoder(ToUTF8::Utf8Encoder* encoder);
+  ToUTF8::Utf8Encoder* getEncoder() const { return mEncoder; }
 
   /// Get record flags of last record
   unsigned int getRecordFlags() { return mRecordFlags; }
 
 private:
+  size_t tell() const { return mData ? mPos : mEsm->tell(); }
+  void seek(size_t pos);
+
+  void getExactSlow(void*x, int size);
+
+  /// Parse the TES3 header record of a freshly opened file
+  void readHeader();
+
   Ogre::DataStreamPtr mEsm;
 
   ESM_Context mCtx;
 
   unsigned int mRecordFlags;
+  size_t mRecordOffset;
 
   // Special file signifier (see SpecialFile enum above)
 
@@ -274,6 +331,13 @@ private:
 
   std::vector<ESMReader> *mGlobalReaderList;
   ToUTF8::Utf8Encoder* mEncoder;
+
+  /// Mapped file, if opened memory mapped. mEsm is null then.
+  MemoryMappedFilePtr mMapping;
+  const char *mData;
+  size_t mSize;
+  size_t mPos;
+  bool mMemoryMapped;
 };
 }
 #endif
@@ -1,12 +1,25 @@
 #include "esmwriter.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <stdexcept>
 
+#include "compressedstream.hpp"
+
+namespace
+{
+    /// The buffer is written to the stream once it holds this many bytes
+    const size_t sFlushSize = 1 << 20;
+}
+
 namespace ESM
 {
-    ESMWriter::ESMWriter() : mEncoder (0), mRecordCount (0), mCounting (true) {}
+    ESMWriter::ESMWriter()
+    : mStream (0), mEncoder (0), mRecordCount (0), mCompressed (false), mCompressing (false),
+      mSize (0)
+    {}
 
     unsigned int ESMWriter::getVersion() const
     {
@@ -38,6 +51,13 @@ namespace ESM
         mHeader.mFormat = format;
     }
 
+    void ESMWriter::setCompressed (bool compressed)
+    {
+#ifdef OPENMW_USE_LZ4
+        mCompressed = compressed;
+#endif
+    }
+
     void ESMWriter::clearMaster()
     {
         mHeader.mMaster.clear();
@@ -53,10 +73,16 @@ namespace ESM
 
     void ESMWriter::save(std::ostream& file)
     {
-        mRecordCount = 0;
-        mRecords.clear();
-        mCounting = true;
-        mStream = &file;
+        append(file);
+
+#ifdef OPENMW_USE_LZ4
+        if (mCompressed)
+        {
+            mCompressing = true;
+            mStart = file.tellp();
+            CompressedDataStream::writeHeader (file, 0);
+        }
+#endif
 
         startRecord("TES3", 0);
 
@@ -65,10 +91,52 @@ namespace ESM
         endRecord("TES3");
     }
 
+    void ESMWriter::append(std::ostream& file)
+    {
+        mRecordCount = 0;
+        mRecords.clear();
+        mBuffer.clear();
+        mStream = &file;
+        mCompressing = false;
+        mSize = 0;
+    }
+
     void ESMWriter::close()
     {
         if (!mRecords.empty())
             throw std::runtime_error ("Unclosed record remaining");
+
+        flush();
+
+#ifdef OPENMW_USE_LZ4
+        if (mCompressing)
+        {
+            std::streampos end = mStream->tellp();
+            mStream->seekp (mStart);
+            CompressedDataStream::writeHeader (*mStream, mSize);
+            mStream->seekp (end);
+        }
+#endif
+    }
+
+    void ESMWriter::flush()
+    {
+        assert (mRecords.empty());
+
+#ifdef OPENMW_USE_LZ4
+        if (mCompressing)
+        {
+            for (size_t i=0; i<mBuffer.size(); i+=CompressedDataStream::sBlockSize)
+                CompressedDataStream::writeBlock (*mStream, &mBuffer[i],
+                    std::min (CompressedDataStream::sBlockSize, mBuffer.size()-i));
+        }
+        else
+#endif
+        if (!mBuffer.empty())
+            mStream->write (&mBuffer[0], mBuffer.size());
+
+        mSize += mBuffer.size();
+        mBuffer.clear();
     }
 
     void ESMWriter::startRecord(const std::string& name, uint32_t flags)
@@ -78,14 +146,12 @@ namespace ESM
         writeName(name);
         RecordData rec;
         rec.name = name;
-        rec.position = mStream->tellp();
-        rec.size = 0;
+        rec.position = mBuffer.size();
         writeT<uint32_t>(0); // Size goes here
         writeT<uint32_t>(0); // Unused header?
         writeT(flags);
+        rec.start = mBuffer.size();
         mRecords.push_back(rec);
-
-        assert(mRecords.back().size == 0);
     }
 
     void ESMWriter::startRecord (uint32_t name, uint32_t flags)
@@ -103,28 +169,24 @@ namespace ESM
         writeName(name);
         RecordData rec;
         rec.name = name;
-        rec.position = mStream->tellp();
-        rec.size = 0;
+        rec.position = mBuffer.size();
         writeT<uint32_t>(0); // Size goes here
+        rec.start = mBuffer.size();
         mRecords.push_back(rec);
-
-        assert(mRecords.back().size == 0);
     }
 
     void ESMWriter::endRecord(const std::string& name)
     {
-        RecordData rec = mRecords.back();
+        const RecordData& rec = mRecords.back();
         assert(rec.name == name);
-        mRecords.pop_back();
-
-        mStream->seekp(rec.position);
 
-        mCounting = false;
-        write (reinterpret_cast<const char*> (&rec.size), sizeof(uint32_t));
-        mCounting = true;
+        uint32_t size = mBuffer.size() - rec.start;
+        std::memcpy (&mBuffer[rec.position], &size, sizeof(uint32_t));
 
-        mStream->seekp(0, std::ios::end);
+        mRecords.pop_back();
 
+        if (mRecords.empty() && mBuffer.size() >= sFlushSize)
+            flush();
     }
 
     void ESMWriter::endRecord (uint32_t name)
@@ -187,13 +249,7 @@ namespace ESM
 
     void ESMWriter::write(const char* data, size_t size)
     {
-        if (mCounting && !mRecords.empty())
-        {
-            for (std::list<RecordData>::iterator it = mRecords.begin(); it != mRecords.end(); ++it)
-                it->size += size;
-        }
-
-        mStream->write(data, size);
+        mBuffer.insert(mBuffer.end(), data, data + size);
     }
 
     void ESMWriter::setEncoder(ToUTF8::Utf8Encoder* encoder)
@@ -2,7 +2,7 @@
 #define OPENMW_ESM_WRITER_H
 
 #include <iosfwd>
-#include <list>
+#include <vector>
 
 #include <components/to_utf8/to_utf8.hpp>
 
@@ -11,13 +11,21 @@
 
 namespace ESM {
 
+/// \brief Writes records to a stream
+///
+/// Records are assembled in memory, where their sizes are filled in once they are complete,
+/// and written to the stream in large chunks between records. Nothing is guaranteed to reach the
+/// stream before close().
+///
+/// Files started with save() can be compressed (see CompressedDataStream). ESMReader detects
+/// compressed files and reads them transparently.
 class ESMWriter
 {
         struct RecordData
         {
             std::string name;
-            std::streampos position;
-            uint32_t size;
+            size_t position; ///< of the size field in mBuffer
+            size_t start; ///< of the data in mBuffer
         };
 
     public:
@@ -31,6 +39,10 @@ class ESMWriter
         void setDescription(const std::string& desc);
         void setRecordCount (int count);
         void setFormat (int format);
+        void setCompressed (bool compressed);
+        ///< Compress files started with save() from now on (default: false). Needs a stream
+        /// that can seek back to the start of the file, to fill in the size of the data.
+        /// Ignored when built without LZ4.
 
         void clearMaster();
 
@@ -39,8 +51,19 @@ class ESMWriter
         void save(std::ostream& file);
         ///< Start saving a file by writing the TES3 header.
 
+        void append(std::ostream& file);
+        ///< Start saving records without a TES3 header, e.g. to add them to a file whose header
+        /// was written by another writer.
+
         void close();
-        ///< \note Does not close the stream.
+        ///< Write what is left in the buffer.
+        /// \note Does not close the stream.
+
+        void flush();
+        ///< Write the buffer to the stream. There must not be any open records.
+        ///
+        /// When compressing, this ends the current block, so that the records written up to here
+        /// can be read without decompressing any of the records after them.
 
         void writeHNString(const std::string& name, const std::string& data);
         void writeHNString(const std::string& name, const std::string& data, size_t size);
@@ -100,12 +123,16 @@ class ESMWriter
         void write(const char* data, size_t size);
 
     private:
-        std::list<RecordData> mRecords;
+
+        std::vector<RecordData> mRecords;
+        std::vector<char> mBuffer;
         std::ostream* mStream;
-        std::streampos mHeaderPos;
         ToUTF8::Utf8Encoder* mEncoder;
         int mRecordCount;
-        bool mCounting;
+        bool mCompressed;
+        bool mCompressing; ///< The current file is compressed.
+        std::streampos mStart; ///< of the current file in the stream
+        uint64_t mSize; ///< uncompressed bytes written so far
 
         Header mHeader;
     };
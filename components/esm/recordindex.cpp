@@ -0,0 +1,138 @@
+#include "recordindex.hpp"
+
+#include <sstream>
+
+#include <components/misc/stringops.hpp>
+
+#include "esmreader.hpp"
+#include "esmwriter.hpp"
+#include "defs.hpp"
+#include "loadcell.hpp"
+#include "loadpgrd.hpp"
+
+void ESM::RecordIndex::build (ESMReader& esm, const std::set<int>& types)
+{
+    while (esm.hasMoreRecs())
+    {
+        NAME name = esm.getRecName();
+        esm.getRecHeader();
+
+        if (types.count (name.val))
+            add (name.val, esm.getRecordOffset(), readId (esm, name.val));
+
+        esm.skipRecord();
+    }
+}
+
+void ESM::RecordIndex::add (int type, size_t offset, const std::string& id)
+{
+    Entry entry;
+    entry.mType = type;
+    entry.mOffset = offset;
+    entry.mId = id;
+
+    mLookup[std::make_pair (type, Misc::StringUtils::lowerCase (id))] = mEntries.size();
+    mEntries.push_back (entry);
+}
+
+void ESM::RecordIndex::clear()
+{
+    mEntries.clear();
+    mLookup.clear();
+}
+
+const ESM::RecordIndex::Entry *ESM::RecordIndex::search (int type, const std::string& id) const
+{
+    std::map<std::pair<int, std::string>, size_t>::const_iterator iter =
+        mLookup.find (std::make_pair (type, Misc::StringUtils::lowerCase (id)));
+
+    if (iter==mLookup.end())
+        return 0;
+
+    return &mEntries[iter->second];
+}
+
+const std::vector<ESM::RecordIndex::Entry>& ESM::RecordIndex::getEntries() const
+{
+    return mEntries;
+}
+
+void ESM::RecordIndex::save (ESMWriter& esm) const
+{
+    for (std::vector<Entry>::const_iterator iter (mEntries.begin()); iter!=mEntries.end(); ++iter)
+    {
+        int data[2] = { iter->mType, static_cast<int> (iter->mOffset) };
+        esm.writeHNT ("INDX", data);
+        esm.writeHNCString ("NAME", iter->mId);
+    }
+}
+
+void ESM::RecordIndex::load (ESMReader& esm)
+{
+    clear();
+
+    while (esm.isNextSub ("INDX"))
+    {
+        int data[2];
+        esm.getHT (data);
+        add (data[0], static_cast<unsigned int> (data[1]), esm.getHNString ("NAME"));
+    }
+}
+
+std::string ESM::RecordIndex::readId (ESMReader& esm, int type)
+{
+    switch (type)
+    {
+        case REC_LAND:
+        {
+            int grid[2];
+            esm.getHNT (grid, "INTV");
+            return getGridId (grid[0], grid[1]);
+        }
+
+        case REC_PGRD:
+        {
+            // Interior path grids have no position
+            Pathgrid::DATAstruct data;
+            esm.getHNT (data, "DATA", 12);
+            std::string name = esm.getHNString ("NAME");
+            return data.mX==0 && data.mY==0 ? name : getGridId (data.mX, data.mY);
+        }
+
+        case REC_CELL:
+        {
+            std::string name = esm.getHNString ("NAME");
+
+            if (esm.isNextSub ("DELE"))
+                esm.skipHSub();
+
+            Cell::DATAstruct data;
+            esm.getHNT (data, "DATA", 12);
+            return data.mFlags & Cell::Interior ? name : getGridId (data.mX, data.mY);
+        }
+
+        case REC_INFO:
+
+            return esm.getHNOString ("INAM");
+
+        default:
+
+            return esm.getHNOString ("NAME");
+    }
+}
+
+std::string ESM::RecordIndex::getGridId (int x, int y)
+{
+    std::ostringstream stream;
+    stream << "#" << x << " " << y;
+    return stream.str();
+}
+
+bool ESM::RecordIndex::getGrid (const std::string& id, int& x, int& y)
+{
+    if (id.empty() || id[0]!='#')
+        return false;
+
+    std::istringstream stream (id.substr (1));
+    return (stream >> x >> y) && stream.eof();
+}
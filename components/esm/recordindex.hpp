@@ -0,0 +1,69 @@
+#ifndef OPENMW_ESM_RECORDINDEX_H
+#define OPENMW_ESM_RECORDINDEX_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ESM
+{
+    class ESMReader;
+    class ESMWriter;
+
+    /// \brief Offsets of the records of a content file, by record type and id
+    ///
+    /// Lets records be loaded when they are first needed, without reading the file up to them.
+    /// Records are keyed by their NAME sub-record (INAM for dialogue infos). Land, path grids and
+    /// exterior cells are keyed by their grid position instead (see getGridId).
+    class RecordIndex
+    {
+        public:
+
+            struct Entry
+            {
+                int mType;
+                size_t mOffset; ///< start of the record in the file
+                std::string mId;
+            };
+
+            void build (ESMReader& esm, const std::set<int>& types);
+            ///< Index the records of the given \a types in \a esm, from the current position to the
+            /// end of the file.
+
+            void add (int type, size_t offset, const std::string& id);
+            ///< Add a record, after those already in the index.
+
+            void clear();
+
+            const Entry *search (int type, const std::string& id) const;
+            ///< Last record of type \a type with id \a id (case-insensitive), or 0.
+
+            const std::vector<Entry>& getEntries() const;
+            ///< All records, in file order
+
+            void save (ESMWriter& esm) const;
+            ///< Write the index as sub-records of the current record.
+
+            void load (ESMReader& esm);
+            ///< Read an index written by save(), up to the end of the current record.
+
+            static std::string readId (ESMReader& esm, int type);
+            ///< Read the id of a record of type \a type, whose name and header have just been read.
+            /// Leaves \a esm inside the record.
+
+            static std::string getGridId (int x, int y);
+            ///< Id of a record at grid position \a x, \a y ("#x y")
+
+            static bool getGrid (const std::string& id, int& x, int& y);
+            ///< Get the grid position from an id returned by getGridId. Returns false for other ids.
+
+        private:
+
+            std::vector<Entry> mEntries;
+            std::map<std::pair<int, std::string>, size_t> mLookup;
+    };
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "savedelta.hpp"
+
+#include "esmreader.hpp"
+#include "esmwriter.hpp"
+#include "defs.hpp"
+
+unsigned int ESM::SaveDelta::sRecordId = ESM::REC_DELT;
+
+namespace
+{
+    void loadKeys (ESM::ESMReader& esm, const char *name, std::vector<uint64_t>& keys)
+    {
+        esm.getSubNameIs (name);
+        esm.getSubHeader();
+
+        if (esm.getSubSize() % sizeof (uint64_t))
+            esm.fail ("Invalid record keys");
+
+        keys.resize (esm.getSubSize() / sizeof (uint64_t));
+
+        if (!keys.empty())
+            esm.getExact (&keys[0], keys.size() * sizeof (uint64_t));
+    }
+
+    void saveKeys (ESM::ESMWriter& esm, const std::string& name, const std::vector<uint64_t>& keys)
+    {
+        esm.startSubRecord (name);
+
+        if (!keys.empty())
+            esm.write (reinterpret_cast<const char *> (&keys[0]), keys.size() * sizeof (uint64_t));
+
+        esm.endRecord (name);
+    }
+}
+
+void ESM::SaveDelta::load (ESMReader &esm)
+{
+    mBase = esm.getHNString ("BASE");
+    esm.getHNT (mBaseHash, "BHSH");
+    esm.getHNT (mDepth, "DPTH");
+
+    loadKeys (esm, "KEYS", mKeys);
+    loadKeys (esm, "STOR", mStored);
+}
+
+void ESM::SaveDelta::save (ESMWriter &esm) const
+{
+    esm.writeHNString ("BASE", mBase);
+    esm.writeHNT ("BHSH", mBaseHash);
+    esm.writeHNT ("DPTH", mDepth);
+
+    saveKeys (esm, "KEYS", mKeys);
+    saveKeys (esm, "STOR", mStored);
+}
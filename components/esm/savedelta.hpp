@@ -0,0 +1,36 @@
+#ifndef OPENMW_ESM_SAVEDELTA_H
+#define OPENMW_ESM_SAVEDELTA_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace ESM
+{
+    class ESMReader;
+    class ESMWriter;
+
+    // format 0, saved games only
+
+    /// \brief Marks a saved game that only holds the records that changed since another one
+    ///
+    /// Follows the SAVE record. The records after it replace the records of the base saved game
+    /// with the same keys; mKeys gives the order of all records of the complete saved game.
+    /// Keys are assigned by the game, see MWState::SaveTable.
+    struct SaveDelta
+    {
+        static unsigned int sRecordId;
+
+        std::string mBase; ///< file name of the base saved game
+        uint64_t mBaseHash; ///< of the keys and contents of the records of the base
+        int mDepth; ///< number of deltas from the last complete saved game, including this one
+        std::vector<uint64_t> mKeys; ///< of all records
+        std::vector<uint64_t> mStored; ///< of the records after this one, in order
+
+        void load (ESMReader &esm);
+        void save (ESMWriter &esm) const;
+    };
+}
+
+#endif
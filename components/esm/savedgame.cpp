@@ -7,7 +7,7 @@
 
 unsigned int ESM::SavedGame::sRecordId = ESM::REC_SAVE;
 
-void ESM::SavedGame::load (ESMReader &esm)
+void ESM::SavedGame::load (ESMReader &esm, bool screenshot)
 {
     mPlayerName = esm.getHNString("PLNA");
     esm.getHNOT (mPlayerLevel, "PLLE");
@@ -23,13 +23,24 @@ void ESM::SavedGame::load (ESMReader &esm)
     while (esm.isNextSub ("DEPE"))
         mContentFiles.push_back (esm.getHString());
 
+    if (!screenshot)
+    {
+        mScreenshot.clear();
+
+        if (esm.isNextSub ("SCRN"))
+            esm.skipHSub();
+
+        return;
+    }
+
     esm.getSubNameIs("SCRN");
     esm.getSubHeader();
     mScreenshot.resize(esm.getSubSize());
-    esm.getExact(&mScreenshot[0], mScreenshot.size());
+    if (!mScreenshot.empty())
+        esm.getExact(&mScreenshot[0], mScreenshot.size());
 }
 
-void ESM::SavedGame::save (ESMWriter &esm) const
+void ESM::SavedGame::save (ESMWriter &esm, bool screenshot) const
 {
     esm.writeHNString ("PLNA", mPlayerName);
     esm.writeHNT ("PLLE", mPlayerLevel);
@@ -48,7 +59,11 @@ void ESM::SavedGame::save (ESMWriter &esm) const
          iter!=mContentFiles.end(); ++iter)
          esm.writeHNString ("DEPE", *iter);
 
+    if (!screenshot)
+        return;
+
     esm.startSubRecord("SCRN");
-    esm.write(&mScreenshot[0], mScreenshot.size());
+    if (!mScreenshot.empty())
+        esm.write(&mScreenshot[0], mScreenshot.size());
     esm.endRecord("SCRN");
 }
@@ -39,8 +39,12 @@ namespace ESM
         std::string mDescription;
         std::vector<char> mScreenshot; // raw jpg-encoded data
 
-        void load (ESMReader &esm);
-        void save (ESMWriter &esm) const;
+        void load (ESMReader &esm, bool screenshot = true);
+        ///< \param screenshot Read the screenshot; skip it (if there is one) otherwise.
+
+        void save (ESMWriter &esm, bool screenshot = true) const;
+        ///< \param screenshot Write the screenshot. A profile written without one can only be
+        /// loaded with \a screenshot false.
     };
 }
 
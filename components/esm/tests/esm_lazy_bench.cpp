@@ -0,0 +1,204 @@
+#include "../esmreader.hpp"
+#include "../esmwriter.hpp"
+#include "../recordindex.hpp"
+#include "../loadland.hpp"
+#include "../loadpgrd.hpp"
+#include "../defs.hpp"
+
+/*
+  Benchmark of lazy land and path grid loading
+
+  Loads the land and path grid records of the given content files three
+  ways, each in its own process:
+
+    eager:  every record read in full as the file is walked, like the
+            record stores did before they loaded these records lazily
+    scan:   only the offsets and ids of the records, found by walking the
+            file (a load without the content cache)
+    index:  only the offsets and ids, read from a persisted index (a load
+            with the content cache)
+
+  and reports the time taken and the resident memory afterwards, which
+  includes the pages of the memory mapped content files that were touched.
+  Drop the page cache between runs to see cold start times.
+
+  Usage: esm_lazy_bench file... (defaults to data/Morrowind.esm in the root
+  directory of OpenMW)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <set>
+#include <string>
+#include <cstdlib>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+using namespace ESM;
+
+const char *indexFile = "esm_lazy_bench.idx";
+
+set<int> lazyTypes()
+{
+  set<int> types;
+  types.insert(REC_LAND);
+  types.insert(REC_PGRD);
+  return types;
+}
+
+long residentKiB()
+{
+  ifstream status("/proc/self/status");
+  string line;
+  while(getline(status, line))
+    if(line.compare(0, 6, "VmRSS:") == 0)
+      return atol(line.c_str() + 6);
+  return 0;
+}
+
+size_t eager(const vector<string> &files, vector<ESMReader> &readers)
+{
+  vector<Land*> lands;
+  vector<Pathgrid> pathgrids;
+
+  for(size_t i=0; i<files.size(); i++)
+    {
+      ESMReader &esm = readers[i];
+      esm.open(files[i]);
+
+      while(esm.hasMoreRecs())
+        {
+          NAME n = esm.getRecName();
+          esm.getRecHeader();
+
+          if(n.val == REC_LAND)
+            {
+              lands.push_back(new Land);
+              lands.back()->load(esm);
+            }
+          else if(n.val == REC_PGRD)
+            {
+              pathgrids.push_back(Pathgrid());
+              pathgrids.back().load(esm);
+            }
+          esm.skipRecord();
+        }
+    }
+
+  // Leaked on purpose, the process ends right after measuring
+  return lands.size() + pathgrids.size();
+}
+
+size_t scan(const vector<string> &files, vector<ESMReader> &readers)
+{
+  size_t records = 0;
+
+  for(size_t i=0; i<files.size(); i++)
+    {
+      ESMReader &esm = readers[i];
+      esm.open(files[i]);
+
+      RecordIndex *index = new RecordIndex;
+      index->build(esm, lazyTypes());
+      records += index->getEntries().size();
+    }
+
+  return records;
+}
+
+size_t readIndex(const vector<string> &files, vector<ESMReader> &readers)
+{
+  size_t records = 0;
+
+  ESMReader esm;
+  esm.open(indexFile);
+
+  for(size_t i=0; i<files.size(); i++)
+    {
+      // Content files are still opened, lazy records are read through them
+      readers[i].open(files[i]);
+
+      esm.getRecName();
+      esm.getRecHeader();
+
+      RecordIndex *index = new RecordIndex;
+      index->load(esm);
+      records += index->getEntries().size();
+    }
+
+  return records;
+}
+
+void writeIndex(const vector<string> &files)
+{
+  ofstream stream(indexFile, ios::binary);
+
+  ESMWriter writer;
+  writer.setVersion();
+  writer.setFormat(0);
+  writer.save(stream);
+
+  for(size_t i=0; i<files.size(); i++)
+    {
+      ESMReader esm;
+      esm.open(files[i]);
+
+      RecordIndex index;
+      index.build(esm, lazyTypes());
+
+      writer.startRecord("RIDX");
+      index.save(writer);
+      writer.endRecord("RIDX");
+    }
+
+  writer.close();
+}
+
+void run(const char *name, size_t (*load)(const vector<string>&, vector<ESMReader>&),
+         const vector<string> &files)
+{
+  cout.flush();
+
+  pid_t child = fork();
+  if(child != 0)
+    {
+      waitpid(child, NULL, 0);
+      return;
+    }
+
+  long before = residentKiB();
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+  vector<ESMReader> readers(files.size());
+  size_t records = load(files, readers);
+
+  double secs = (boost::posix_time::microsec_clock::universal_time() - start)
+    .total_microseconds() / 1000000.0;
+
+  cout << setw(6) << name << ": " << records << " land and path grid records in "
+       << fixed << setprecision(3) << secs << "s, resident memory +" << (residentKiB() - before) << " KiB" << endl;
+
+  _exit(0);
+}
+
+int main(int argc, char **argv)
+{
+  vector<string> files(argv + 1, argv + argc);
+  if(files.empty())
+    files.push_back("../../../data/Morrowind.esm");
+
+  writeIndex(files);
+
+  run("eager", eager, files);
+  run("scan", scan, files);
+  run("index", readIndex, files);
+
+  unlink(indexFile);
+}
@@ -0,0 +1,201 @@
+#include "../esmreader.hpp"
+#include "../esmwriter.hpp"
+
+/*
+  Benchmark of compressed saved games
+
+  Writes a generated saved game twice, uncompressed and compressed, the
+  way MWState::SaveWriter writes it: the TES3 header, a SAVE record with
+  an incompressible screenshot, then cell states holding object states
+  (reference ids, positions and local script variables). Reports the file
+  size, the time taken to write the file, to read the header and the SAVE
+  record (as the save list does) and to read every record (as loading the
+  game does). Run it twice to compare with a warm page cache.
+
+  Usage: save_bench [cells] (defaults to 2000, about 25 MiB uncompressed)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+using namespace ESM;
+
+const int objectsPerCell = 150;
+const int readRounds = 5;
+
+double elapsed(const boost::posix_time::ptime &start)
+{
+  return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000000.0;
+}
+
+boost::posix_time::ptime now()
+{
+  return boost::posix_time::microsec_clock::universal_time();
+}
+
+string makeId(int i)
+{
+  static const char *prefixes[] = { "furn_com_", "flora_", "ex_vivec_", "in_hlaalu_", "light_de_" };
+  ostringstream id;
+  id << prefixes[i % 5] << "object_" << i % 400;
+  return id.str();
+}
+
+void writeSave(const char *name, int cells, bool compressed)
+{
+  ofstream stream(name, ios::binary);
+
+  ESMWriter writer;
+  writer.setVersion();
+  writer.setFormat(0);
+  writer.setCompressed(compressed);
+  writer.addMaster("Morrowind.esm", 0);
+  writer.save(stream);
+
+  srand(1);
+
+  // Stands in for the JPEG screenshot, which does not compress
+  string screenshot(40000, 0);
+  for(size_t i=0; i<screenshot.size(); i++)
+    screenshot[i] = static_cast<char>(rand());
+
+  writer.startRecord("SAVE");
+  writer.writeHNString("PLNA", "Nerevar");
+  writer.writeHNString("PLCE", "Balmora, Council Club");
+  writer.startSubRecord("SCRN");
+  writer.write(screenshot.data(), screenshot.size());
+  writer.endRecord("SCRN");
+  writer.endRecord("SAVE");
+
+  writer.flush();
+
+  for(int cell=0; cell<cells; cell++)
+    {
+      ostringstream cellId;
+      cellId << "Generated Cell " << cell;
+
+      writer.startRecord("CSTA");
+      writer.writeHNString("NAME", cellId.str());
+      writer.writeHNT("WLAT", 0.f);
+      writer.endRecord("CSTA");
+
+      for(int i=0; i<objectsPerCell; i++)
+        {
+          int object = cell * objectsPerCell + i;
+          float pos[6];
+          for(int j=0; j<6; j++)
+            pos[j] = (rand() % 100000) / 10.f;
+
+          writer.startRecord("ACTI");
+          writer.writeHNT("FRMR", object);
+          writer.writeHNString("NAME", makeId(object));
+          writer.writeHNT("DATA", pos);
+          if(i % 4 == 0)
+            {
+              writer.writeHNString("LOCA", "companion");
+              writer.writeHNT("SHOR", static_cast<short>(rand() % 3));
+            }
+          writer.writeHNT("ENAB", 1);
+          writer.endRecord("ACTI");
+        }
+    }
+
+  writer.close();
+}
+
+/// Read the SAVE record, like MWState::Character does for the save list
+void readHeader(const char *name)
+{
+  ESMReader esm;
+  esm.open(name);
+
+  if(esm.getRecName() != "SAVE")
+    throw runtime_error("SAVE record missing");
+
+  esm.getRecHeader();
+  esm.getHNString("PLNA");
+  esm.getHNString("PLCE");
+  esm.getSubNameIs("SCRN");
+  esm.getSubHeader();
+  esm.getString(esm.getSubSize());
+}
+
+size_t readAll(const char *name)
+{
+  ESMReader esm;
+  esm.open(name);
+
+  size_t records = 0;
+  char buffer[256];
+
+  while(esm.hasMoreRecs())
+    {
+      esm.getRecName();
+      esm.getRecHeader();
+      ++records;
+
+      while(esm.hasMoreSubs())
+        {
+          esm.getSubName();
+          esm.getSubHeader();
+
+          size_t size = esm.getSubSize();
+          if(size <= sizeof(buffer))
+            esm.getExact(buffer, size);
+          else
+            esm.getString(size);
+        }
+    }
+
+  return records;
+}
+
+void bench(int cells, bool compressed)
+{
+  const char *name = compressed ? "save_bench_compressed.out" : "save_bench.out";
+
+  boost::posix_time::ptime start = now();
+  writeSave(name, cells, compressed);
+  double write = elapsed(start);
+
+  size_t size = 0;
+  {
+    ifstream file(name, ios::binary | ios::ate);
+    size = file.tellg();
+  }
+
+  start = now();
+  for(int i=0; i<readRounds; i++)
+    readHeader(name);
+  double header = elapsed(start) / readRounds;
+
+  size_t records = 0;
+  start = now();
+  for(int i=0; i<readRounds; i++)
+    records = readAll(name);
+  double load = elapsed(start) / readRounds;
+
+  cout << setw(12) << (compressed ? "compressed:" : "plain:") << " "
+       << records << " records, " << size / 1024 << " KiB, write "
+       << fixed << setprecision(3) << write << "s, header "
+       << setprecision(5) << header << "s, load " << setprecision(3) << load << "s" << endl;
+
+  remove(name);
+}
+
+int main(int argc, char **argv)
+{
+  int cells = argc > 1 ? atoi(argv[1]) : 2000;
+
+  bench(cells, false);
+  bench(cells, true);
+}
@@ -16,8 +16,10 @@ public:
 
     ConstrainedDataStream(const Ogre::String &fname, size_t start, size_t length)
 	{
-		mFile.open (fname.c_str ());
-		mSize  = length != 0xFFFFFFFF ? length : mFile.size () - start;
+		// Streams over the same file share one handle and read with explicit
+		// offsets, so there is no seek state to keep in sync.
+		mFile = openSharedLowLevelFile (fname.c_str ());
+		mSize  = length != 0xFFFFFFFF ? length : mFile->size () - start;
 
 		mPos    = 0;
 		mOrigin = start;
@@ -50,12 +52,7 @@ public:
 			{
 				if (readLeft >= sBufferThreshold || (posCur == mOrigin && posEnd == mExtent))
 				{
-					assert (mFile.tell () == mBufferExtent);
-
-					if (posCur != mBufferExtent)
-						mFile.seek (posCur);
-
-					posCur += mFile.read (out, readLeft);
+					posCur += mFile->readAt (out, readLeft, posCur);
 
 					mBufferOrigin = mBufferExtent = posCur;
 
@@ -122,30 +119,23 @@ public:
 
     virtual void close()
     {
-		mFile.close();
+		mFile.reset();
 	}
 
 private:
 
 	void fill (size_t newOrigin)
 	{
-		assert (mFile.tell () == mBufferExtent);
-
 		size_t newExtent = newOrigin + sBufferSize;
 
 		if (newExtent > mExtent)
 			newExtent = mExtent;
 
-		size_t oldExtent = mBufferExtent;
-
-		if (newOrigin != oldExtent)
-			mFile.seek (newOrigin);
-
 		mBufferOrigin = mBufferExtent = newOrigin;
 
 		size_t amountRequested = newExtent - newOrigin;
 
-		size_t amountRead = mFile.read (mBuffer, amountRequested);
+		size_t amountRead = mFile->readAt (mBuffer, amountRequested, newOrigin);
 
 		if (amountRead != amountRequested)
 			throw std::runtime_error ("An unexpected condition occurred while reading from a file.");
@@ -153,7 +143,7 @@ private:
 		mBufferExtent = newExtent;
 	}
 
-	LowLevelFile mFile;
+	LowLevelFilePtr mFile;
 
 	size_t mOrigin;
 	size_t mExtent;
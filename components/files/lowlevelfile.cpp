@@ -3,9 +3,17 @@
 #include <stdexcept>
 #include <sstream>
 #include <cassert>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 #if FILE_API == FILE_API_POSIX
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #endif
@@ -55,6 +63,8 @@ size_t LowLevelFile::size ()
 {
 	assert (mHandle != NULL);
 
+	boost::mutex::scoped_lock lock (mMutex);
+
 	long oldPosition = ftell (mHandle);
 
 	if (oldPosition == -1)
@@ -106,6 +116,23 @@ size_t LowLevelFile::read (void * data, size_t size)
 	return amount;
 }
 
+size_t LowLevelFile::readAt (void * data, size_t size, size_t position)
+{
+	assert (mHandle != NULL);
+
+	// stdio has no positional reads, so serialise seek + read
+	boost::mutex::scoped_lock lock (mMutex);
+
+	seek (position);
+
+	return read (data, size);
+}
+
+void LowLevelFile::prefetch (size_t position, size_t size)
+{
+	// no read-ahead hints with stdio
+}
+
 #elif FILE_API == FILE_API_POSIX
 /*
  *
@@ -205,6 +232,62 @@ size_t LowLevelFile::read (void * data, size_t size)
 	return amount;
 }
 
+size_t LowLevelFile::readAt (void * data, size_t size, size_t position)
+{
+	assert (mHandle != -1);
+
+	size_t total = 0;
+
+	// pread may return less than requested (e.g. when interrupted by a signal)
+	while (total < size)
+	{
+		ssize_t amount = ::pread (mHandle, static_cast<char *> (data) + total, size - total, position + total);
+
+		if (amount == -1)
+			throw std::runtime_error ("A read operation on a file failed.");
+
+		if (amount == 0)
+			break;
+
+		total += amount;
+	}
+
+	return total;
+}
+
+void LowLevelFile::prefetch (size_t position, size_t size)
+{
+	assert (mHandle != -1);
+
+#ifdef POSIX_FADV_WILLNEED
+	::posix_fadvise (mHandle, position, size, POSIX_FADV_WILLNEED);
+#endif
+}
+
+bool LowLevelFile::getFileId (FileId & id)
+{
+	assert (mHandle != -1);
+
+	struct stat info;
+
+	if (::fstat (mHandle, &info) == -1)
+		return false;
+
+	id = FileId (info.st_dev, info.st_ino);
+	return true;
+}
+
+bool LowLevelFile::getFileId (char const * filename, FileId & id)
+{
+	struct stat info;
+
+	if (::stat (filename, &info) == -1)
+		return false;
+
+	id = FileId (info.st_dev, info.st_ino);
+	return true;
+}
+
 #elif FILE_API == FILE_API_WIN32
 /*
  *
@@ -227,9 +310,12 @@ void LowLevelFile::open (char const * filename)
 {
 	assert (mHandle == INVALID_HANDLE_VALUE);
 
-	HANDLE handle = CreateFileA (filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	// FILE_SHARE_DELETE lets other programs (and the game itself) replace a file
+	// while it is open here
+	HANDLE handle = CreateFileA (filename, GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_DELETE, 0, OPEN_EXISTING, 0, 0);
 
-	if (handle == NULL)
+	if (handle == INVALID_HANDLE_VALUE)
 	{
 		std::ostringstream os;
 		os << "Failed to open '" << filename << "' for reading.";
@@ -296,4 +382,171 @@ size_t LowLevelFile::read (void * data, size_t size)
 	return read;
 }
 
+size_t LowLevelFile::readAt (void * data, size_t size, size_t position)
+{
+	assert (mHandle != INVALID_HANDLE_VALUE);
+
+	// With an OVERLAPPED offset ReadFile reads from that position; the file
+	// pointer it leaves behind is never relied upon by shared users.
+	OVERLAPPED overlapped;
+	memset (&overlapped, 0, sizeof (overlapped));
+	overlapped.Offset = static_cast<DWORD> (position);
+	overlapped.OffsetHigh = static_cast<DWORD> (static_cast<unsigned long long> (position) >> 32);
+
+	DWORD read;
+
+	if (!ReadFile (mHandle, data, size, &read, &overlapped))
+		if (GetLastError () != ERROR_HANDLE_EOF)
+			throw std::runtime_error ("A read operation on a file failed.");
+
+	return read;
+}
+
+void LowLevelFile::prefetch (size_t position, size_t size)
+{
+	// no read-ahead hints for file handles on Win32
+}
+
+namespace
+{
+	bool getHandleFileId (HANDLE handle, LowLevelFile::FileId & id)
+	{
+		BY_HANDLE_FILE_INFORMATION info;
+
+		if (!GetFileInformationByHandle (handle, &info))
+			return false;
+
+		id = LowLevelFile::FileId (info.dwVolumeSerialNumber,
+			(static_cast<boost::uint64_t> (info.nFileIndexHigh) << 32) | info.nFileIndexLow);
+		return true;
+	}
+}
+
+bool LowLevelFile::getFileId (FileId & id)
+{
+	assert (mHandle != INVALID_HANDLE_VALUE);
+
+	return getHandleFileId (mHandle, id);
+}
+
+bool LowLevelFile::getFileId (char const * filename, FileId & id)
+{
+	// Opening without any access rights is enough to query the file index
+	HANDLE file = CreateFileA (filename, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		0, OPEN_EXISTING, 0, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	bool found = getHandleFileId (file, id);
+
+	CloseHandle (file);
+
+	return found;
+}
+
+#endif
+
+/*
+ *
+ *	Pool of shared handles
+ *
+ */
+
+#if FILE_API == FILE_API_STDIO
+
+LowLevelFilePtr openSharedLowLevelFile (char const * filename)
+{
+	LowLevelFilePtr file (new LowLevelFile);
+	file->open (filename);
+	return file;
+}
+
+#else
+
+namespace
+{
+	struct PooledFile
+	{
+		boost::weak_ptr<LowLevelFile> mFile;
+		LowLevelFile::FileId mId; ///< of mFile, taken when it was opened
+	};
+
+	typedef std::map<std::string, PooledFile> HandlePool;
+
+	HandlePool sHandlePool;
+	boost::mutex sHandlePoolMutex;
+
+	/// Closes the handle and drops it from the pool once the last user is gone
+	struct PooledFileDeleter
+	{
+		std::string mFilename;
+
+		void operator() (LowLevelFile * file) const
+		{
+			{
+				boost::mutex::scoped_lock lock (sHandlePoolMutex);
+
+				HandlePool::iterator iter = sHandlePool.find (mFilename);
+
+				// The path may have been reopened (and re-pooled) in the meantime
+				if (iter != sHandlePool.end () && iter->second.mFile.expired ())
+					sHandlePool.erase (iter);
+			}
+
+			delete file;
+		}
+	};
+}
+
+LowLevelFilePtr openSharedLowLevelFile (char const * filename)
+{
+	// The pool is keyed by path; a handle of a file that has been replaced since stays
+	// with its current users, but is not handed out again. Checked before locking the
+	// pool, so concurrent opens do not wait for the file system.
+	LowLevelFile::FileId id;
+	bool exists = LowLevelFile::getFileId (filename, id);
+
+	// Released after the lock, its deleter takes the lock as well
+	LowLevelFilePtr replaced;
+
+	boost::mutex::scoped_lock lock (sHandlePoolMutex);
+
+	PooledFile & pooled = sHandlePool[filename];
+
+	LowLevelFilePtr file = pooled.mFile.lock ();
+
+	if (file && (!exists || pooled.mId != id))
+		replaced.swap (file);
+
+	if (!file)
+	{
+		LowLevelFile * newFile = new LowLevelFile;
+		LowLevelFile::FileId newId;
+
+		try
+		{
+			newFile->open (filename);
+
+			if (!newFile->getFileId (newId))
+				throw std::runtime_error ("A query operation on a file failed.");
+		}
+		catch (...)
+		{
+			delete newFile;
+			sHandlePool.erase (filename);
+			throw;
+		}
+
+		PooledFileDeleter deleter;
+		deleter.mFilename = filename;
+
+		file = LowLevelFilePtr (newFile, deleter);
+		pooled.mFile = file;
+		pooled.mId = newId;
+	}
+
+	return file;
+}
+
 #endif
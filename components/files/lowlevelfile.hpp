@@ -4,6 +4,11 @@
 #include <OgrePlatform.h>
 
 #include <cstdlib>
+#include <utility>
+
+#include <boost/cstdint.hpp>
+
+#include <boost/shared_ptr.hpp>
 
 #define FILE_API_STDIO	0
 #define FILE_API_POSIX	1
@@ -19,6 +24,7 @@
 
 #if FILE_API == FILE_API_STDIO
 #include <cstdio>
+#include <boost/thread/mutex.hpp>
 #elif FILE_API == FILE_API_POSIX
 #elif FILE_API == FILE_API_WIN32
 #include <windows.h>
@@ -43,9 +49,31 @@ public:
 
 	size_t read (void * data, size_t size);
 
+	/// Read \a size bytes starting at \a position, without using or changing the
+	/// file position. Safe to call from several threads at once.
+	size_t readAt (void * data, size_t size, size_t position);
+
+	/// Hint that \a size bytes starting at \a position will be read soon, so the
+	/// operating system can start reading them into its cache. Does not block.
+	void prefetch (size_t position, size_t size);
+
+#if FILE_API != FILE_API_STDIO
+	/// Identifies a file independent of its path (device and inode, or volume and
+	/// file index on Win32). Not available with stdio.
+	typedef std::pair<boost::uint64_t, boost::uint64_t> FileId;
+
+	/// Identity of the open file
+	bool getFileId (FileId & id);
+
+	/// Identity of the file currently found at \a filename
+	/// \return False if there is none
+	static bool getFileId (char const * filename, FileId & id);
+#endif
+
 private:
 #if FILE_API == FILE_API_STDIO
 	FILE* mHandle;
+	boost::mutex mMutex;
 #elif FILE_API == FILE_API_POSIX
 	int mHandle;
 #elif FILE_API == FILE_API_WIN32
@@ -53,4 +81,15 @@ private:
 #endif
 };
 
+typedef boost::shared_ptr<LowLevelFile> LowLevelFilePtr;
+
+/// Open \a filename for reading. All callers that have the same file open at the
+/// same time share one handle, which is closed when the last of them releases it;
+/// a file replaced at the same path gets a handle of its own. Use readAt on shared
+/// handles, their file position belongs to nobody.
+///
+/// With stdio every call opens a handle of its own, since replaced files can not be
+/// told apart.
+LowLevelFilePtr openSharedLowLevelFile (char const * filename);
+
 #endif
@@ -0,0 +1,37 @@
+#include "mappedfiledatastream.hpp"
+
+#include <stdexcept>
+
+namespace {
+
+// A MemoryDataStream over a window of the mapping. Reads are a single memcpy
+// from the mapped pages into the caller's buffer, and users that know about
+// MemoryDataStream can access the bytes in place through getPtr().
+class MappedDataStream : public Ogre::MemoryDataStream {
+public:
+
+	MappedDataStream (MemoryMappedFilePtr const & file, size_t start, size_t length)
+	  : Ogre::MemoryDataStream (const_cast <char *> (file->data ()) + start, length, false, true)
+	  , mFile (file)
+	{
+	}
+
+private:
+
+	MemoryMappedFilePtr mFile;
+};
+
+} // end of unnamed namespace
+
+Ogre::DataStreamPtr openMappedFileDataStream (MemoryMappedFilePtr const & file, size_t offset, size_t length)
+{
+	if (offset > file->size ())
+		throw std::runtime_error ("Mapped file stream starts past the end of the file.");
+
+	if (length == 0xFFFFFFFF)
+		length = file->size () - offset;
+	else if (length > file->size () - offset)
+		throw std::runtime_error ("Mapped file stream extends past the end of the file.");
+
+	return Ogre::DataStreamPtr (new MappedDataStream (file, offset, length));
+}
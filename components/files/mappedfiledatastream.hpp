@@ -0,0 +1,11 @@
+#ifndef COMPONENTS_FILES_MAPPEDFILEDATASTREAM_HPP
+#define COMPONENTS_FILES_MAPPEDFILEDATASTREAM_HPP
+
+#include <OgreDataStream.h>
+
+#include "memorymappedfile.hpp"
+
+/// Open a stream reading straight out of \a file; the stream keeps the mapping alive.
+Ogre::DataStreamPtr openMappedFileDataStream (MemoryMappedFilePtr const & file, size_t offset = 0, size_t length = 0xFFFFFFFF);
+
+#endif // COMPONENTS_FILES_MAPPEDFILEDATASTREAM_HPP
@@ -0,0 +1,268 @@
+#include "memorymappedfile.hpp"
+
+#include <stdexcept>
+#include <sstream>
+#include <cassert>
+#include <algorithm>
+
+#if FILE_API == FILE_API_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+namespace
+{
+	void failOpen (char const * filename)
+	{
+		std::ostringstream os;
+		os << "Failed to map '" << filename << "' for reading.";
+		throw std::runtime_error (os.str ());
+	}
+}
+
+bool MemoryMappedFile::isOpen () const
+{
+	return mData != NULL;
+}
+
+size_t MemoryMappedFile::size () const
+{
+	return mSize;
+}
+
+const char * MemoryMappedFile::data () const
+{
+	assert (mData != NULL);
+
+	return mData;
+}
+
+#if FILE_API == FILE_API_POSIX
+void MemoryMappedFile::prefetch (size_t offset, size_t size) const
+{
+	assert (mData != NULL);
+
+	if (mSize == 0 || offset >= mSize)
+		return;
+
+	// madvise wants a page aligned start address
+	size_t pageSize = ::sysconf (_SC_PAGESIZE);
+	size_t start = offset - offset % pageSize;
+	size_t end = std::min (offset + size, mSize);
+
+	::madvise (const_cast<char *> (mData) + start, end - start, MADV_WILLNEED);
+}
+#else
+void MemoryMappedFile::prefetch (size_t offset, size_t size) const
+{
+	// already in memory (stdio), or no portable hint available (Win32)
+}
+#endif
+
+#if FILE_API == FILE_API_STDIO
+/*
+ *
+ *	Fallback implementation, reads the whole file into memory
+ *
+ */
+
+MemoryMappedFile::MemoryMappedFile ()
+  : mData (NULL), mSize (0)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile ()
+{
+	if (mData != NULL)
+		close ();
+}
+
+void MemoryMappedFile::open (char const * filename)
+{
+	assert (mData == NULL);
+
+	LowLevelFile file;
+	file.open (filename);
+
+	size_t size = file.size ();
+	char * buffer = new char [size > 0 ? size : 1];
+
+	if (file.read (buffer, size) != size)
+	{
+		delete [] buffer;
+		failOpen (filename);
+	}
+
+	mData = buffer;
+	mSize = size;
+}
+
+void MemoryMappedFile::close ()
+{
+	assert (mData != NULL);
+
+	delete [] mData;
+
+	mData = NULL;
+	mSize = 0;
+}
+
+#elif FILE_API == FILE_API_POSIX
+/*
+ *
+ *	Implementation of MemoryMappedFile methods using posix mmap
+ *
+ */
+
+MemoryMappedFile::MemoryMappedFile ()
+  : mData (NULL), mSize (0), mHandle (-1)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile ()
+{
+	if (mData != NULL)
+		close ();
+}
+
+void MemoryMappedFile::open (char const * filename)
+{
+	assert (mData == NULL);
+
+	mHandle = ::open (filename, O_RDONLY, 0);
+
+	if (mHandle == -1)
+		failOpen (filename);
+
+	struct stat info;
+
+	if (::fstat (mHandle, &info) == -1)
+	{
+		::close (mHandle);
+		mHandle = -1;
+		failOpen (filename);
+	}
+
+	mSize = info.st_size;
+
+	// mmap refuses zero length mappings; give empty files a dummy address
+	// so isOpen () still reports the file as open.
+	if (mSize == 0)
+	{
+		static const char empty = 0;
+		mData = &empty;
+		return;
+	}
+
+	void * address = ::mmap (NULL, mSize, PROT_READ, MAP_SHARED, mHandle, 0);
+
+	if (address == MAP_FAILED)
+	{
+		::close (mHandle);
+		mHandle = -1;
+		mSize = 0;
+		failOpen (filename);
+	}
+
+	mData = static_cast<const char *> (address);
+}
+
+void MemoryMappedFile::close ()
+{
+	assert (mData != NULL);
+
+	if (mSize > 0)
+		::munmap (const_cast<char *> (mData), mSize);
+
+	::close (mHandle);
+
+	mHandle = -1;
+	mData = NULL;
+	mSize = 0;
+}
+
+#elif FILE_API == FILE_API_WIN32
+/*
+ *
+ *	Implementation of MemoryMappedFile methods using Win32 file mappings
+ *
+ */
+
+MemoryMappedFile::MemoryMappedFile ()
+  : mData (NULL), mSize (0), mHandle (INVALID_HANDLE_VALUE), mMapping (NULL)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile ()
+{
+	if (mData != NULL)
+		close ();
+}
+
+void MemoryMappedFile::open (char const * filename)
+{
+	assert (mData == NULL);
+
+	mHandle = CreateFileA (filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+
+	if (mHandle == INVALID_HANDLE_VALUE)
+		failOpen (filename);
+
+	BY_HANDLE_FILE_INFORMATION info;
+
+	if (!GetFileInformationByHandle (mHandle, &info) || info.nFileSizeHigh != 0)
+	{
+		CloseHandle (mHandle);
+		mHandle = INVALID_HANDLE_VALUE;
+		failOpen (filename);
+	}
+
+	mSize = info.nFileSizeLow;
+
+	if (mSize == 0)
+	{
+		static const char empty = 0;
+		mData = &empty;
+		return;
+	}
+
+	mMapping = CreateFileMappingA (mHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	void * address = mMapping != NULL ? MapViewOfFile (mMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+	if (address == NULL)
+	{
+		if (mMapping != NULL)
+			CloseHandle (mMapping);
+		CloseHandle (mHandle);
+		mMapping = NULL;
+		mHandle = INVALID_HANDLE_VALUE;
+		mSize = 0;
+		failOpen (filename);
+	}
+
+	mData = static_cast<const char *> (address);
+}
+
+void MemoryMappedFile::close ()
+{
+	assert (mData != NULL);
+
+	if (mSize > 0)
+	{
+		UnmapViewOfFile (mData);
+		CloseHandle (mMapping);
+	}
+
+	CloseHandle (mHandle);
+
+	mMapping = NULL;
+	mHandle = INVALID_HANDLE_VALUE;
+	mData = NULL;
+	mSize = 0;
+}
+
+#endif
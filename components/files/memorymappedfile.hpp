@@ -0,0 +1,51 @@
+#ifndef COMPONENTS_FILES_MEMORYMAPPEDFILE_HPP
+#define COMPONENTS_FILES_MEMORYMAPPEDFILE_HPP
+
+#include "lowlevelfile.hpp"
+
+#include <boost/shared_ptr.hpp>
+
+/// \brief Read-only view of a whole file in memory
+///
+/// Uses the operating system's file mapping facilities where available, so
+/// pages are only brought in when touched and no copy is ever made. With
+/// the stdio file API the file is read into a heap buffer instead.
+class MemoryMappedFile
+{
+public:
+
+	MemoryMappedFile ();
+	~MemoryMappedFile ();
+
+	void open (char const * filename);
+	void close ();
+
+	bool isOpen () const;
+
+	size_t size () const;
+
+	const char * data () const;
+	///< Start of the mapping, valid until close () is called.
+
+	void prefetch (size_t offset, size_t size) const;
+	///< Hint that the given range will be accessed soon. Does not block.
+
+private:
+
+	MemoryMappedFile (const MemoryMappedFile&);
+	MemoryMappedFile& operator= (const MemoryMappedFile&);
+
+	const char * mData;
+	size_t mSize;
+
+#if FILE_API == FILE_API_POSIX
+	int mHandle;
+#elif FILE_API == FILE_API_WIN32
+	HANDLE mHandle;
+	HANDLE mMapping;
+#endif
+};
+
+typedef boost::shared_ptr<MemoryMappedFile> MemoryMappedFilePtr;
+
+#endif
@@ -0,0 +1,158 @@
+#include "allocations.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#if !defined(_WIN32)
+#define MISC_COUNT_ALLOCATIONS
+#endif
+
+namespace
+{
+    bool sEnabled = false;
+
+    std::size_t sCount = 0;
+    std::size_t sFrees = 0;
+    std::size_t sCurrent = 0;
+    std::size_t sPeak = 0;
+
+#ifdef MISC_COUNT_ALLOCATIONS
+    // Every block starts with its size (0 if it was allocated before counting was enabled),
+    // padded to keep the alignment malloc guarantees
+    const std::size_t sHeaderSize = 16;
+
+    void *allocate (std::size_t size)
+    {
+        char *block = static_cast<char *> (std::malloc (size + sHeaderSize));
+
+        if (!block)
+            return 0;
+
+        *reinterpret_cast<std::size_t *> (block) = sEnabled ? size : 0;
+
+        if (sEnabled)
+        {
+            ++sCount;
+            sCurrent += size;
+
+            if (sCurrent>sPeak)
+                sPeak = sCurrent;
+        }
+
+        return block + sHeaderSize;
+    }
+
+    void *allocateOrThrow (std::size_t size)
+    {
+        for (;;)
+        {
+            if (void *block = allocate (size))
+                return block;
+
+            std::new_handler handler = std::set_new_handler (0);
+            std::set_new_handler (handler);
+
+            if (!handler)
+                throw std::bad_alloc();
+
+            handler();
+        }
+    }
+
+    void release (void *ptr)
+    {
+        if (!ptr)
+            return;
+
+        char *block = static_cast<char *> (ptr) - sHeaderSize;
+
+        sCurrent -= *reinterpret_cast<std::size_t *> (block);
+
+        if (sEnabled)
+            ++sFrees;
+
+        std::free (block);
+    }
+#endif
+}
+
+bool Misc::Allocations::isSupported()
+{
+#ifdef MISC_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Misc::Allocations::enable()
+{
+    sEnabled = true;
+}
+
+std::size_t Misc::Allocations::getCount()
+{
+    return sCount;
+}
+
+std::size_t Misc::Allocations::getFrees()
+{
+    return sFrees;
+}
+
+std::size_t Misc::Allocations::getCurrent()
+{
+    return sCurrent;
+}
+
+std::size_t Misc::Allocations::getPeak()
+{
+    return sPeak;
+}
+
+void Misc::Allocations::resetPeak()
+{
+    sPeak = sCurrent;
+}
+
+#ifdef MISC_COUNT_ALLOCATIONS
+void *operator new (std::size_t size) throw (std::bad_alloc)
+{
+    return allocateOrThrow (size);
+}
+
+void *operator new[] (std::size_t size) throw (std::bad_alloc)
+{
+    return allocateOrThrow (size);
+}
+
+void *operator new (std::size_t size, const std::nothrow_t&) throw()
+{
+    return allocate (size);
+}
+
+void *operator new[] (std::size_t size, const std::nothrow_t&) throw()
+{
+    return allocate (size);
+}
+
+void operator delete (void *ptr) throw()
+{
+    release (ptr);
+}
+
+void operator delete[] (void *ptr) throw()
+{
+    release (ptr);
+}
+
+void operator delete (void *ptr, const std::nothrow_t&) throw()
+{
+    release (ptr);
+}
+
+void operator delete[] (void *ptr, const std::nothrow_t&) throw()
+{
+    release (ptr);
+}
+#endif
@@ -0,0 +1,42 @@
+#ifndef MISC_ALLOCATIONS_H
+#define MISC_ALLOCATIONS_H
+
+#include <cstddef>
+
+namespace Misc
+{
+    /// \brief Statistics of the heap allocations of a program
+    ///
+    /// Gathered by the global operator new and delete, which allocations.cpp replaces, once
+    /// enable() has been called. It is therefore not part of the components library; only tools
+    /// that want the statistics compile it in (esmtool, the NIF benchmark). The counters are not
+    /// synchronised, so those have to be single threaded.
+    ///
+    /// Not on Windows, where a DLL with a runtime of its own may free memory allocated by the
+    /// replaced operators, or the other way round; the counters stay at 0 there.
+    class Allocations
+    {
+    public:
+        static bool isSupported();
+        ///< Are allocations counted on this platform?
+
+        static void enable();
+        ///< Count the allocations from now on.
+
+        static std::size_t getCount();
+        ///< Number of allocations so far
+
+        static std::size_t getFrees();
+        ///< Number of blocks freed so far (including ones allocated before enable())
+
+        static std::size_t getCurrent();
+        ///< Bytes allocated and not freed yet
+
+        static std::size_t getPeak();
+        ///< Highest value of getCurrent() since the last call to resetPeak()
+
+        static void resetPeak();
+    };
+}
+
+#endif
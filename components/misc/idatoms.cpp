@@ -0,0 +1,145 @@
+#include "idatoms.hpp"
+
+#include <deque>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "stringops.hpp"
+
+namespace
+{
+    typedef Misc::IdAtoms::Atom Atom;
+
+    boost::mutex sMutex;
+
+    /// Lower case ids, by atom - 1. A deque, so that references survive new ids.
+    std::deque<std::string> sIds;
+
+    /// Open addressing table of atoms (sNone for free slots), kept at most half full
+    std::vector<Atom> sTable;
+
+    /// Copies of sIds and sTable made by freeze(), never changed afterwards, so they can be
+    /// read without the lock. Empty until then.
+    std::vector<const std::string *> sFrozenIds;
+    std::vector<Atom> sFrozenTable;
+
+    bool equal (const std::string& lower, const std::string& id)
+    {
+        if (lower.size()!=id.size())
+            return false;
+
+        for (size_t i=0; i<id.size(); ++i)
+            if (lower[i]!=Misc::StringUtils::toLowerAscii (id[i]))
+                return false;
+
+        return true;
+    }
+
+    /// Slot holding \a id, or the free slot it would go into
+    size_t findSlot (const std::string& id)
+    {
+        size_t mask = sTable.size()-1;
+        size_t slot = Misc::StringUtils::ciHash (id) & mask;
+
+        while (sTable[slot]!=Misc::IdAtoms::sNone && !equal (sIds[sTable[slot]-1], id))
+            slot = (slot+1) & mask;
+
+        return slot;
+    }
+
+    Atom searchFrozen (const std::string& id)
+    {
+        size_t mask = sFrozenTable.size()-1;
+        size_t slot = Misc::StringUtils::ciHash (id) & mask;
+
+        for (; sFrozenTable[slot]!=Misc::IdAtoms::sNone; slot = (slot+1) & mask)
+            if (equal (*sFrozenIds[sFrozenTable[slot]-1], id))
+                return sFrozenTable[slot];
+
+        return Misc::IdAtoms::sNone;
+    }
+
+    void grow()
+    {
+        std::vector<Atom> table (sTable.empty() ? 1024 : sTable.size()*2, Misc::IdAtoms::sNone);
+        sTable.swap (table);
+
+        for (std::vector<Atom>::const_iterator iter (table.begin()); iter!=table.end(); ++iter)
+            if (*iter!=Misc::IdAtoms::sNone)
+                sTable[findSlot (sIds[*iter-1])] = *iter;
+    }
+}
+
+const Misc::IdAtoms::Atom Misc::IdAtoms::sNone;
+
+Misc::IdAtoms::Atom Misc::IdAtoms::intern (const std::string& id)
+{
+    boost::mutex::scoped_lock lock (sMutex);
+
+    if ((sIds.size()+1)*2 > sTable.size())
+        grow();
+
+    size_t slot = findSlot (id);
+
+    if (sTable[slot]==sNone)
+    {
+        std::string lower (id);
+        for (std::string::iterator iter (lower.begin()); iter!=lower.end(); ++iter)
+            *iter = Misc::StringUtils::toLowerAscii (*iter);
+
+        sIds.push_back (lower);
+        sTable[slot] = sIds.size();
+    }
+
+    return sTable[slot];
+}
+
+Misc::IdAtoms::Atom Misc::IdAtoms::search (const std::string& id)
+{
+    if (!sFrozenTable.empty())
+    {
+        Atom atom = searchFrozen (id);
+
+        if (atom!=sNone)
+            return atom;
+    }
+
+    // Not frozen, or interned after freeze()
+    boost::mutex::scoped_lock lock (sMutex);
+
+    if (sTable.empty())
+        return sNone;
+
+    return sTable[findSlot (id)];
+}
+
+const std::string& Misc::IdAtoms::getId (Atom atom)
+{
+    if (atom>=1 && atom<=sFrozenIds.size())
+        return *sFrozenIds[atom-1];
+
+    boost::mutex::scoped_lock lock (sMutex);
+    return sIds.at (atom-1);
+}
+
+size_t Misc::IdAtoms::getSize()
+{
+    boost::mutex::scoped_lock lock (sMutex);
+    return sIds.size();
+}
+
+void Misc::IdAtoms::freeze()
+{
+    boost::mutex::scoped_lock lock (sMutex);
+
+    if (!sFrozenTable.empty() || sTable.empty())
+        return;
+
+    sFrozenIds.reserve (sIds.size());
+
+    for (std::deque<std::string>::const_iterator iter (sIds.begin()); iter!=sIds.end(); ++iter)
+        sFrozenIds.push_back (&*iter);
+
+    sFrozenTable = sTable;
+}
@@ -0,0 +1,47 @@
+#ifndef MISC_IDATOMS_H
+#define MISC_IDATOMS_H
+
+#include <string>
+
+namespace Misc
+{
+    /// \brief Process-wide table of case-insensitive record ids
+    ///
+    /// Gives every distinct id (ignoring case) a small integer, the atom, which stays the same for
+    /// the lifetime of the process. Resolving an id to its atom once lets later lookups compare
+    /// integers instead of lowercasing and comparing strings.
+    ///
+    /// All functions are safe to call from several threads. Until freeze() they all take one
+    /// lock; afterwards searching and resolving the ids interned before freeze() does not lock.
+    class IdAtoms
+    {
+        public:
+
+            typedef unsigned int Atom;
+
+            static const Atom sNone = 0;
+            ///< Never assigned to an id
+
+            static Atom intern (const std::string& id);
+            ///< Atom of \a id, assigning a new one if \a id has not been seen before.
+
+            static Atom search (const std::string& id);
+            ///< Atom of \a id, or sNone if \a id has not been interned. Does not allocate.
+
+            static const std::string& getId (Atom atom);
+            ///< Lower case id of \a atom. The reference stays valid for the lifetime of the process.
+            /// \attention \a atom must have been returned by intern().
+
+            static size_t getSize();
+            ///< Number of atoms assigned so far. Atoms range from 1 to getSize().
+
+            static void freeze();
+            ///< Take a read-only copy of the ids interned so far (e.g. once the content files are
+            /// loaded), which search() and getId() then use without locking. Ids interned later
+            /// still work, but looking them up locks again.
+            ///
+            /// \attention Must be called at most once, while no other thread uses IdAtoms.
+    };
+}
+
+#endif
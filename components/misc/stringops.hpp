@@ -17,6 +17,13 @@ class StringUtils
     };
 
 public:
+    /// Lower case version of \a ch. The same as std::tolower in the "C" locale, which the
+    /// engine keeps for LC_CTYPE, without the locale lookup.
+    static char toLowerAscii(char ch)
+    {
+        return (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+    }
+
     static bool ciLess(const std::string &x, const std::string &y) {
         return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end(), ci());
     }
@@ -28,7 +35,7 @@ public:
         std::string::const_iterator xit = x.begin();
         std::string::const_iterator yit = y.begin();
         for (; xit != x.end(); ++xit, ++yit) {
-            if (std::tolower(*xit) != std::tolower(*yit)) {
+            if (*xit != *yit && toLowerAscii(*xit) != toLowerAscii(*yit)) {
                 return false;
             }
         }
@@ -55,6 +62,17 @@ public:
         return 0;
     }
 
+    /// Hash of the lower case version of \a str, without making a copy (FNV-1a)
+    static unsigned int ciHash(const std::string &str)
+    {
+        unsigned int hash = 2166136261u;
+        for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+            hash ^= static_cast<unsigned char>(toLowerAscii(*it));
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
     /// Transforms input string to lower case w/o copy
     static std::string &toLower(std::string &inout) {
         std::transform(
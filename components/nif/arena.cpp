@@ -0,0 +1,67 @@
+#include "arena.hpp"
+
+namespace
+{
+    /// Smallest block worth allocating, also for small files
+    const std::size_t sMinBlockSize = 4096;
+}
+
+const std::size_t Nif::Arena::sMaxAlignment;
+
+Nif::Arena::Arena (std::size_t blockSize)
+: mBlockSize (blockSize<sMinBlockSize ? sMinBlockSize : blockSize), mNext (0), mLeft (0),
+  mUsed (0)
+{}
+
+Nif::Arena::~Arena()
+{
+    for (std::vector<char *>::iterator iter (mBlocks.begin()); iter!=mBlocks.end(); ++iter)
+        ::operator delete (*iter);
+}
+
+void *Nif::Arena::allocate (std::size_t size, std::size_t alignment)
+{
+    assert (alignment>0 && alignment<=sMaxAlignment && (alignment & (alignment-1))==0);
+
+    std::size_t padding = (alignment - reinterpret_cast<std::size_t> (mNext) % alignment)
+        % alignment;
+
+    if (size+padding>mLeft)
+    {
+        // ::operator new returns memory aligned for any type; make room for the block first,
+        // so it can not leak
+        if (mBlocks.size()==mBlocks.capacity())
+            mBlocks.reserve (2*mBlocks.size()+4);
+
+        if (size>mBlockSize/4)
+        {
+            // large arrays get a block of their own, so the current one is not abandoned
+            char *block = static_cast<char *> (::operator new (size));
+            mBlocks.push_back (block);
+            mUsed += size;
+            return block;
+        }
+
+        mNext = static_cast<char *> (::operator new (mBlockSize));
+        mBlocks.push_back (mNext);
+        mLeft = mBlockSize;
+        padding = 0;
+    }
+
+    void *data = mNext + padding;
+    mNext += padding + size;
+    mLeft -= padding + size;
+    mUsed += padding + size;
+
+    return data;
+}
+
+std::size_t Nif::Arena::getBlocks() const
+{
+    return mBlocks.size();
+}
+
+std::size_t Nif::Arena::getUsed() const
+{
+    return mUsed;
+}
@@ -0,0 +1,134 @@
+#ifndef OPENMW_COMPONENTS_NIF_ARENA_HPP
+#define OPENMW_COMPONENTS_NIF_ARENA_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/type_traits/alignment_of.hpp>
+
+namespace Nif
+{
+    /// \brief Memory for the records of one NIF file and the arrays they hold
+    ///
+    /// Memory is handed out from large blocks and only given back when the arena is destroyed,
+    /// all at once. Destructors of objects in the arena are not run by it; NIFFile does that for
+    /// the records, everything else placed in it must not need one. Not thread safe.
+    class Arena
+    {
+        public:
+
+            /// Suitable for any type a record is made of
+            static const std::size_t sMaxAlignment = 16;
+
+            explicit Arena (std::size_t blockSize);
+            ///< \param blockSize Size of the blocks; requests larger than a quarter of that get
+            /// a block of their own.
+
+            ~Arena();
+
+            void *allocate (std::size_t size, std::size_t alignment = sMaxAlignment);
+
+            template<typename T>
+            T *allocate (std::size_t count)
+            {
+                if (count==0)
+                    return 0;
+
+                if (count>static_cast<std::size_t> (-1)/sizeof (T))
+                    throw std::bad_alloc();
+
+                T *data = static_cast<T *> (allocate (count*sizeof (T),
+                    boost::alignment_of<T>::value));
+
+                for (std::size_t i=0; i<count; ++i)
+                    new (data+i) T();
+
+                return data;
+            }
+
+            std::size_t getBlocks() const;
+
+            std::size_t getUsed() const;
+            ///< Bytes handed out so far, including the padding for alignment.
+
+        private:
+
+            Arena (const Arena&);
+            Arena& operator= (const Arena&);
+
+            std::size_t mBlockSize;
+            std::vector<char *> mBlocks;
+            char *mNext;
+            std::size_t mLeft; ///< in the current block
+            std::size_t mUsed;
+    };
+
+    /// \brief Fixed-size array in the Arena of a NIF file
+    ///
+    /// Copies refer to the same elements, so like the records they must not outlive the file;
+    /// copy the elements into a std::vector to keep them longer.
+    template<typename T>
+    class Array
+    {
+            T *mData;
+            std::size_t mSize;
+
+        public:
+
+            typedef T value_type;
+            typedef T *iterator;
+            typedef const T *const_iterator;
+
+            Array() : mData (0), mSize (0) {}
+
+            void allocate (Arena& arena, std::size_t size)
+            ///< Replace the array with \a size value-initialised elements. The old ones stay in
+            /// the arena.
+            {
+                mData = arena.allocate<T> (size);
+                mSize = size;
+            }
+
+            std::size_t size() const { return mSize; }
+
+            bool empty() const { return mSize==0; }
+
+            T& operator[] (std::size_t index)
+            {
+                assert (index<mSize);
+                return mData[index];
+            }
+
+            const T& operator[] (std::size_t index) const
+            {
+                assert (index<mSize);
+                return mData[index];
+            }
+
+            T& at (std::size_t index)
+            {
+                if (index>=mSize)
+                    throw std::out_of_range ("NIF array index out of range");
+
+                return mData[index];
+            }
+
+            const T& at (std::size_t index) const
+            {
+                if (index>=mSize)
+                    throw std::out_of_range ("NIF array index out of range");
+
+                return mData[index];
+            }
+
+            iterator begin() { return mData; }
+            iterator end() { return mData+mSize; }
+            const_iterator begin() const { return mData; }
+            const_iterator end() const { return mData+mSize; }
+    };
+}
+
+#endif
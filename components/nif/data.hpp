@@ -96,9 +96,9 @@ public:
 class ShapeData : public Record
 {
 public:
-    std::vector<Ogre::Vector3> vertices, normals;
-    std::vector<Ogre::Vector4> colors;
-    std::vector< std::vector<Ogre::Vector2> > uvlist;
+    Array<Ogre::Vector3> vertices, normals;
+    Array<Ogre::Vector4> colors;
+    Array< Array<Ogre::Vector2> > uvlist;
     Ogre::Vector3 center;
     float radius;
 
@@ -125,7 +125,7 @@ public:
 
         if(nif->getInt())
         {
-            uvlist.resize(uvs);
+            nif->allocate(uvlist, uvs);
             for(int i = 0;i < uvs;i++)
                 nif->getVector2s(uvlist[i], verts);
         }
@@ -136,7 +136,7 @@ class NiTriShapeData : public ShapeData
 {
 public:
     // Triangles, three vertex indices per triangle
-    std::vector<short> triangles;
+    Array<short> triangles;
 
     void read(NIFStream *nif)
     {
@@ -171,7 +171,7 @@ public:
 
     int activeCount;
 
-    std::vector<float> sizes;
+    Array<float> sizes;
 
     void read(NIFStream *nif)
     {
@@ -194,7 +194,7 @@ public:
 class NiRotatingParticlesData : public NiAutoNormalParticlesData
 {
 public:
-    std::vector<Ogre::Quaternion> rotations;
+    Array<Ogre::Quaternion> rotations;
 
     void read(NIFStream *nif)
     {
@@ -350,11 +350,11 @@ public:
     {
         BoneTrafo trafo;
         Ogre::Vector4 unknown;
-        std::vector<VertWeight> weights;
+        Array<VertWeight> weights;
     };
 
     BoneTrafo trafo;
-    std::vector<BoneInfo> bones;
+    Array<BoneInfo> bones;
 
     void read(NIFStream *nif)
     {
@@ -365,7 +365,7 @@ public:
         int boneNum = nif->getInt();
         nif->getInt(); // -1
 
-        bones.resize(boneNum);
+        nif->allocate(bones, boneNum);
         for(int i=0;i<boneNum;i++)
         {
             BoneInfo &bi = bones[i];
@@ -376,7 +376,7 @@ public:
             bi.unknown = nif->getVector4();
 
             // Number of vertex weights
-            bi.weights.resize(nif->getUShort());
+            nif->allocate(bi.weights, nif->getUShort());
             for(size_t j = 0;j < bi.weights.size();j++)
             {
                 bi.weights[j].vertex = nif->getUShort();
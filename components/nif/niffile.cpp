@@ -35,84 +35,130 @@
 
 #include <iostream>
 
-//TODO: when threading is needed, enable these
-//#include <boost/mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 namespace Nif
 {
 
 class NIFFile::LoadedCache
 {
-    //TODO: enable this to make cache thread safe...
-    //typedef boost::mutex mutex;
-    
-    struct mutex
+    // a file being parsed, for the threads waiting for it
+    struct Loading
     {
-        void lock () {};
-        void unlock () {}
+        bool mDone;
+        ptr mResult;        // empty if parsing failed
+        std::string mError;
+
+        Loading () : mDone (false) {}
     };
-    
+
+    typedef boost::mutex mutex;
     typedef boost::lock_guard <mutex> lock_guard;
+    typedef boost::unique_lock <mutex> unique_lock;
     typedef std::map < std::string, boost::weak_ptr <NIFFile> > loaded_map;
+    typedef std::map < std::string, boost::shared_ptr <Loading> > loading_map;
     typedef std::vector < boost::shared_ptr <NIFFile> > locked_files;
 
     static int sLockLevel;
     static mutex sProtector;
+    static boost::condition_variable sLoadingDone;
     static loaded_map sLoadedMap;
+    static loading_map sLoadingMap;
     static locked_files sLockedFiles;
 
-public:
-
-    static ptr create (const std::string &name)
+    static void finish (const std::string &name, boost::shared_ptr <Loading> loading,
+                        ptr result, const std::string &error)
     {
-        lock_guard _ (sProtector);
+        {
+            lock_guard _ (sProtector);
 
-        ptr result;
+            sLoadingMap.erase (name);
+
+            loading->mDone = true;
+            loading->mResult = result;
+            loading->mError = error;
+
+            if (result)
+            {
+                // if we are locking the cache add an extra reference
+                // to keep the file in memory
+                if (sLockLevel > 0)
+                    sLockedFiles.push_back (result);
 
-        // lookup the resource
-        loaded_map::iterator i = sLoadedMap.find (name);
+                // stash a reference to the resource so that future
+                // calls can benefit. We potentially overwrite an expired
+                // pointer here but the other thread performing the delete
+                // on the previous copy of this resource will detect it and
+                // make sure not to erase the new reference
+                sLoadedMap [name] = boost::weak_ptr <NIFFile> (result);
+            }
+        }
 
-        if (i == sLoadedMap.end ()) // it doesn't existing currently,
-        {                           // or hasn't in the very near past
+        sLoadingDone.notify_all ();
+    }
 
-            // create it now, for smoother threading if needed, the
-            // loading should be performed outside of the sLoaderMap
-            // lock and an alternate mechanism should be used to
-            // synchronize threads competing to load the same resource
-            result = boost::make_shared <NIFFile> (name, psudo_private_modifier());
+public:
 
-            // if we are locking the cache add an extra reference
-            // to keep the file in memory
-            if (sLockLevel > 0)
-                sLockedFiles.push_back (result);
+    static ptr create (const std::string &name, const Opener &opener)
+    {
+        boost::shared_ptr <Loading> loading;
 
-            // stash a reference to the resource so that future
-            // calls can benefit
-            sLoadedMap [name] = boost::weak_ptr <NIFFile> (result);
-        }
-        else // it may (probably) still exists
         {
-            // attempt to get the reference
-            result = i->second.lock ();
+            unique_lock lock (sProtector);
+
+            // lookup the resource
+            loaded_map::iterator i = sLoadedMap.find (name);
 
-            if (!result) // resource is in the process of being destroyed
+            if (i != sLoadedMap.end ())
             {
-                // create a new instance, to replace the one that has
-                // begun the irreversible process of being destroyed
-                result = boost::make_shared <NIFFile> (name, psudo_private_modifier());
+                // attempt to get the reference, it fails if the resource
+                // is in the process of being destroyed
+                ptr result = i->second.lock ();
 
-                // respect the cache lock...
-                if (sLockLevel > 0)
-                    sLockedFiles.push_back (result);
+                if (result)
+                    return result;
+            }
 
-                // we potentially overwrite an expired pointer here
-                // but the other thread performing the delete on
-                // the previous copy of this resource will detect it
-                // and make sure not to erase the new reference
-                sLoadedMap [name] = boost::weak_ptr <NIFFile> (result);
+            loading_map::iterator j = sLoadingMap.find (name);
+
+            if (j != sLoadingMap.end ()) // another thread is parsing it
+            {                            // right now, wait for its result
+                loading = j->second;
+
+                while (!loading->mDone)
+                    sLoadingDone.wait (lock);
+
+                if (!loading->mResult)
+                    throw std::runtime_error (loading->mError);
+
+                return loading->mResult;
             }
+
+            // let other threads know that we are parsing it
+            loading = boost::make_shared <Loading> ();
+            sLoadingMap [name] = loading;
+        }
+
+        // the parsing itself is done outside of the lock, so that
+        // other files can be loaded in the meantime
+        ptr result;
+
+        try
+        {
+            Ogre::DataStreamPtr stream = opener ? opener (name) :
+                Ogre::ResourceGroupManager::getSingleton().openResource(name);
+
+            result = boost::make_shared <NIFFile> (name, stream, psudo_private_modifier());
         }
+        catch (const std::exception &e)
+        {
+            finish (name, loading, ptr (), e.what ());
+            throw;
+        }
+
+        finish (name, loading, result, "");
 
         // we made it!
         return result;
@@ -124,14 +170,12 @@ public:
 
         loaded_map::iterator i = sLoadedMap.find (file->filename);
 
-        // its got to be in here, it just might not be us...
-        assert (i != sLoadedMap.end ());
-
         // if weak_ptr is still expired, this resource hasn't been recreated
         // between the initiation of the final release due to destruction
         // of the last shared pointer and this thread acquiring the lock on
-        // the loader map
-        if (i->second.expired ())
+        // the loader map. If it has been recreated and released again, the
+        // entry may be gone already
+        if (i != sLoadedMap.end () && i->second.expired ())
             sLoadedMap.erase (i);
     }
 
@@ -149,47 +193,69 @@ public:
         {
             lock_guard _ (sProtector);
 
-            if (--sLockLevel)
+            if (--sLockLevel == 0)
                 sLockedFiles.swap(resetList);
         }
 
-        // this not necessary, but makes it clear that the
-        // deletion of the locked cache entries is being done
-        // outside the protection of sProtector
+        // the locked cache entries are deleted outside the protection
+        // of sProtector, as their destructors need it
         resetList.clear ();
     }
 };
 
 int NIFFile::LoadedCache::sLockLevel = 0;
 NIFFile::LoadedCache::mutex NIFFile::LoadedCache::sProtector;
+boost::condition_variable NIFFile::LoadedCache::sLoadingDone;
 NIFFile::LoadedCache::loaded_map NIFFile::LoadedCache::sLoadedMap;
+NIFFile::LoadedCache::loading_map NIFFile::LoadedCache::sLoadingMap;
 NIFFile::LoadedCache::locked_files NIFFile::LoadedCache::sLockedFiles;
 
 // these three calls are forwarded to the cache implementation...
 void NIFFile::lockCache ()     { LoadedCache::lockCache (); }
 void NIFFile::unlockCache ()   { LoadedCache::unlockCache (); }
-NIFFile::ptr NIFFile::create (const std::string &name) { return LoadedCache::create  (name); }
+NIFFile::ptr NIFFile::create (const std::string &name, const Opener &opener) { return LoadedCache::create  (name, opener); }
 
-/// Open a NIF stream. The name is used for error messages.
-NIFFile::NIFFile(const std::string &name, psudo_private_modifier)
+/// Parse a NIF stream. The name is used for error messages.
+NIFFile::NIFFile(const std::string &name, Ogre::DataStreamPtr stream, psudo_private_modifier)
     : filename(name)
+    // records and their arrays take about as much memory as the file
+    , arena(stream->size())
 {
-    parse();
+    try
+    {
+        parse(stream);
+    }
+    catch(...)
+    {
+        // the destructor does not run for a file that failed to parse
+        destroyRecords();
+        throw;
+    }
 }
 
 NIFFile::~NIFFile()
 {
     LoadedCache::release (this);
 
+    destroyRecords();
+}
+
+void NIFFile::destroyRecords()
+{
+    // the arena frees the memory
     for(std::size_t i=0; i<records.size(); i++)
-        delete records[i];
+        if(records[i])
+            records[i]->~Record();
+
+    records.clear();
+    roots.clear();
 }
 
-template <typename NodeType> static Record* construct() { return new NodeType; }
+template <typename NodeType> static Record* construct(Arena &arena) { return new (arena) NodeType; }
 
 struct RecordFactoryEntry {
 
-    typedef Record* (*create_t) ();
+    typedef Record* (*create_t) (Arena &);
 
     char const *    mName;
     create_t        mCreate;
@@ -286,9 +352,9 @@ RecordFactoryEntry const * lookupRecordFactory (char const * name)
    definitions in the record types.
  */
 
-void NIFFile::parse()
+void NIFFile::parse(Ogre::DataStreamPtr stream)
 {
-    NIFStream nif (this, Ogre::ResourceGroupManager::getSingleton().openResource(filename));
+    NIFStream nif (this, stream, arena);
 
   // Check the header string
   std::string head = nif.getString(40);
@@ -323,7 +389,7 @@ void NIFFile::parse()
 
       if (entry != NULL)
       {
-          r = entry->mCreate ();
+          r = entry->mCreate (arena);
           r->recType = entry->mType;
       }
       else
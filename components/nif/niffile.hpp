@@ -40,10 +40,12 @@
 #include <boost/weak_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/function.hpp>
 #include <boost/detail/endian.hpp>
 
 #include <stdint.h>
 
+#include "arena.hpp"
 #include "record.hpp"
 #include "niftypes.hpp"
 #include "nifstream.hpp"
@@ -63,6 +65,9 @@ class NIFFile
     /// File name, used for error messages
     std::string filename;
 
+    /// Holds the records and their arrays, freed with the file
+    Arena arena;
+
     /// Record list
     std::vector<Record*> records;
 
@@ -70,7 +75,10 @@ class NIFFile
     std::vector<Record*> roots;
 
     /// Parse the file
-    void parse();
+    void parse(Ogre::DataStreamPtr stream);
+
+    /// Run the destructors of the records
+    void destroyRecords();
 
     class LoadedCache;
     friend class LoadedCache;
@@ -97,11 +105,17 @@ public:
 
     typedef boost::shared_ptr <NIFFile> ptr;
 
-    /// Open a NIF stream. The name is used for error messages.
-    NIFFile(const std::string &name, psudo_private_modifier);
+    /// Opens the file with the given name for parsing
+    typedef boost::function <Ogre::DataStreamPtr (const std::string &)> Opener;
+
+    /// Parse a NIF stream. The name is used for error messages.
+    NIFFile(const std::string &name, Ogre::DataStreamPtr stream, psudo_private_modifier);
     ~NIFFile();
 
-    static ptr create (const std::string &name);
+    /// Get the file with the given name, parsing it unless it is loaded already. If another
+    /// thread is parsing it, wait for that instead. Opens the file through Ogre's resource
+    /// system unless an opener is given; only the latter can be used from other threads.
+    static ptr create (const std::string &name, const Opener &opener = Opener());
     static void lockCache ();
     static void unlockCache ();
 
@@ -1,6 +1,13 @@
 #ifndef OPENMW_COMPONENTS_NIF_NIFSTREAM_HPP
 #define OPENMW_COMPONENTS_NIF_NIFSTREAM_HPP
 
+#include <algorithm>
+#include <cstring>
+
+#include <OgrePlatform.h>
+
+#include "arena.hpp"
+
 namespace Nif
 {
 
@@ -38,11 +45,68 @@ class NIFStream {
         return u.f;
     }
 
+    /// Read \a count little-endian values of type \a T (2 or 4 bytes each) into \a data at once
+    ///
+    /// Values missing at the end of the stream are set to 0, like read_le16() and read_le32()
+    /// do. No conversion is needed on little-endian machines; big-endian machines swap the bytes
+    /// of each value in place.
+    template<typename T>
+    void read_le_array(T *data, size_t count)
+    {
+        size_t size = count*sizeof(T);
+        if(size == 0)
+            return;
+
+        char *bytes = reinterpret_cast<char*>(data);
+        size_t read = inp->read(bytes, size);
+        if(read < size)
+            std::memset(bytes+read, 0, size-read);
+
+#if OGRE_ENDIAN == OGRE_ENDIAN_BIG
+        for(size_t i = 0;i < size;i += sizeof(T))
+            std::reverse(bytes+i, bytes+i+sizeof(T));
+#endif
+    }
+
+    /// Read \a count objects made of \a N floats each, like Ogre::Vector3
+    template<size_t N, typename Container>
+    void read_float_array(Container &vec, size_t count)
+    {
+        typedef typename Container::value_type T;
+
+        allocate(vec, count);
+        if(count == 0)
+            return;
+
+        if(sizeof(T) == N*sizeof(float))
+            read_le_array(reinterpret_cast<float*>(&vec[0]), count*N);
+        else // Ogre::Real is double
+        {
+            float a[N];
+            for(size_t i = 0;i < count;i++)
+            {
+                read_le_array(a, N);
+                for(size_t j = 0;j < N;j++)
+                    reinterpret_cast<Ogre::Real*>(&vec[i])[j] = a[j];
+            }
+        }
+    }
+
+    /// Arrays and records are allocated here
+    Arena &arena;
+
 public:
 
     NIFFile * const file;
 
-    NIFStream (NIFFile * file, Ogre::DataStreamPtr inp): file (file), inp (inp) {}
+    NIFStream (NIFFile * file, Ogre::DataStreamPtr inp, Arena &arena)
+      : inp (inp), arena (arena), file (file) {}
+
+    /// Give an array of the file \a size elements
+    template<typename T>
+    void allocate(Array<T> &array, size_t size) { array.allocate(arena, size); }
+    template<typename T>
+    void allocate(std::vector<T> &vec, size_t size) { vec.resize(size); }
 
     /*************************************************
                Parser functions
@@ -125,12 +189,18 @@ public:
 
     std::string getString(size_t length)
     {
-        std::vector<char> str (length+1, 0);
+        // read in place instead of through a temporary buffer
+        std::string str (length, '\0');
 
-        if(inp->read(&str[0], length) != length)
+        if(length > 0 && inp->read(&str[0], length) != length)
             throw std::runtime_error ("string length in NIF file does not match");
 
-        return &str[0];
+        // strings end at the first null, if there is one
+        std::string::size_type end = str.find('\0');
+        if(end != std::string::npos)
+            str.resize(end);
+
+        return str;
     }
     std::string getString()
     {
@@ -138,41 +208,41 @@ public:
         return getString(size);
     }
 
-    void getShorts(std::vector<short> &vec, size_t size)
+    // These read into an Array or a std::vector
+    template<typename Container>
+    void getShorts(Container &vec, size_t size)
     {
-        vec.resize(size);
-        for(size_t i = 0;i < vec.size();i++)
-            vec[i] = getShort();
+        allocate(vec, size);
+        if(size > 0)
+            read_le_array(&vec[0], size);
     }
-    void getFloats(std::vector<float> &vec, size_t size)
+    template<typename Container>
+    void getFloats(Container &vec, size_t size)
     {
-        vec.resize(size);
-        for(size_t i = 0;i < vec.size();i++)
-            vec[i] = getFloat();
+        allocate(vec, size);
+        if(size > 0)
+            read_le_array(&vec[0], size);
     }
-    void getVector2s(std::vector<Ogre::Vector2> &vec, size_t size)
+    template<typename Container>
+    void getVector2s(Container &vec, size_t size)
     {
-        vec.resize(size);
-        for(size_t i = 0;i < vec.size();i++)
-            vec[i] = getVector2();
+        read_float_array<2>(vec, size);
     }
-    void getVector3s(std::vector<Ogre::Vector3> &vec, size_t size)
+    template<typename Container>
+    void getVector3s(Container &vec, size_t size)
     {
-        vec.resize(size);
-        for(size_t i = 0;i < vec.size();i++)
-            vec[i] = getVector3();
+        read_float_array<3>(vec, size);
     }
-    void getVector4s(std::vector<Ogre::Vector4> &vec, size_t size)
+    template<typename Container>
+    void getVector4s(Container &vec, size_t size)
     {
-        vec.resize(size);
-        for(size_t i = 0;i < vec.size();i++)
-            vec[i] = getVector4();
+        read_float_array<4>(vec, size);
     }
-    void getQuaternions(std::vector<Ogre::Quaternion> &quat, size_t size)
+    template<typename Container>
+    void getQuaternions(Container &quat, size_t size)
     {
-        quat.resize(size);
-        for(size_t i = 0;i < quat.size();i++)
-            quat[i] = getQuaternion();
+        // w, x, y, z in both the file and Ogre::Quaternion
+        read_float_array<4>(quat, size);
     }
 };
 
@@ -0,0 +1,106 @@
+#include "preloader.hpp"
+
+#include <iostream>
+#include <set>
+
+#include <boost/bind.hpp>
+
+namespace Nif
+{
+    Preloader::Preloader (const NIFFile::Opener& opener, int threads)
+    : mOpener (opener), mBatch (0), mQuit (false)
+    {
+        // Initialise the function-local static before the workers race for it
+        Transformation::getIdentity();
+
+        for (int i=0; i<threads; ++i)
+            mThreads.create_thread (boost::bind (&Preloader::run, this));
+    }
+
+    Preloader::~Preloader()
+    {
+        {
+            boost::mutex::scoped_lock lock (mMutex);
+            mQuit = true;
+        }
+
+        mQueued.notify_all();
+        mThreads.join_all();
+    }
+
+    void Preloader::preload (const std::vector<std::string>& names)
+    {
+        std::vector<NIFFile::ptr> loaded; // released outside of the lock
+
+        {
+            boost::mutex::scoped_lock lock (mMutex);
+
+            ++mBatch;
+            mQueue.clear();
+            mLoaded.swap (loaded);
+
+            std::set<std::string> queued;
+
+            for (std::vector<std::string>::const_iterator iter (names.begin()); iter!=names.end();
+                ++iter)
+                if (queued.insert (*iter).second)
+                    mQueue.push_back (*iter);
+        }
+
+        mQueued.notify_all();
+    }
+
+    void Preloader::clear()
+    {
+        std::vector<NIFFile::ptr> loaded; // released outside of the lock
+
+        {
+            boost::mutex::scoped_lock lock (mMutex);
+
+            ++mBatch;
+            mQueue.clear();
+            mLoaded.swap (loaded);
+        }
+    }
+
+    void Preloader::run()
+    {
+        while (true)
+        {
+            std::string name;
+            int batch = 0;
+
+            {
+                boost::mutex::scoped_lock lock (mMutex);
+
+                while (mQueue.empty() && !mQuit)
+                    mQueued.wait (lock);
+
+                if (mQuit)
+                    return;
+
+                name = mQueue.front();
+                mQueue.pop_front();
+                batch = mBatch;
+            }
+
+            NIFFile::ptr file;
+
+            try
+            {
+                file = NIFFile::create (name, mOpener);
+            }
+            catch (const std::exception& e)
+            {
+                // Loading it on the main thread will report the error again
+                std::cerr << "Failed to preload " << name << ": " << e.what() << std::endl;
+            }
+
+            boost::mutex::scoped_lock lock (mMutex);
+
+            // The batch may have been replaced while we were parsing
+            if (file && batch==mBatch)
+                mLoaded.push_back (file);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef OPENMW_COMPONENTS_NIF_PRELOADER_HPP
+#define OPENMW_COMPONENTS_NIF_PRELOADER_HPP
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "niffile.hpp"
+
+namespace Nif
+{
+    /// \brief Parses NIF files on worker threads before they are needed
+    ///
+    /// The files go through NIFFile::create, so they end up in its cache, and a file asked for
+    /// while a worker is still parsing it is waited for instead of being parsed twice. Parsed
+    /// files are kept alive until the next batch or clear().
+    class Preloader
+    {
+        public:
+
+            Preloader (const NIFFile::Opener& opener, int threads);
+            ///< \param opener Used by all workers at once, so it must be thread safe (Ogre's
+            /// resource system is not).
+
+            ~Preloader();
+
+            void preload (const std::vector<std::string>& names);
+            ///< Start parsing \a names, in order, replacing whatever is still queued. Releases
+            /// the files of the previous batch.
+
+            void clear();
+            ///< Drop what is still queued and release the parsed files.
+
+        private:
+
+            Preloader (const Preloader&);
+            Preloader& operator= (const Preloader&);
+
+            void run();
+
+            NIFFile::Opener mOpener;
+
+            std::deque<std::string> mQueue;
+            std::vector<NIFFile::ptr> mLoaded;
+            int mBatch; ///< number of the current batch
+
+            bool mQuit;
+            boost::mutex mMutex;
+            boost::condition_variable mQueued;
+            boost::thread_group mThreads;
+    };
+}
+
+#endif
@@ -26,6 +26,8 @@
 
 #include <string>
 
+#include "arena.hpp"
+
 namespace Nif
 {
 
@@ -110,11 +112,16 @@ struct Record
 
     virtual ~Record() {}
 
-    /*
-       Use these later if you want custom allocation of all NIF objects
-    static void* operator new(size_t size);
-    static void operator delete(void *p);
-    */
+    /// Records are allocated in the arena of their file, which frees them. NIFFile runs their
+    /// destructors.
+    static void *operator new(size_t size, Arena &arena)
+    { return arena.allocate(size); }
+    /// Only called if a constructor throws
+    static void operator delete(void *, Arena &) {}
+
+protected:
+    /// Keeps records from being deleted
+    static void operator delete(void *) {}
 };
 
 } // Namespace
@@ -25,7 +25,6 @@
 #define OPENMW_COMPONENTS_NIF_RECORDPTR_HPP
 
 #include "niffile.hpp"
-#include <vector>
 
 namespace Nif
 {
@@ -99,20 +98,19 @@ public:
 };
 
 /** A list of references to other records. These are read as a list,
-    and later converted to pointers as needed. Not an optimized
-    implementation.
+    and later converted to pointers as needed.
  */
 template <class X>
 class RecordListT
 {
     typedef RecordPtrT<X> Ptr;
-    std::vector<Ptr> list;
+    Array<Ptr> list;
 
 public:
     void read(NIFStream *nif)
     {
         int len = nif->getInt();
-        list.resize(len);
+        nif->allocate(list, len);
 
         for(size_t i=0;i < list.size();i++)
             list[i].read(nif);
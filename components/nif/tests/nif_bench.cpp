@@ -0,0 +1,161 @@
+#include "../niffile.hpp"
+#include "../node.hpp"
+#include "../data.hpp"
+#include "../../bsa/bsa_file.hpp"
+#include "../../bsa/bsa_archive.hpp"
+#include "../../misc/stringops.hpp"
+#include "../../misc/allocations.hpp"
+
+/*
+  Benchmark of NIF parsing
+
+  Parses every NIF in the archive through NIFFile, the way the mesh
+  loader does, and reports the throughput and the number of heap
+  allocations made while parsing. Files that fail to parse are counted
+  and listed, but do not stop the run. Run it twice to compare with a
+  warm page cache.
+
+  Then loads a cell: the first [cell size] NIFs of the archive are parsed
+  and kept, as the scene keeps the models of a cell, and released
+  together, as on a cell change. Reports the load and release times (best
+  of several rounds) and the allocations and frees of each.
+
+  Usage: nif_bench [archive] [cell size] (defaults to data/Morrowind.bsa
+  in the root directory of OpenMW, and 400)
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+#include <Ogre.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+using namespace Bsa;
+
+const int cellRounds = 7;
+
+bool isNif(const char *name)
+{
+  size_t len = strlen(name);
+  return len >= 4 && Misc::StringUtils::ciEqual(string(name + len - 4), ".nif");
+}
+
+double elapsed(const boost::posix_time::ptime &start)
+{
+  return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *archive = argc > 1 ? argv[1] : "../../data/Morrowind.bsa";
+  size_t cellSize = argc > 2 ? atoi(argv[2]) : 400;
+
+  // Disable Ogre logging
+  new Ogre::LogManager;
+  Ogre::Log *log = Ogre::LogManager::getSingleton().createLog("");
+  log->setDebugOutputEnabled(false);
+
+  new Ogre::Root("","","");
+  addBSA(archive);
+
+  BSAFile bsa;
+  bsa.open(archive);
+  const BSAFile::FileList &files = bsa.getList();
+
+  Misc::Allocations::enable();
+
+  if(!Misc::Allocations::isSupported())
+    cout << "Allocations are not counted on this platform\n";
+
+  size_t count = 0, failed = 0, records = 0, vertices = 0;
+  size_t bytes = 0;
+  vector<const char *> cell;
+
+  size_t startAllocations = Misc::Allocations::getCount();
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+  for(size_t i=0; i<files.size(); i++)
+    {
+      if(!isNif(files[i].name))
+        continue;
+
+      count++;
+      bytes += files[i].fileSize;
+
+      try
+        {
+          Nif::NIFFile::ptr nif = Nif::NIFFile::create(files[i].name);
+
+          records += nif->numRecords();
+          for(size_t j=0; j<nif->numRecords(); j++)
+            {
+              const Nif::ShapeData *data =
+                dynamic_cast<const Nif::ShapeData*>(nif->getRecord(j));
+              if(data)
+                vertices += data->vertices.size();
+            }
+
+          if(cell.size() < cellSize)
+            cell.push_back(files[i].name);
+        }
+      catch(std::exception &e)
+        {
+          failed++;
+          cerr << "Failed: " << files[i].name << endl;
+        }
+    }
+
+  double secs = elapsed(start);
+  size_t used = Misc::Allocations::getCount() - startAllocations;
+
+  cout << count << " NIFs (" << failed << " failed), " << records << " records, "
+       << vertices << " vertices, " << bytes << " bytes in "
+       << fixed << setprecision(3) << secs << "s ("
+       << setprecision(0) << count / secs << " files/s, "
+       << setprecision(1) << bytes / secs / (1024*1024) << " MB/s), "
+       << used << " allocations (" << setprecision(1) << double(used) / count
+       << " per file)\n";
+
+  // The cell; the files are in the page cache by now
+  double loadSecs = 0, releaseSecs = 0;
+  size_t loadAllocations = 0, releaseFrees = 0;
+
+  for(int round=0; round<cellRounds; round++)
+    {
+      vector<Nif::NIFFile::ptr> loaded;
+      loaded.reserve(cell.size());
+
+      size_t allocations = Misc::Allocations::getCount();
+      start = boost::posix_time::microsec_clock::universal_time();
+
+      for(size_t i=0; i<cell.size(); i++)
+        loaded.push_back(Nif::NIFFile::create(cell[i]));
+
+      double load = elapsed(start);
+      loadAllocations = Misc::Allocations::getCount() - allocations;
+
+      size_t frees = Misc::Allocations::getFrees();
+      start = boost::posix_time::microsec_clock::universal_time();
+
+      loaded.clear();
+
+      double release = elapsed(start);
+      releaseFrees = Misc::Allocations::getFrees() - frees;
+
+      if(round == 0 || load < loadSecs)
+        loadSecs = load;
+      if(round == 0 || release < releaseSecs)
+        releaseSecs = release;
+    }
+
+  cout << "Cell of " << cell.size() << " NIFs, best of " << cellRounds << ": load "
+       << setprecision(1) << loadSecs * 1000 << " ms, " << loadAllocations << " allocations; release "
+       << releaseSecs * 1000 << " ms, " << releaseFrees << " frees\n";
+
+  return failed ? 1 : 0;
+}
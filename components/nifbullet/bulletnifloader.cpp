@@ -284,8 +284,8 @@ void ManualBulletShapeLoader::handleNiTriShape(btTriangleMesh* mesh, const Nif::
     mHasShape = true;
 
     const Nif::NiTriShapeData *data = shape->data.getPtr();
-    const std::vector<Ogre::Vector3> &vertices = data->vertices;
-    const short *triangles = &data->triangles[0];
+    const Nif::Array<Ogre::Vector3> &vertices = data->vertices;
+    const short *triangles = data->triangles.begin();
     for(size_t i = 0;i < data->triangles.size();i+=3)
     {
         Ogre::Vector3 b1 = transform*vertices[triangles[i+0]];
@@ -18,6 +18,7 @@
 #include <components/misc/stringops.hpp>
 
 #include "material.hpp"
+#include "meshcache.hpp"
 
 namespace NifOgre
 {
@@ -107,26 +108,18 @@ public:
 };
 
 
-NIFMeshLoader::LoaderMap NIFMeshLoader::sLoaders;
-
-void NIFMeshLoader::createSubMesh(Ogre::Mesh *mesh, const Nif::NiTriShape *shape)
+// Vertex data of a NiTriShape as it goes into the hardware buffers
+static void buildGeometry(const Nif::NiTriShape *shape, bool transformed, MeshCache::Geometry &geometry)
 {
     const Nif::NiTriShapeData *data = shape->data.getPtr();
     const Nif::NiSkinInstance *skin = (shape->skin.empty() ? NULL : shape->skin.getPtr());
-    std::vector<Ogre::Vector3> srcVerts = data->vertices;
-    std::vector<Ogre::Vector3> srcNorms = data->normals;
-    Ogre::HardwareBuffer::Usage vertUsage = Ogre::HardwareBuffer::HBU_STATIC;
-    bool vertShadowBuffer = false;
+    std::vector<Ogre::Vector3> &srcVerts = geometry.mVertices;
+    std::vector<Ogre::Vector3> &srcNorms = geometry.mNormals;
+    srcVerts.assign(data->vertices.begin(), data->vertices.end());
+    srcNorms.assign(data->normals.begin(), data->normals.end());
 
     if(skin != NULL)
     {
-        vertUsage = Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY;
-        vertShadowBuffer = true;
-
-        // Only set a skeleton when skinning. Unskinned meshes with a skeleton will be
-        // explicitly attached later.
-        mesh->setSkeletonName(mName);
-
         // Convert vertices and normals to bone space from bind position. It would be
         // better to transform the bones into bind position, but there doesn't seem to
         // be a reliable way to do that.
@@ -142,7 +135,7 @@ void NIFMeshLoader::createSubMesh(Ogre::Mesh *mesh, const Nif::NiTriShape *shape
                               Ogre::Quaternion(data->bones[b].trafo.rotation));
             mat = bones[b]->getWorldTransform() * mat;
 
-            const std::vector<Nif::NiSkinData::VertWeight> &weights = data->bones[b].weights;
+            const Nif::Array<Nif::NiSkinData::VertWeight> &weights = data->bones[b].weights;
             for(size_t i = 0;i < weights.size();i++)
             {
                 size_t index = weights[i].vertex;
@@ -158,44 +151,102 @@ void NIFMeshLoader::createSubMesh(Ogre::Mesh *mesh, const Nif::NiTriShape *shape
             }
         }
 
-        srcVerts = newVerts;
-        srcNorms = newNorms;
+        srcVerts.swap(newVerts);
+        srcNorms.swap(newNorms);
     }
-    else
+    else if(transformed)
     {
-        Ogre::SkeletonManager *skelMgr = Ogre::SkeletonManager::getSingletonPtr();
-        if(skelMgr->getByName(mName).isNull())
+        // No skinning and no skeleton, so just transform the vertices and
+        // normals into position.
+        Ogre::Matrix4 mat4 = shape->getWorldTransform();
+        for(size_t i = 0;i < srcVerts.size();i++)
         {
-            // No skinning and no skeleton, so just transform the vertices and
-            // normals into position.
-            Ogre::Matrix4 mat4 = shape->getWorldTransform();
-            for(size_t i = 0;i < srcVerts.size();i++)
-            {
-                Ogre::Vector4 vec4(srcVerts[i].x, srcVerts[i].y, srcVerts[i].z, 1.0f);
-                vec4 = mat4*vec4;
-                srcVerts[i] = Ogre::Vector3(&vec4[0]);
-            }
-            for(size_t i = 0;i < srcNorms.size();i++)
-            {
-                Ogre::Vector4 vec4(srcNorms[i].x, srcNorms[i].y, srcNorms[i].z, 0.0f);
-                vec4 = mat4*vec4;
-                srcNorms[i] = Ogre::Vector3(&vec4[0]);
-            }
+            Ogre::Vector4 vec4(srcVerts[i].x, srcVerts[i].y, srcVerts[i].z, 1.0f);
+            vec4 = mat4*vec4;
+            srcVerts[i] = Ogre::Vector3(&vec4[0]);
+        }
+        for(size_t i = 0;i < srcNorms.size();i++)
+        {
+            Ogre::Vector4 vec4(srcNorms[i].x, srcNorms[i].y, srcNorms[i].z, 0.0f);
+            vec4 = mat4*vec4;
+            srcNorms[i] = Ogre::Vector3(&vec4[0]);
         }
     }
 
-    // Set the bounding box first
     BoundsFinder bounds;
-    bounds.add(&srcVerts[0][0], srcVerts.size());
+    if(!srcVerts.empty())
+        bounds.add(&srcVerts[0][0], srcVerts.size());
     if(!bounds.isValid())
     {
         float v[3] = { 0.0f, 0.0f, 0.0f };
         bounds.add(&v[0], 1);
     }
 
-    mesh->_setBounds(Ogre::AxisAlignedBox(bounds.minX()-0.5f, bounds.minY()-0.5f, bounds.minZ()-0.5f,
-                                          bounds.maxX()+0.5f, bounds.maxY()+0.5f, bounds.maxZ()+0.5f));
-    mesh->_setBoundingSphereRadius(bounds.getRadius());
+    geometry.mMin = Ogre::Vector3(bounds.minX(), bounds.minY(), bounds.minZ());
+    geometry.mMax = Ogre::Vector3(bounds.maxX(), bounds.maxY(), bounds.maxZ());
+    geometry.mRadius = bounds.getRadius();
+
+    const Nif::Array<Ogre::Vector4> &colors = data->colors;
+    geometry.mColours.resize(colors.size());
+    if(colors.size())
+    {
+        Ogre::RenderSystem *rs = Ogre::Root::getSingleton().getRenderSystem();
+        for(size_t i = 0;i < colors.size();i++)
+        {
+            Ogre::ColourValue clr(colors[i][0], colors[i][1], colors[i][2], colors[i][3]);
+            rs->convertColourValue(clr, &geometry.mColours[i]);
+        }
+    }
+
+    size_t numUVs = data->uvlist.size();
+    geometry.mUVSets = numUVs;
+    geometry.mUVs.clear();
+    geometry.mUVs.reserve(srcVerts.size()*numUVs);
+    for (size_t vert = 0; vert<srcVerts.size(); ++vert)
+        for(size_t i = 0; i < numUVs; i++)
+            geometry.mUVs.push_back(data->uvlist[i][vert]);
+
+    geometry.mIndices.assign(data->triangles.begin(), data->triangles.end());
+}
+
+
+NIFMeshLoader::LoaderMap NIFMeshLoader::sLoaders;
+MeshCache *NIFMeshLoader::sCache = NULL;
+
+void NIFMeshLoader::createSubMesh(Ogre::Mesh *mesh, const Nif::NiTriShape *shape)
+{
+    const Nif::NiTriShapeData *data = shape->data.getPtr();
+    const Nif::NiSkinInstance *skin = (shape->skin.empty() ? NULL : shape->skin.getPtr());
+    Ogre::HardwareBuffer::Usage vertUsage = Ogre::HardwareBuffer::HBU_STATIC;
+    bool vertShadowBuffer = false;
+    bool transformed = false;
+
+    if(skin != NULL)
+    {
+        vertUsage = Ogre::HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY;
+        vertShadowBuffer = true;
+
+        // Only set a skeleton when skinning. Unskinned meshes with a skeleton will be
+        // explicitly attached later.
+        mesh->setSkeletonName(mName);
+    }
+    else
+        transformed = Ogre::SkeletonManager::getSingleton().getByName(mName).isNull();
+
+    MeshCache::Geometry geometry;
+    if(!sCache || !sCache->get(mName, mShapeIndex, transformed, geometry))
+    {
+        buildGeometry(shape, transformed, geometry);
+        if(sCache)
+            sCache->put(mName, mShapeIndex, transformed, geometry);
+    }
+
+    const std::vector<Ogre::Vector3> &srcVerts = geometry.mVertices;
+    const std::vector<Ogre::Vector3> &srcNorms = geometry.mNormals;
+
+    // Set the bounding box first
+    mesh->_setBounds(Ogre::AxisAlignedBox(geometry.mMin-Ogre::Vector3(0.5f), geometry.mMax+Ogre::Vector3(0.5f)));
+    mesh->_setBoundingSphereRadius(geometry.mRadius);
 
     // This function is just one long stream of Ogre-barf, but it works
     // great.
@@ -238,16 +289,9 @@ void NIFMeshLoader::createSubMesh(Ogre::Mesh *mesh, const Nif::NiTriShape *shape
     }
 
     // Vertex colors
-    const std::vector<Ogre::Vector4> &colors = data->colors;
-    if(colors.size())
+    const std::vector<Ogre::RGBA> &colorsRGB = geometry.mColours;
+    if(colorsRGB.size())
     {
-        Ogre::RenderSystem *rs = Ogre::Root::getSingleton().getRenderSystem();
-        std::vector<Ogre::RGBA> colorsRGB(colors.size());
-        for(size_t i = 0;i < colorsRGB.size();i++)
-        {
-            Ogre::ColourValue clr(colors[i][0], colors[i][1], colors[i][2], colors[i][3]);
-            rs->convertColourValue(clr, &colorsRGB[i]);
-        }
         vbuf = hwBufMgr->createVertexBuffer(Ogre::VertexElement::getTypeSize(Ogre::VET_COLOUR),
                                             colorsRGB.size(), Ogre::HardwareBuffer::HBU_STATIC);
         vbuf->writeData(0, vbuf->getSizeInBytes(), &colorsRGB[0], true);
@@ -256,7 +300,7 @@ void NIFMeshLoader::createSubMesh(Ogre::Mesh *mesh, const Nif::NiTriShape *shape
     }
 
     // Texture UV coordinates
-    size_t numUVs = data->uvlist.size();
+    size_t numUVs = geometry.mUVSets;
     if (numUVs)
     {
         size_t elemSize = Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT2);
@@ -266,20 +310,13 @@ void NIFMeshLoader::createSubMesh(Ogre::Mesh *mesh, const Nif::NiTriShape *shape
 
         vbuf = hwBufMgr->createVertexBuffer(decl->getVertexSize(nextBuf), srcVerts.size(),
                                             Ogre::HardwareBuffer::HBU_STATIC);
-
-        std::vector<Ogre::Vector2> allUVs;
-        allUVs.reserve(srcVerts.size()*numUVs);
-        for (size_t vert = 0; vert<srcVerts.size(); ++vert)
-            for(size_t i = 0; i < numUVs; i++)
-                allUVs.push_back(data->uvlist[i][vert]);
-
-        vbuf->writeData(0, elemSize*srcVerts.size()*numUVs, &allUVs[0], true);
+        vbuf->writeData(0, elemSize*srcVerts.size()*numUVs, &geometry.mUVs[0], true);
 
         bind->setBinding(nextBuf++, vbuf);
     }
 
     // Triangle faces
-    const std::vector<short> &srcIdx = data->triangles;
+    const std::vector<short> &srcIdx = geometry.mIndices;
     if(srcIdx.size())
     {
         ibuf = hwBufMgr->createIndexBuffer(Ogre::HardwareIndexBuffer::IT_16BIT, srcIdx.size(),
@@ -302,7 +339,7 @@ void NIFMeshLoader::createSubMesh(Ogre::Mesh *mesh, const Nif::NiTriShape *shape
             Ogre::VertexBoneAssignment boneInf;
             boneInf.boneIndex = skel->getBone(bones[i]->name)->getHandle();
 
-            const std::vector<Nif::NiSkinData::VertWeight> &weights = data->bones[i].weights;
+            const Nif::Array<Nif::NiSkinData::VertWeight> &weights = data->bones[i].weights;
             for(size_t j = 0;j < weights.size();j++)
             {
                 boneInf.vertexIndex = weights[j].vertex;
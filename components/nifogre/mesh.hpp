@@ -16,6 +16,8 @@ namespace Nif
 namespace NifOgre
 {
 
+class MeshCache;
+
 /** Manual resource loader for NiTriShapes. This is the main class responsible
  * for translating the internal NIF meshes into something Ogre can use.
  */
@@ -42,11 +44,18 @@ class NIFMeshLoader : Ogre::ManualResourceLoader
     typedef std::map<std::string,NIFMeshLoader> LoaderMap;
     static LoaderMap sLoaders;
 
+    static MeshCache *sCache;
+
     NIFMeshLoader(const std::string &name, const std::string &group, size_t idx);
 
     virtual void loadResource(Ogre::Resource *resource);
 
 public:
+    static void setCache(MeshCache *cache)
+    { sCache = cache; }
+    ///< Take the vertex data of sub-meshes from \a cache when it is valid (0 to build it from
+    /// the NIF files). Does not take ownership.
+
     static void createMesh(const std::string &name, const std::string &fullname, const std::string &group, size_t idx);
 };
 
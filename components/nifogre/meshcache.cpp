@@ -0,0 +1,450 @@
+#include "meshcache.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <components/vfs/index.hpp>
+#include <components/version/version.hpp>
+
+namespace
+{
+    const char sMagic[8] = { 'O', 'M', 'W', 'M', 'E', 'S', 'H', '\n' };
+
+    /// Changes whenever the layout of the cache or the geometry NIFMeshLoader builds changes
+    const uint32_t sFormat = 1;
+
+    /// Entry size and checksum
+    const size_t sEntryHeaderSize = 8;
+
+    std::string getBuild()
+    {
+        return std::string (OPENMW_VERSION) + " " + OPENMW_VERSION_COMMITHASH;
+    }
+
+    std::string getKey (const std::string& mesh, size_t shape, bool transformed)
+    {
+        std::ostringstream stream;
+        stream << mesh << '|' << shape << '|' << transformed;
+        return stream.str();
+    }
+
+    uint32_t getChecksum (const char *data, size_t size)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes (data, size);
+        return crc.checksum();
+    }
+
+    class Writer
+    {
+            std::string& mBuffer;
+
+        public:
+
+            Writer (std::string& buffer) : mBuffer (buffer) {}
+
+            template<typename T>
+            void write (const T& value)
+            {
+                mBuffer.append (reinterpret_cast<const char *> (&value), sizeof (T));
+            }
+
+            template<typename T>
+            void write (const std::vector<T>& values)
+            {
+                write (static_cast<uint32_t> (values.size()));
+
+                if (!values.empty())
+                    mBuffer.append (reinterpret_cast<const char *> (&values[0]),
+                        values.size()*sizeof (T));
+            }
+
+            void write (const std::string& value)
+            {
+                write (static_cast<uint32_t> (value.size()));
+                mBuffer.append (value);
+            }
+    };
+
+    /// Throws on reads past the end, which only happen with damaged entries
+    class Reader
+    {
+            const char *mData;
+            size_t mSize;
+
+            const char *take (size_t size)
+            {
+                if (size>mSize)
+                    throw std::runtime_error ("truncated entry");
+
+                const char *data = mData;
+                mData += size;
+                mSize -= size;
+                return data;
+            }
+
+        public:
+
+            Reader (const char *data, size_t size) : mData (data), mSize (size) {}
+
+            template<typename T>
+            void read (T& value)
+            {
+                std::memcpy (&value, take (sizeof (T)), sizeof (T));
+            }
+
+            template<typename T>
+            void read (std::vector<T>& values)
+            {
+                uint32_t count = 0;
+                read (count);
+
+                if (count>mSize/sizeof (T))
+                    throw std::runtime_error ("truncated entry");
+
+                values.resize (count);
+
+                if (count>0)
+                    std::memcpy (&values[0], take (count*sizeof (T)), count*sizeof (T));
+            }
+
+            void read (std::string& value)
+            {
+                uint32_t size = 0;
+                read (size);
+                const char *data = take (size);
+                value.assign (data, size);
+            }
+
+            bool atEnd() const
+            {
+                return mSize==0;
+            }
+    };
+}
+
+namespace NifOgre
+{
+    MeshCache::Geometry::Geometry() : mRadius (0), mUVSets (0) {}
+
+    MeshCache::Stats::Stats() : mHits (0), mMisses (0), mCorrupt (0) {}
+
+    MeshCache::MeshCache (const boost::filesystem::path& file, const VFS::Index& index,
+        int colourType)
+    : mFile (file), mIndex (index), mColourType (colourType), mChanged (false)
+    {
+        open();
+    }
+
+    void MeshCache::open()
+    {
+        mEntries.clear();
+
+        if (mMapping.isOpen())
+            mMapping.close();
+
+        if (!boost::filesystem::exists (mFile))
+            return;
+
+        try
+        {
+            mMapping.open (mFile.string().c_str());
+
+            Reader header (mMapping.data(), mMapping.size());
+
+            char magic[sizeof (sMagic)];
+            header.read (magic);
+
+            uint32_t format = 0;
+            uint32_t colourType = 0;
+            std::string build;
+
+            header.read (format);
+            header.read (colourType);
+            header.read (build);
+
+            if (std::memcmp (magic, sMagic, sizeof (sMagic)) || format!=sFormat ||
+                colourType!=mColourType || build!=getBuild())
+            {
+                std::cout << "Mesh cache is outdated, rebuilding " << mFile.string() << std::endl;
+                mMapping.close();
+                return;
+            }
+
+            size_t begin = sizeof (sMagic) + 3*sizeof (uint32_t) + build.size();
+
+            // Only the keys are read here; the entries are checked when they are used
+            while (mMapping.size()-begin>=sEntryHeaderSize)
+            {
+                uint32_t size = 0;
+                std::memcpy (&size, mMapping.data()+begin, sizeof (size));
+
+                if (size>mMapping.size()-begin-sEntryHeaderSize)
+                {
+                    std::cerr << "Mesh cache " << mFile.string() << " is truncated" << std::endl;
+                    mChanged = true;
+                    break;
+                }
+
+                std::string key;
+                Reader (mMapping.data()+begin+sEntryHeaderSize, size).read (key);
+
+                mEntries[key] = std::make_pair (begin, sEntryHeaderSize+size);
+
+                begin += sEntryHeaderSize + size;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Ignoring mesh cache " << mFile.string() << ": " << e.what() << std::endl;
+            mEntries.clear();
+            if (mMapping.isOpen())
+                mMapping.close();
+            mChanged = true;
+        }
+    }
+
+    bool MeshCache::getStamp (const std::string& mesh, Stamp& stamp)
+    {
+        const VFS::Index::Entry *entry = mIndex.lookup (mesh);
+
+        if (!entry)
+            return false;
+
+        stamp.mSource = mIndex.getFilePath (*entry);
+        stamp.mOffset = entry->mOffset;
+        stamp.mSize = entry->mSize;
+
+        std::map<std::string, std::pair<uint64_t, int64_t> >::iterator iter =
+            mSources.find (stamp.mSource);
+
+        if (iter==mSources.end())
+        {
+            boost::system::error_code error;
+
+            uint64_t size = boost::filesystem::file_size (stamp.mSource, error);
+
+            if (error)
+                return false;
+
+            int64_t time = boost::filesystem::last_write_time (stamp.mSource, error);
+
+            if (error)
+                return false;
+
+            iter = mSources.insert (std::make_pair (stamp.mSource, std::make_pair (size, time))).first;
+        }
+
+        stamp.mSourceSize = iter->second.first;
+        stamp.mSourceTime = iter->second.second;
+
+        return true;
+    }
+
+    bool MeshCache::get (const std::string& mesh, size_t shape, bool transformed,
+        Geometry& geometry)
+    {
+        std::string key = getKey (mesh, shape, transformed);
+
+        const char *data = 0;
+        size_t size = 0;
+
+        std::map<std::string, std::string>::iterator added = mAdded.find (key);
+        std::map<std::string, std::pair<size_t, size_t> >::iterator entry = mEntries.end();
+
+        if (added!=mAdded.end())
+        {
+            data = added->second.data();
+            size = added->second.size();
+        }
+        else
+        {
+            entry = mEntries.find (key);
+
+            if (entry!=mEntries.end())
+            {
+                data = mMapping.data() + entry->second.first;
+                size = entry->second.second;
+            }
+        }
+
+        Stamp stamp;
+
+        if (!data || !getStamp (mesh, stamp))
+        {
+            ++mStats.mMisses;
+            return false;
+        }
+
+        try
+        {
+            uint32_t checksum = 0;
+            std::memcpy (&checksum, data+4, sizeof (checksum));
+
+            if (checksum!=getChecksum (data+sEntryHeaderSize, size-sEntryHeaderSize))
+                throw std::runtime_error ("checksum mismatch");
+
+            Reader reader (data+sEntryHeaderSize, size-sEntryHeaderSize);
+
+            std::string storedKey;
+            Stamp stored;
+
+            reader.read (storedKey);
+            reader.read (stored.mSource);
+            reader.read (stored.mOffset);
+            reader.read (stored.mSize);
+            reader.read (stored.mSourceSize);
+            reader.read (stored.mSourceTime);
+
+            if (stored.mSource!=stamp.mSource || stored.mOffset!=stamp.mOffset ||
+                stored.mSize!=stamp.mSize || stored.mSourceSize!=stamp.mSourceSize ||
+                stored.mSourceTime!=stamp.mSourceTime)
+            {
+                // the NIF has changed, put() replaces the entry
+                ++mStats.mMisses;
+                return false;
+            }
+
+            reader.read (geometry.mMin);
+            reader.read (geometry.mMax);
+            reader.read (geometry.mRadius);
+            reader.read (geometry.mVertices);
+            reader.read (geometry.mNormals);
+            reader.read (geometry.mColours);
+            reader.read (geometry.mUVSets);
+            reader.read (geometry.mUVs);
+            reader.read (geometry.mIndices);
+
+            if (!reader.atEnd() || geometry.mUVs.size()!=geometry.mVertices.size()*geometry.mUVSets)
+                throw std::runtime_error ("inconsistent entry");
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Dropping mesh cache entry for " << mesh << ": " << e.what() << std::endl;
+
+            if (added!=mAdded.end())
+                mAdded.erase (added);
+            else
+                mEntries.erase (entry);
+
+            mChanged = true;
+            ++mStats.mCorrupt;
+            ++mStats.mMisses;
+            return false;
+        }
+
+        ++mStats.mHits;
+        return true;
+    }
+
+    void MeshCache::put (const std::string& mesh, size_t shape, bool transformed,
+        const Geometry& geometry)
+    {
+        Stamp stamp;
+
+        if (!getStamp (mesh, stamp))
+            return;
+
+        std::string key = getKey (mesh, shape, transformed);
+
+        std::string buffer (sEntryHeaderSize, '\0');
+
+        Writer writer (buffer);
+        writer.write (key);
+        writer.write (stamp.mSource);
+        writer.write (stamp.mOffset);
+        writer.write (stamp.mSize);
+        writer.write (stamp.mSourceSize);
+        writer.write (stamp.mSourceTime);
+        writer.write (geometry.mMin);
+        writer.write (geometry.mMax);
+        writer.write (geometry.mRadius);
+        writer.write (geometry.mVertices);
+        writer.write (geometry.mNormals);
+        writer.write (geometry.mColours);
+        writer.write (geometry.mUVSets);
+        writer.write (geometry.mUVs);
+        writer.write (geometry.mIndices);
+
+        uint32_t size = buffer.size()-sEntryHeaderSize;
+        uint32_t checksum = getChecksum (buffer.data()+sEntryHeaderSize, size);
+        std::memcpy (&buffer[0], &size, sizeof (size));
+        std::memcpy (&buffer[4], &checksum, sizeof (checksum));
+
+        mEntries.erase (key);
+        mAdded[key].swap (buffer);
+        mChanged = true;
+    }
+
+    void MeshCache::write()
+    {
+        std::cout
+            << "Mesh cache: " << mStats.mHits << " hits, " << mStats.mMisses << " misses, "
+            << mStats.mCorrupt << " corrupt entries" << std::endl;
+
+        if (!mChanged)
+            return;
+
+        // Written next to the cache and renamed once complete, so an interrupted write never
+        // leaves a truncated cache behind
+        boost::filesystem::path temp (mFile.string() + ".tmp");
+
+        try
+        {
+            boost::filesystem::create_directories (mFile.parent_path());
+
+            boost::filesystem::ofstream stream (temp, std::ios::binary);
+
+            std::string header;
+            Writer writer (header);
+            writer.write (sMagic);
+            writer.write (sFormat);
+            writer.write (mColourType);
+            writer.write (getBuild());
+            stream.write (header.data(), header.size());
+
+            for (std::map<std::string, std::pair<size_t, size_t> >::const_iterator iter (
+                mEntries.begin()); iter!=mEntries.end(); ++iter)
+                stream.write (mMapping.data()+iter->second.first, iter->second.second);
+
+            for (std::map<std::string, std::string>::const_iterator iter (mAdded.begin());
+                iter!=mAdded.end(); ++iter)
+                stream.write (iter->second.data(), iter->second.size());
+
+            stream.close();
+
+            if (!stream)
+                throw std::runtime_error ("write failed");
+
+            if (mMapping.isOpen())
+                mMapping.close();
+
+            boost::system::error_code error;
+            boost::filesystem::remove (mFile, error);
+            boost::filesystem::rename (temp, mFile);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to write mesh cache " << mFile.string() << ": " << e.what()
+                << std::endl;
+
+            boost::system::error_code error;
+            boost::filesystem::remove (temp, error);
+        }
+
+        mAdded.clear();
+        mChanged = false;
+        open();
+    }
+
+    const MeshCache::Stats& MeshCache::getStats() const
+    {
+        return mStats;
+    }
+}
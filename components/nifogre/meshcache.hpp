@@ -0,0 +1,116 @@
+#ifndef COMPONENTS_NIFOGRE_MESHCACHE_HPP
+#define COMPONENTS_NIFOGRE_MESHCACHE_HPP
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <OgreVector2.h>
+#include <OgreVector3.h>
+
+#include <components/files/memorymappedfile.hpp>
+
+namespace VFS
+{
+    class Index;
+}
+
+namespace NifOgre
+{
+    /// \brief On-disk cache of the geometry NIFMeshLoader builds from NiTriShapes
+    ///
+    /// Entries are keyed by mesh name and shape index and stamped with where the NIF came from:
+    /// the file the resource index found it in, its offset and size there, and the size and
+    /// modification time of that file. An entry is only used while its stamp matches. New
+    /// entries are kept in memory until write() merges them with the old ones.
+    ///
+    /// Every entry has a checksum and all sizes are checked before use, so a damaged cache file
+    /// only costs misses. Not thread safe.
+    class MeshCache
+    {
+        public:
+
+            /// Sub-mesh data in the layout of its hardware buffers
+            struct Geometry
+            {
+                Ogre::Vector3 mMin;
+                Ogre::Vector3 mMax;
+                float mRadius;
+                std::vector<Ogre::Vector3> mVertices;
+                std::vector<Ogre::Vector3> mNormals;
+                std::vector<uint32_t> mColours; ///< converted for the render system
+                std::vector<Ogre::Vector2> mUVs; ///< all sets of a vertex next to each other
+                uint32_t mUVSets;
+                std::vector<short> mIndices;
+
+                Geometry();
+            };
+
+            struct Stats
+            {
+                int mHits;
+                int mMisses;
+                int mCorrupt; ///< entries dropped because they failed the checks
+
+                Stats();
+            };
+
+            MeshCache (const boost::filesystem::path& file, const VFS::Index& index,
+                int colourType);
+            ///< \param colourType Ogre::VertexElementType of vertex colours on the render system;
+            /// a cache written for another type is discarded.
+
+            bool get (const std::string& mesh, size_t shape, bool transformed, Geometry& geometry);
+            ///< Fill \a geometry from the cache.
+            ///
+            /// \param transformed Are the vertices transformed into the space of the mesh? This
+            /// depends on whether the mesh has a skeleton.
+            /// \return Was there a valid entry?
+
+            void put (const std::string& mesh, size_t shape, bool transformed,
+                const Geometry& geometry);
+            ///< Add or replace an entry. Meshes the resource index does not know are not cached.
+
+            void write();
+            ///< Replace the cache file with all valid entries and log the statistics. Failures
+            /// are logged, not thrown.
+
+            const Stats& getStats() const;
+
+        private:
+
+            MeshCache (const MeshCache&);
+            MeshCache& operator= (const MeshCache&);
+
+            struct Stamp
+            {
+                std::string mSource;
+                uint64_t mOffset;
+                uint64_t mSize;
+                uint64_t mSourceSize;
+                int64_t mSourceTime;
+            };
+
+            void open();
+
+            bool getStamp (const std::string& mesh, Stamp& stamp);
+            ///< \return false if the mesh can not be cached
+
+            boost::filesystem::path mFile;
+            const VFS::Index& mIndex;
+            uint32_t mColourType;
+            MemoryMappedFile mMapping;
+            std::map<std::string, std::pair<size_t, size_t> > mEntries; ///< offset and size in mMapping
+            std::map<std::string, std::string> mAdded;
+            std::map<std::string, std::pair<uint64_t, int64_t> > mSources; ///< size, time
+            bool mChanged;
+            Stats mStats;
+    };
+}
+
+#endif
@@ -0,0 +1,158 @@
+#include "archive.hpp"
+
+#include <OgreArchive.h>
+#include <OgreArchiveFactory.h>
+#include <OgreArchiveManager.h>
+#include <OgreResourceGroupManager.h>
+
+#include "index.hpp"
+
+namespace
+{
+    /// An OGRE Archive answering all lookups from a VFS::Index
+    class IndexArchive : public Ogre::Archive
+    {
+            boost::shared_ptr<VFS::Index> mIndex;
+
+            Ogre::FileInfo makeFileInfo (VFS::Index::Iterator iter) const
+            {
+                std::string name = mIndex->getName (iter);
+                std::string::size_type pt = name.rfind ('/');
+
+                Ogre::FileInfo fi;
+                fi.archive = const_cast<IndexArchive *> (this);
+                fi.path = pt==std::string::npos ? std::string() : name.substr (0, pt);
+                fi.filename = pt==std::string::npos ? name : name.substr (pt+1);
+                fi.compressedSize = fi.uncompressedSize =
+                    iter->second.mSize!=0xFFFFFFFF ? iter->second.mSize : 0;
+                return fi;
+            }
+
+        public:
+
+            IndexArchive (const Ogre::String& name, const boost::shared_ptr<VFS::Index>& index)
+            : Ogre::Archive (name, "VFS"), mIndex (index)
+            {}
+
+            bool isCaseSensitive() const { return mIndex->isCaseSensitive(); }
+
+            // The index is built before the archive is created, and never unloaded.
+            void load() {}
+            void unload() {}
+
+            Ogre::DataStreamPtr open (const Ogre::String& filename, bool readonly = true) const
+            {
+                return mIndex->open (filename);
+            }
+
+            Ogre::StringVectorPtr list (bool recursive = true, bool dirs = false)
+            {
+                return find ("*", recursive, dirs);
+            }
+
+            Ogre::FileInfoListPtr listFileInfo (bool recursive = true, bool dirs = false)
+            {
+                return findFileInfo ("*", recursive, dirs);
+            }
+
+            Ogre::StringVectorPtr find (const Ogre::String& pattern, bool recursive = true,
+                bool dirs = false)
+            {
+                std::string normalizedPattern = mIndex->normalize (pattern);
+                std::string recursivePattern = "*/" + normalizedPattern;
+
+                Ogre::StringVectorPtr ptr (new Ogre::StringVector());
+
+                for (VFS::Index::Iterator iter = mIndex->begin(); iter!=mIndex->end(); ++iter)
+                    if (Ogre::StringUtil::match (iter->first, normalizedPattern) ||
+                        (recursive && Ogre::StringUtil::match (iter->first, recursivePattern)))
+                        ptr->push_back (mIndex->getName (iter));
+
+                return ptr;
+            }
+
+            bool exists (const Ogre::String& filename)
+            {
+                return mIndex->exists (filename);
+            }
+
+            time_t getModifiedTime (const Ogre::String&) { return 0; }
+
+            Ogre::FileInfoListPtr findFileInfo (const Ogre::String& pattern, bool recursive = true,
+                bool dirs = false) const
+            {
+                std::string normalizedPattern = mIndex->normalize (pattern);
+
+                Ogre::FileInfoListPtr ptr (new Ogre::FileInfoList());
+
+                // Plain file names are answered with a single lookup
+                if (normalizedPattern.find ('*')==std::string::npos)
+                {
+                    VFS::Index::Iterator iter = mIndex->find (pattern);
+
+                    if (iter!=mIndex->end())
+                    {
+                        ptr->push_back (makeFileInfo (iter));
+                        return ptr;
+                    }
+                }
+
+                std::string recursivePattern = "*/" + normalizedPattern;
+
+                for (VFS::Index::Iterator iter = mIndex->begin(); iter!=mIndex->end(); ++iter)
+                    if (Ogre::StringUtil::match (iter->first, normalizedPattern) ||
+                        (recursive && Ogre::StringUtil::match (iter->first, recursivePattern)))
+                        ptr->push_back (makeFileInfo (iter));
+
+                return ptr;
+            }
+    };
+
+    class IndexArchiveFactory : public Ogre::ArchiveFactory
+    {
+            boost::shared_ptr<VFS::Index> mIndex;
+
+        public:
+
+            const Ogre::String& getType() const
+            {
+                static Ogre::String name = "VFS";
+                return name;
+            }
+
+            void setIndex (const boost::shared_ptr<VFS::Index>& index)
+            {
+                mIndex = index;
+            }
+
+            Ogre::Archive *createInstance (const Ogre::String& name)
+            {
+                return new IndexArchive (name, mIndex);
+            }
+
+            virtual Ogre::Archive* createInstance (const Ogre::String& name, bool readOnly)
+            {
+                return new IndexArchive (name, mIndex);
+            }
+
+            void destroyInstance (Ogre::Archive* arch) { delete arch; }
+    };
+
+    IndexArchiveFactory *sFactory = 0;
+}
+
+namespace VFS
+{
+    void registerIndex (const boost::shared_ptr<Index>& index, const std::string& group)
+    {
+        if (!sFactory)
+        {
+            sFactory = new IndexArchiveFactory;
+            Ogre::ArchiveManager::getSingleton().addArchiveFactory (sFactory);
+        }
+
+        sFactory->setIndex (index);
+
+        Ogre::ResourceGroupManager::getSingleton().addResourceLocation ("VFS:" + group, "VFS", group, true);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef COMPONENTS_VFS_ARCHIVE_HPP
+#define COMPONENTS_VFS_ARCHIVE_HPP
+
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+namespace VFS
+{
+    class Index;
+
+    void registerIndex (const boost::shared_ptr<Index>& index, const std::string& group);
+    ///< Add \a index as a single resource location to the Ogre resource group \a group.
+}
+
+#endif
@@ -0,0 +1,287 @@
+#include "index.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+#include <OgreTimer.h>
+
+#include <components/bsa/bsa_file.hpp>
+#include <components/bsa/compressed_file.hpp>
+#include <components/files/constrainedfiledatastream.hpp>
+#include <components/files/lowlevelfile.hpp>
+
+#include "prefetcher.hpp"
+#include "tracer.hpp"
+
+namespace
+{
+    char strictNormalizeChar (char ch)
+    {
+        return ch == '\\' ? '/' : ch;
+    }
+}
+
+namespace VFS
+{
+    Index::Index (bool fsStrict)
+    : mFsStrict (fsStrict), mBuildTime (0), mPrefetcher (0)
+    {}
+
+    void Index::addDirectory (const boost::filesystem::path& path)
+    {
+        Ogre::Timer timer;
+
+        Source source;
+        source.mPath = path.string();
+        mSources.push_back (source);
+
+        Entry entry;
+        entry.mSource = mSources.size()-1;
+        entry.mOffset = 0;
+        entry.mSize = 0xFFFFFFFF;
+
+        size_t prefix = source.mPath.size();
+
+        if (prefix > 0 && source.mPath[prefix-1] != '\\' && source.mPath[prefix-1] != '/')
+            ++prefix;
+
+        typedef boost::filesystem::recursive_directory_iterator directory_iterator;
+
+        for (directory_iterator iter (path), end; iter != end; ++iter)
+        {
+            if (boost::filesystem::is_directory (*iter))
+                continue;
+
+            entry.mFile = iter->path().string();
+
+            insert (normalize (entry.mFile.substr (prefix)), entry);
+        }
+
+        mBuildTime += timer.getMicroseconds() / 1000000.0;
+    }
+
+    void Index::addArchive (const std::string& path, bool memoryMapped)
+    {
+        Ogre::Timer timer;
+
+        Source source;
+        source.mPath = path;
+
+#ifdef OPENMW_USE_LZ4
+        if (Bsa::CompressedFile::isCompressedFile (path))
+        {
+            source.mCompressed.reset (new Bsa::CompressedFile);
+            source.mCompressed->open (path);
+            mSources.push_back (source);
+
+            Entry entry;
+            entry.mSource = mSources.size()-1;
+
+            const Bsa::CompressedFile::FileList& files = source.mCompressed->getList();
+
+            for (size_t i=0; i<files.size(); ++i)
+            {
+                entry.mOffset = i;
+                entry.mSize = files[i].fileSize;
+                insert (files[i].normalizedName, entry);
+            }
+
+            mBuildTime += timer.getMicroseconds() / 1000000.0;
+            return;
+        }
+#endif
+
+        source.mArchive.reset (new Bsa::BSAFile);
+        source.mArchive->open (path, memoryMapped);
+        mSources.push_back (source);
+
+        Entry entry;
+        entry.mSource = mSources.size()-1;
+
+        const Bsa::BSAFile::FileList& files = source.mArchive->getList();
+
+        for (Bsa::BSAFile::FileList::const_iterator iter (files.begin()); iter!=files.end(); ++iter)
+        {
+            entry.mOffset = iter->offset;
+            entry.mSize = iter->fileSize;
+
+            insert (iter->normalizedName, entry);
+        }
+
+        mBuildTime += timer.getMicroseconds() / 1000000.0;
+    }
+
+    void Index::insert (const std::string& key, const Entry& entry)
+    {
+        std::pair<Container::iterator, bool> result = mEntries.insert (std::make_pair (key, entry));
+
+        if (!result.second)
+            result.first->second = entry;
+    }
+
+    std::string Index::normalize (const std::string& path) const
+    {
+        std::string normalized (path);
+
+        std::transform (normalized.begin(), normalized.end(), normalized.begin(),
+            &Bsa::BSAFile::normalizeChar);
+
+        return normalized;
+    }
+
+    std::string Index::getName (Iterator iter) const
+    {
+        if (!mFsStrict || iter->second.mFile.empty())
+            return iter->first;
+
+        // normalizeChar maps one character to one, so the key is as long as the relative path
+        std::string name (iter->second.mFile.substr (iter->second.mFile.size()-iter->first.size()));
+
+        std::transform (name.begin(), name.end(), name.begin(), &strictNormalizeChar);
+
+        return name;
+    }
+
+    Index::Iterator Index::find (const std::string& path) const
+    {
+        Container::const_iterator iter = mEntries.find (normalize (path));
+
+        // BSA lookups have always been case insensitive, loose files in strict mode only match
+        // with the case they have on disk
+        if (iter!=mEntries.end() && mFsStrict && !iter->second.mFile.empty())
+        {
+            std::string strictPath (path);
+
+            std::transform (strictPath.begin(), strictPath.end(), strictPath.begin(),
+                &strictNormalizeChar);
+
+            if (strictPath!=getName (iter))
+                return mEntries.end();
+        }
+
+        return iter;
+    }
+
+    const Index::Entry *Index::lookup (const std::string& path) const
+    {
+        Iterator iter = find (path);
+
+        return iter!=mEntries.end() ? &iter->second : 0;
+    }
+
+    bool Index::exists (const std::string& path) const
+    {
+        return lookup (path)!=0;
+    }
+
+    Ogre::DataStreamPtr Index::open (const std::string& path) const
+    {
+        Iterator iter = find (path);
+
+        if (iter==mEntries.end())
+            throw std::runtime_error ("The file '" + path + "' could not be found.");
+
+        if (!mTracer)
+            return openCached (iter);
+
+        uint64_t start = mTracer->getTime();
+
+        Ogre::DataStreamPtr stream = openCached (iter);
+
+        return mTracer->trace (iter->first, getFilePath (iter->second), iter->second.mOffset,
+            iter->second.mSize, stream, mTracer->getTime()-start);
+    }
+
+    Ogre::DataStreamPtr Index::openCached (Iterator iter) const
+    {
+        if (mPrefetcher)
+        {
+            Ogre::DataStreamPtr stream = mPrefetcher->take (iter->first);
+
+            if (!stream.isNull())
+                return stream;
+        }
+
+        return open (iter->second);
+    }
+
+    Ogre::DataStreamPtr Index::open (const Entry& entry) const
+    {
+        const Source& source = mSources.at (entry.mSource);
+
+        if (source.mArchive)
+            return source.mArchive->getFile (entry.mOffset, entry.mSize);
+
+#ifdef OPENMW_USE_LZ4
+        if (source.mCompressed)
+            return source.mCompressed->getFile (entry.mOffset);
+#endif
+
+        return openConstrainedFileDataStream (entry.mFile.c_str());
+    }
+
+    void Index::prefetch (const Entry& entry) const
+    {
+        const Source& source = mSources.at (entry.mSource);
+
+        if (source.mArchive)
+            source.mArchive->prefetch (entry.mOffset, entry.mSize);
+#ifdef OPENMW_USE_LZ4
+        else if (source.mCompressed)
+            source.mCompressed->prefetch (entry.mOffset);
+#endif
+        else
+            openSharedLowLevelFile (entry.mFile.c_str())->prefetch (0, 0); // 0: up to the end
+    }
+
+    void Index::setPrefetcher (Prefetcher *prefetcher)
+    {
+        mPrefetcher = prefetcher;
+    }
+
+    void Index::setTracer (const boost::shared_ptr<Tracer>& tracer)
+    {
+        // Streams opened earlier keep the old tracer alive, so it may not be destroyed here.
+        if (mTracer)
+            mTracer->flush();
+
+        mTracer = tracer;
+    }
+
+    const std::string& Index::getFilePath (const Entry& entry) const
+    {
+        return entry.mFile.empty() ? mSources.at (entry.mSource).mPath : entry.mFile;
+    }
+
+    const std::vector<Index::Source>& Index::getSources() const
+    {
+        return mSources;
+    }
+
+    Index::Iterator Index::begin() const
+    {
+        return mEntries.begin();
+    }
+
+    Index::Iterator Index::end() const
+    {
+        return mEntries.end();
+    }
+
+    size_t Index::getSize() const
+    {
+        return mEntries.size();
+    }
+
+    bool Index::isCaseSensitive() const
+    {
+        return mFsStrict;
+    }
+
+    double Index::getBuildTime() const
+    {
+        return mBuildTime;
+    }
+}
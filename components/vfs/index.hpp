@@ -0,0 +1,142 @@
+#ifndef COMPONENTS_VFS_INDEX_HPP
+#define COMPONENTS_VFS_INDEX_HPP
+
+#ifdef _WIN32
+#include <boost/tr1/tr1/unordered_map>
+#elif defined HAVE_UNORDERED_MAP
+#include <unordered_map>
+#else
+#include <tr1/unordered_map>
+#endif
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <OgreDataStream.h>
+
+namespace Bsa
+{
+    class BSAFile;
+    class CompressedFile;
+}
+
+namespace VFS
+{
+    class Prefetcher;
+    class Tracer;
+
+    /// \brief Merged index of all data directories and BSA archives
+    ///
+    /// Sources are added in load order, a file in a later source overrides the same path in
+    /// all earlier ones. Looking up a path is a single hash probe on the normalized path,
+    /// regardless of how many sources are loaded.
+    ///
+    /// All sources are keyed by the lower case path, so overriding works across sources whatever
+    /// the case of the file names. In strict mode loose files are only found with the case they
+    /// have on disk.
+    class Index
+    {
+        public:
+
+            struct Source
+            {
+                std::string mPath;
+                boost::shared_ptr<Bsa::BSAFile> mArchive; ///< null unless a BSA archive
+                boost::shared_ptr<Bsa::CompressedFile> mCompressed; ///< null unless a compressed archive
+            };
+
+            struct Entry
+            {
+                int mSource;        ///< index into getSources()
+                std::string mFile;  ///< full path of a loose file, empty for archive entries
+                size_t mOffset;     ///< index into the file list for compressed archives
+                size_t mSize;       ///< 0xFFFFFFFF for loose files (up to the end of the file)
+            };
+
+        #if defined HAVE_UNORDERED_MAP
+            typedef std::unordered_map<std::string, Entry> Container;
+        #else
+            typedef std::tr1::unordered_map<std::string, Entry> Container;
+        #endif
+
+            typedef Container::const_iterator Iterator;
+
+            Index (bool fsStrict);
+
+            void addDirectory (const boost::filesystem::path& path);
+            ///< Add all files below \a path, overriding files from earlier sources.
+
+            void addArchive (const std::string& path, bool memoryMapped);
+            ///< Add all files in the BSA or compressed archive \a path, overriding files from
+            /// earlier sources.
+            ///
+            /// \param memoryMapped Only applies to BSA archives
+
+            std::string normalize (const std::string& path) const;
+            ///< Convert a path to the form used as key in the index.
+
+            std::string getName (Iterator iter) const;
+            ///< Path of \a iter as it should be listed; in strict mode loose files keep the case
+            /// they have on disk, so the name can be passed to find again.
+
+            Iterator find (const std::string& path) const;
+            ///< \return end() if \a path is not in the index
+
+            const Entry *lookup (const std::string& path) const;
+            ///< \return 0 if \a path is not in the index
+
+            bool exists (const std::string& path) const;
+
+            Ogre::DataStreamPtr open (const std::string& path) const;
+            ///< Throws an exception if \a path is not in the index.
+            ///
+            /// Served from the prefetcher's memory cache if possible.
+
+            Ogre::DataStreamPtr open (const Entry& entry) const;
+            ///< Always reads from the source. Safe to call from several threads at once.
+
+            void prefetch (const Entry& entry) const;
+            ///< Hint that \a entry will be opened soon. Does not block.
+
+            void setPrefetcher (Prefetcher *prefetcher);
+            ///< Let \a prefetcher see (and serve) all open (const std::string&) calls.
+
+            void setTracer (const boost::shared_ptr<Tracer>& tracer);
+            ///< Log all open (const std::string&) calls and the reads on the returned streams.
+            /// Pass an empty pointer to stop tracing.
+
+            const std::string& getFilePath (const Entry& entry) const;
+            ///< Path of the file on disk that contains \a entry.
+
+            const std::vector<Source>& getSources() const;
+
+            Iterator begin() const;
+            Iterator end() const;
+
+            size_t getSize() const;
+            ///< Number of distinct paths in the index.
+
+            bool isCaseSensitive() const;
+
+            double getBuildTime() const;
+            ///< Total time spent adding sources, in seconds.
+
+        private:
+
+            void insert (const std::string& key, const Entry& entry);
+
+            Ogre::DataStreamPtr openCached (Iterator iter) const;
+
+            bool mFsStrict;
+            std::vector<Source> mSources;
+            Container mEntries;
+            double mBuildTime;
+            Prefetcher *mPrefetcher;
+            boost::shared_ptr<Tracer> mTracer;
+    };
+}
+
+#endif
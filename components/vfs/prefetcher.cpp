@@ -0,0 +1,198 @@
+#include "prefetcher.hpp"
+
+#include <iostream>
+
+#include "index.hpp"
+
+namespace
+{
+    /// Stream over a prefetched buffer, keeping the buffer alive while it is open
+    class BufferDataStream : public Ogre::MemoryDataStream
+    {
+            boost::shared_ptr<std::vector<char> > mBuffer;
+
+        public:
+
+            BufferDataStream (const std::string& name, const boost::shared_ptr<std::vector<char> >& buffer)
+            : Ogre::MemoryDataStream (name, buffer->empty() ? 0 : &(*buffer)[0], buffer->size(),
+                false, true),
+              mBuffer (buffer)
+            {}
+    };
+}
+
+namespace VFS
+{
+    Prefetcher::Stats::Stats()
+    : mRequested (0), mWarmed (0), mHits (0), mMisses (0)
+    {}
+
+    Prefetcher::Prefetcher (const Index& index, size_t cacheLimit)
+    : mIndex (index), mCacheLimit (cacheLimit), mCacheSize (0), mQuit (false)
+    {
+        mThread = boost::thread (&Prefetcher::run, this);
+    }
+
+    Prefetcher::~Prefetcher()
+    {
+        {
+            boost::mutex::scoped_lock lock (mMutex);
+            mQuit = true;
+        }
+
+        mCondition.notify_all();
+        mThread.join();
+    }
+
+    void Prefetcher::prefetch (const std::vector<std::string>& paths)
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+
+        if (mStats.mRequested>0)
+            logStats();
+
+        mQueue.clear();
+        mBatch.clear();
+        mStats = Stats();
+
+        for (std::vector<std::string>::const_iterator iter (paths.begin()); iter!=paths.end(); ++iter)
+        {
+            Index::Iterator entry = mIndex.find (*iter);
+
+            if (entry!=mIndex.end() && mBatch.insert (entry->first).second)
+                mQueue.push_back (entry);
+        }
+
+        mStats.mRequested = mBatch.size();
+
+        // Keep what is still useful from the previous batch, and only that
+        std::set<std::string> warm;
+
+        for (std::set<std::string>::const_iterator iter (mWarm.begin()); iter!=mWarm.end(); ++iter)
+            if (mBatch.count (*iter))
+                warm.insert (*iter);
+
+        mWarm.swap (warm);
+
+        for (std::map<std::string, Buffer>::iterator iter (mCache.begin()); iter!=mCache.end();)
+        {
+            if (!mBatch.count (iter->first))
+            {
+                mCacheSize -= iter->second->size();
+                mCache.erase (iter++);
+            }
+            else
+                ++iter;
+        }
+
+        mCondition.notify_all();
+    }
+
+    Ogre::DataStreamPtr Prefetcher::take (const std::string& key)
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+
+        if (!mBatch.count (key))
+            return Ogre::DataStreamPtr();
+
+        if (!mWarm.count (key))
+        {
+            ++mStats.mMisses;
+            return Ogre::DataStreamPtr();
+        }
+
+        ++mStats.mHits;
+
+        std::map<std::string, Buffer>::const_iterator iter = mCache.find (key);
+
+        if (iter==mCache.end())
+            return Ogre::DataStreamPtr();
+
+        return Ogre::DataStreamPtr (new BufferDataStream (key, iter->second));
+    }
+
+    Prefetcher::Stats Prefetcher::getStats() const
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+
+        return mStats;
+    }
+
+    void Prefetcher::logStats() const
+    {
+        std::cout
+            << "Prefetch: " << mStats.mRequested << " files requested, "
+            << mStats.mWarmed << " warmed, "
+            << mStats.mHits << " hits, " << mStats.mMisses << " misses" << std::endl;
+    }
+
+    void Prefetcher::run()
+    {
+        while (true)
+        {
+            std::string key;
+            Index::Iterator entry;
+            bool cache = false;
+
+            {
+                boost::mutex::scoped_lock lock (mMutex);
+
+                while (mQueue.empty() && !mQuit)
+                    mCondition.wait (lock);
+
+                if (mQuit)
+                    return;
+
+                entry = mQueue.front();
+                mQueue.pop_front();
+
+                key = entry->first;
+
+                // Loose files have an unknown size, so they only get a page cache hint
+                cache = entry->second.mSize!=0xFFFFFFFF &&
+                    mCacheSize + entry->second.mSize<=mCacheLimit;
+
+                if (cache)
+                    mCacheSize += entry->second.mSize;
+            }
+
+            Buffer buffer;
+
+            try
+            {
+                if (cache)
+                {
+                    Ogre::DataStreamPtr stream = mIndex.open (entry->second);
+                    buffer.reset (new std::vector<char> (stream->size()));
+
+                    if (!buffer->empty())
+                        buffer->resize (stream->read (&(*buffer)[0], buffer->size()));
+                }
+                else
+                    mIndex.prefetch (entry->second);
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Failed to prefetch " << key << ": " << e.what() << std::endl;
+            }
+
+            boost::mutex::scoped_lock lock (mMutex);
+
+            if (cache)
+                mCacheSize -= entry->second.mSize;
+
+            // The batch may have been replaced while we were reading
+            if (!mBatch.count (key))
+                continue;
+
+            if (buffer && !mCache.count (key))
+            {
+                mCacheSize += buffer->size();
+                mCache.insert (std::make_pair (key, buffer));
+            }
+
+            mWarm.insert (key);
+            ++mStats.mWarmed;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef COMPONENTS_VFS_PREFETCHER_HPP
+#define COMPONENTS_VFS_PREFETCHER_HPP
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <OgreDataStream.h>
+
+#include "index.hpp"
+
+namespace VFS
+{
+    /// \brief Warms resources in the background before they are needed
+    ///
+    /// A worker thread walks the most recent list of paths passed to prefetch(). Each file is
+    /// either hinted to the OS page cache, or, while the memory budget allows, read completely
+    /// into memory, so the next open() through the Index does not touch the disk at all.
+    class Prefetcher
+    {
+        public:
+
+            /// Counters for one call of prefetch()
+            struct Stats
+            {
+                int mRequested; ///< paths in the batch that exist in the index
+                int mWarmed;    ///< paths the worker got to
+                int mHits;      ///< opens of batch paths after they were warmed
+                int mMisses;    ///< opens of batch paths before they were warmed
+
+                Stats();
+            };
+
+            Prefetcher (const Index& index, size_t cacheLimit);
+            ///< \param cacheLimit Maximum number of bytes to keep in memory. 0 only warms the
+            /// page cache.
+
+            ~Prefetcher();
+
+            void prefetch (const std::vector<std::string>& paths);
+            ///< Start a new batch with \a paths, replacing whatever is still queued. Logs and
+            /// resets the counters of the previous batch.
+
+            Ogre::DataStreamPtr take (const std::string& key);
+            ///< Called by Index::open with the normalized path being opened. Updates the
+            /// counters and returns the in-memory copy, if there is one.
+
+            Stats getStats() const;
+            ///< Counters of the current batch
+
+        private:
+
+            Prefetcher (const Prefetcher&);
+            Prefetcher& operator= (const Prefetcher&);
+
+            typedef boost::shared_ptr<std::vector<char> > Buffer;
+
+            void run();
+
+            void logStats() const;
+
+            const Index& mIndex;
+            size_t mCacheLimit;
+            size_t mCacheSize;
+
+            std::deque<Index::Iterator> mQueue; ///< as resolved by prefetch()
+            std::set<std::string> mBatch;
+            std::set<std::string> mWarm;
+            std::map<std::string, Buffer> mCache;
+            Stats mStats;
+
+            bool mQuit;
+            mutable boost::mutex mMutex;
+            boost::condition_variable mCondition;
+            boost::thread mThread;
+    };
+}
+
+#endif
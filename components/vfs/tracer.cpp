@@ -0,0 +1,299 @@
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const char sMagic[8] = { 'O', 'M', 'W', 'T', 'R', 'A', 'C', 'E' };
+
+    void writeInt (std::ostream& stream, uint64_t value, int bytes)
+    {
+        for (int i=0; i<bytes; ++i)
+            stream.put (static_cast<char> ((value >> (8*i)) & 0xff));
+    }
+
+    void writeString (std::ostream& stream, const std::string& value)
+    {
+        size_t size = value.size()<0xffff ? value.size() : 0xffff;
+        writeInt (stream, size, 2);
+        stream.write (value.c_str(), size);
+    }
+
+    template<typename T>
+    bool readInt (std::istream& stream, T& value, int bytes)
+    {
+        unsigned char buffer[8];
+
+        if (!stream.read (reinterpret_cast<char *> (buffer), bytes))
+            return false;
+
+        value = 0;
+
+        for (int i=bytes-1; i>=0; --i)
+            value = (value << 8) | buffer[i];
+
+        return true;
+    }
+
+    bool readString (std::istream& stream, std::string& value)
+    {
+        uint16_t size;
+
+        if (!readInt (stream, size, 2))
+            return false;
+
+        value.resize (size);
+
+        return size==0 || stream.read (&value[0], size);
+    }
+
+    /// Forwards to another stream and logs every read
+    class TracingDataStream : public Ogre::DataStream
+    {
+            boost::shared_ptr<VFS::Tracer> mTracer;
+            Ogre::DataStreamPtr mStream;
+            uint32_t mId;
+            bool mClosed;
+
+        public:
+
+            TracingDataStream (const boost::shared_ptr<VFS::Tracer>& tracer,
+                const Ogre::DataStreamPtr& stream, uint32_t id)
+            : Ogre::DataStream (stream->getName()), mTracer (tracer), mStream (stream), mId (id),
+              mClosed (false)
+            {
+                mSize = mStream->size();
+            }
+
+            ~TracingDataStream()
+            {
+                close();
+            }
+
+            size_t read (void *buf, size_t count)
+            {
+                VFS::TraceRecord record;
+                record.mType = VFS::TraceRecord::Type_Read;
+                record.mId = mId;
+                record.mOffset = mStream->tell();
+                record.mSize = count;
+                record.mTime = mTracer->getTime();
+
+                size_t result = mStream->read (buf, count);
+
+                record.mResult = result;
+                record.mDuration = mTracer->getTime() - record.mTime;
+                mTracer->record (record);
+
+                return result;
+            }
+
+            void skip (long count) { mStream->skip (count); }
+
+            void seek (size_t pos) { mStream->seek (pos); }
+
+            size_t tell() const { return mStream->tell(); }
+
+            bool eof() const { return mStream->eof(); }
+
+            void close()
+            {
+                if (mClosed)
+                    return;
+
+                mClosed = true;
+                mStream->close();
+
+                VFS::TraceRecord record;
+                record.mType = VFS::TraceRecord::Type_Close;
+                record.mId = mId;
+                record.mTime = mTracer->getTime();
+                mTracer->record (record);
+            }
+    };
+}
+
+namespace VFS
+{
+    TraceRecord::TraceRecord()
+    : mType (Type_Source), mId (0), mTime (0), mSource (0), mOffset (0), mSize (0), mResult (0),
+      mDuration (0)
+    {}
+
+    Tracer::Tracer (const std::string& path)
+    : mStream (path.c_str(), std::ios::binary), mNextId (0)
+    {
+        if (!mStream)
+            throw std::runtime_error ("Can't open resource trace file " + path);
+
+        mStream.write (sMagic, sizeof (sMagic));
+        writeInt (mStream, sVersion, 4);
+    }
+
+    Tracer::~Tracer()
+    {
+        mStream.flush();
+    }
+
+    Ogre::DataStreamPtr Tracer::trace (const std::string& path, const std::string& file,
+        size_t offset, size_t size, Ogre::DataStreamPtr stream, uint32_t openDuration)
+    {
+        TraceRecord record;
+        record.mType = TraceRecord::Type_Open;
+        record.mPath = path;
+        record.mOffset = offset;
+        record.mSize = size!=0xFFFFFFFF ? size : stream->size();
+        record.mDuration = openDuration;
+
+        {
+            boost::mutex::scoped_lock lock (mMutex);
+
+            record.mTime = mTimer.getMicroseconds();
+            record.mId = mNextId++;
+
+            std::map<std::string, uint32_t>::const_iterator iter = mSources.find (file);
+
+            if (iter==mSources.end())
+            {
+                TraceRecord source;
+                source.mType = TraceRecord::Type_Source;
+                source.mId = mSources.size();
+                source.mPath = file;
+                write (source);
+
+                iter = mSources.insert (std::make_pair (file, source.mId)).first;
+            }
+
+            record.mSource = iter->second;
+            write (record);
+        }
+
+        return Ogre::DataStreamPtr (new TracingDataStream (shared_from_this(), stream, record.mId));
+    }
+
+    uint64_t Tracer::getTime()
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+        return mTimer.getMicroseconds();
+    }
+
+    void Tracer::record (const TraceRecord& record)
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+        write (record);
+    }
+
+    void Tracer::flush()
+    {
+        boost::mutex::scoped_lock lock (mMutex);
+        mStream.flush();
+    }
+
+    void Tracer::write (const TraceRecord& record)
+    {
+        writeInt (mStream, record.mType, 1);
+        writeInt (mStream, record.mId, 4);
+
+        switch (record.mType)
+        {
+            case TraceRecord::Type_Source:
+
+                writeString (mStream, record.mPath);
+                break;
+
+            case TraceRecord::Type_Open:
+
+                writeInt (mStream, record.mTime, 8);
+                writeString (mStream, record.mPath);
+                writeInt (mStream, record.mSource, 4);
+                writeInt (mStream, record.mOffset, 4);
+                writeInt (mStream, record.mSize, 4);
+                writeInt (mStream, record.mDuration, 4);
+                break;
+
+            case TraceRecord::Type_Read:
+
+                writeInt (mStream, record.mTime, 8);
+                writeInt (mStream, record.mOffset, 4);
+                writeInt (mStream, record.mSize, 4);
+                writeInt (mStream, record.mResult, 4);
+                writeInt (mStream, record.mDuration, 4);
+                break;
+
+            case TraceRecord::Type_Close:
+
+                writeInt (mStream, record.mTime, 8);
+                break;
+        }
+    }
+
+    TraceReader::TraceReader (const std::string& path)
+    : mStream (path.c_str(), std::ios::binary)
+    {
+        char magic[sizeof (sMagic)];
+        uint32_t version = 0;
+
+        if (!mStream.read (magic, sizeof (magic)) || !std::equal (magic, magic+sizeof (magic), sMagic))
+            throw std::runtime_error (path + " is not a resource trace file");
+
+        if (!readInt (mStream, version, 4) || version!=Tracer::sVersion)
+            throw std::runtime_error ("Unsupported resource trace version in " + path);
+    }
+
+    bool TraceReader::isTrace (const std::string& path)
+    {
+        std::ifstream stream (path.c_str(), std::ios::binary);
+
+        char magic[sizeof (sMagic)];
+
+        return stream.read (magic, sizeof (magic)) && std::equal (magic, magic+sizeof (magic), sMagic);
+    }
+
+    bool TraceReader::read (TraceRecord& record)
+    {
+        uint8_t type;
+
+        if (!readInt (mStream, type, 1))
+            return false;
+
+        record = TraceRecord();
+        record.mType = static_cast<TraceRecord::Type> (type);
+
+        bool ok = readInt (mStream, record.mId, 4);
+
+        switch (type)
+        {
+            case TraceRecord::Type_Source:
+
+                ok = ok && readString (mStream, record.mPath);
+                break;
+
+            case TraceRecord::Type_Open:
+
+                ok = ok && readInt (mStream, record.mTime, 8) && readString (mStream, record.mPath) &&
+                    readInt (mStream, record.mSource, 4) && readInt (mStream, record.mOffset, 4) &&
+                    readInt (mStream, record.mSize, 4) && readInt (mStream, record.mDuration, 4);
+                break;
+
+            case TraceRecord::Type_Read:
+
+                ok = ok && readInt (mStream, record.mTime, 8) && readInt (mStream, record.mOffset, 4) &&
+                    readInt (mStream, record.mSize, 4) && readInt (mStream, record.mResult, 4) &&
+                    readInt (mStream, record.mDuration, 4);
+                break;
+
+            case TraceRecord::Type_Close:
+
+                ok = ok && readInt (mStream, record.mTime, 8);
+                break;
+
+            default:
+
+                throw std::runtime_error ("Corrupt resource trace: unknown record type");
+        }
+
+        // A trace cut short by a crash simply ends with the last complete record.
+        return ok;
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef COMPONENTS_VFS_TRACER_HPP
+#define COMPONENTS_VFS_TRACER_HPP
+
+#include <fstream>
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <OgreDataStream.h>
+#include <OgreTimer.h>
+
+namespace VFS
+{
+    /// \brief One record of a resource trace
+    ///
+    /// A trace file starts with the 8 byte magic "OMWTRACE" and a 32 bit version, followed by
+    /// records of a one byte type and the fields listed below. All integers are little endian,
+    /// strings are a 16 bit length followed by the characters.
+    struct TraceRecord
+    {
+        enum Type
+        {
+            Type_Source = 0, ///< mId, mPath (file on disk)
+            Type_Open = 1,   ///< mId, mTime, mPath (path in the VFS), mSource, mOffset, mSize, mDuration
+            Type_Read = 2,   ///< mId, mTime, mOffset (position in the stream), mSize, mResult, mDuration
+            Type_Close = 3   ///< mId, mTime
+        };
+
+        Type mType;
+        uint32_t mId;       ///< stream id, or source id for Type_Source
+        uint64_t mTime;     ///< microseconds since the trace was started
+        std::string mPath;
+        uint32_t mSource;   ///< id of a previous Type_Source record
+        uint32_t mOffset;   ///< start of the file in its source (the entry index for compressed
+                            ///  archives), or read position in the stream
+        uint32_t mSize;     ///< file size, or bytes requested
+        uint32_t mResult;   ///< bytes returned
+        uint32_t mDuration; ///< microseconds spent in the open or read
+
+        TraceRecord();
+    };
+
+    /// \brief Writes a compact binary log of all resource opens and reads
+    ///
+    /// Safe to use from several threads. Must be owned by a boost::shared_ptr, since the streams
+    /// returned by trace() keep the tracer alive.
+    class Tracer : public boost::enable_shared_from_this<Tracer>
+    {
+        public:
+
+            static const uint32_t sVersion = 1;
+
+            Tracer (const std::string& path);
+            ///< Throws an exception if \a path can not be written.
+
+            ~Tracer();
+
+            Ogre::DataStreamPtr trace (const std::string& path, const std::string& file,
+                size_t offset, size_t size, Ogre::DataStreamPtr stream, uint32_t openDuration);
+            ///< Log the opening of \a path and wrap \a stream, so all reads on it are logged.
+            ///
+            /// \param file File on disk \a path was read from
+            /// \param offset Start of \a path within \a file
+            /// \param openDuration Microseconds spent opening \a stream
+
+            uint64_t getTime();
+            ///< Microseconds since the trace was started
+
+            void record (const TraceRecord& record);
+
+            void flush();
+            ///< Write out buffered records. Streams still open may add more records later.
+
+        private:
+
+            Tracer (const Tracer&);
+            Tracer& operator= (const Tracer&);
+
+            void write (const TraceRecord& record);
+
+            std::ofstream mStream;
+            std::map<std::string, uint32_t> mSources;
+            uint32_t mNextId;
+            Ogre::Timer mTimer;
+            boost::mutex mMutex;
+    };
+
+    /// \brief Reads the records of a file written by Tracer
+    class TraceReader
+    {
+        public:
+
+            TraceReader (const std::string& path);
+            ///< Throws an exception if \a path is not a trace file of a supported version.
+
+            bool read (TraceRecord& record);
+            ///< \return false at the end of the trace, or at a truncated last record
+
+            static bool isTrace (const std::string& path);
+            ///< Does \a path start like a trace file (of any version)?
+
+        private:
+
+            std::ifstream mStream;
+    };
+}
+
+#endif